@@ -5,6 +5,7 @@
 
 #define _POSIX_C_SOURCE 200809L
 #include "ast.h"
+#include "dmo_loops.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -28,11 +29,11 @@ void free_ast(ASTNode* node) {
             }
             free(node->program.statements);
             break;
-            
+        
         case AST_USE_STATEMENT:
             free(node->use_stmt.module_name);
             break;
-            
+        
         case AST_FUNCTION_DEF:
             free(node->func_def.return_type);
             free(node->func_def.name);
@@ -42,18 +43,18 @@ void free_ast(ASTNode* node) {
             free(node->func_def.parameters);
             free_ast(node->func_def.body);
             break;
-            
+        
         case AST_VARIABLE_DECL:
             free(node->var_decl.type);
             free(node->var_decl.name);
             free_ast(node->var_decl.initializer);
             break;
-            
+        
         case AST_ASSIGNMENT:
             free_ast(node->assignment.target);
             free_ast(node->assignment.value);
             break;
-            
+        
         case AST_FUNCTION_CALL:
             free(node->func_call.name);
             for (int i = 0; i < node->func_call.arg_count; i++) {
@@ -61,63 +62,84 @@ void free_ast(ASTNode* node) {
             }
             free(node->func_call.arguments);
             break;
-            
+        
         case AST_IF_STATEMENT:
             free_ast(node->if_stmt.condition);
             free_ast(node->if_stmt.then_stmt);
             free_ast(node->if_stmt.else_stmt);
             break;
-            
+        
         case AST_WHILE_LOOP:
             free_ast(node->while_loop.condition);
             free_ast(node->while_loop.body);
             break;
-            
+        
         case AST_FOR_LOOP:
             free_ast(node->for_loop.init);
             free_ast(node->for_loop.condition);
             free_ast(node->for_loop.increment);
             free_ast(node->for_loop.body);
+            free_ast(node->for_loop.parallel);
             break;
-            
+        
         case AST_RETURN_STATEMENT:
             free_ast(node->return_stmt.value);
             break;
-            
+        
         case AST_BLOCK:
             for (int i = 0; i < node->block.statement_count; i++) {
                 free_ast(node->block.statements[i]);
             }
             free(node->block.statements);
             break;
-            
+        
         case AST_BINARY_OP:
             free_ast(node->binary_op.left);
             free_ast(node->binary_op.right);
             break;
-            
+        
         case AST_UNARY_OP:
             free_ast(node->unary_op.operand);
             break;
-            
+        
         case AST_IDENTIFIER:
             free(node->identifier.value);
             break;
-            
+        
         case AST_STRING:
             free(node->string.value);
             break;
-            
+        
         case AST_ARRAY_ACCESS:
             free_ast(node->array_access.array);
             free_ast(node->array_access.index);
             break;
-            
+        
         case AST_MEMBER_ACCESS:
             free_ast(node->member_access.object);
             free(node->member_access.member);
             break;
-            
+        
+        case AST_PARALLEL:
+            for (int i = 0; i < node->parallel.reduction_count; i++) {
+                free_ast(node->parallel.reductions[i]);
+            }
+            free(node->parallel.reductions);
+            break;
+        
+        case AST_REDUCTION:
+            free(node->reduction.operator);
+            free(node->reduction.name);
+            break;
+        
+        case AST_SPAWN:
+            free_ast(node->spawn.call);
+            break;
+        
+        case AST_YIELD:
+            free_ast(node->yield_stmt.value);
+            break;
+        
         default:
             // Handle other node types
             break;
@@ -199,6 +221,121 @@ ASTNode* create_member_access_node(ASTNode* object, char* member) {
     return node;
 }
 
+ASTNode* create_array_access_node(ASTNode* array, ASTNode* index) {
+    ASTNode* node = create_ast_node(AST_ARRAY_ACCESS, 0, 0);
+    node->array_access.array = array;
+    node->array_access.index = index;
+    return node;
+}
+
+// Calls visit on node and everything below it
+void walk_ast(ASTNode* node, void (*visit)(ASTNode* node, void* data), void* data) {
+    if (!node) {
+        return;
+    }
+    
+    visit(node, data);
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->program.statement_count; i++) {
+                walk_ast(node->program.statements[i], visit, data);
+            }
+            break;
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statement_count; i++) {
+                walk_ast(node->block.statements[i], visit, data);
+            }
+            break;
+        case AST_FUNCTION_DEF:
+            walk_ast(node->func_def.body, visit, data);
+            break;
+        case AST_VARIABLE_DECL:
+            walk_ast(node->var_decl.initializer, visit, data);
+            break;
+        case AST_ASSIGNMENT:
+            walk_ast(node->assignment.target, visit, data);
+            walk_ast(node->assignment.value, visit, data);
+            break;
+        case AST_FUNCTION_CALL:
+            for (int i = 0; i < node->func_call.arg_count; i++) {
+                walk_ast(node->func_call.arguments[i], visit, data);
+            }
+            break;
+        case AST_IF_STATEMENT:
+            walk_ast(node->if_stmt.condition, visit, data);
+            walk_ast(node->if_stmt.then_stmt, visit, data);
+            walk_ast(node->if_stmt.else_stmt, visit, data);
+            break;
+        case AST_WHILE_LOOP:
+            walk_ast(node->while_loop.condition, visit, data);
+            walk_ast(node->while_loop.body, visit, data);
+            break;
+        case AST_FOR_LOOP:
+            walk_ast(node->for_loop.init, visit, data);
+            walk_ast(node->for_loop.condition, visit, data);
+            walk_ast(node->for_loop.increment, visit, data);
+            walk_ast(node->for_loop.body, visit, data);
+            walk_ast(node->for_loop.parallel, visit, data);
+            break;
+        case AST_RETURN_STATEMENT:
+            walk_ast(node->return_stmt.value, visit, data);
+            break;
+        case AST_BINARY_OP:
+            walk_ast(node->binary_op.left, visit, data);
+            walk_ast(node->binary_op.right, visit, data);
+            break;
+        case AST_UNARY_OP:
+            walk_ast(node->unary_op.operand, visit, data);
+            break;
+        case AST_ARRAY_ACCESS:
+            walk_ast(node->array_access.array, visit, data);
+            walk_ast(node->array_access.index, visit, data);
+            break;
+        case AST_PARALLEL:
+            for (int i = 0; i < node->parallel.reduction_count; i++) {
+                walk_ast(node->parallel.reductions[i], visit, data);
+            }
+            break;
+        case AST_SPAWN:
+            walk_ast(node->spawn.call, visit, data);
+            break;
+        case AST_YIELD:
+            walk_ast(node->yield_stmt.value, visit, data);
+            break;
+        default:
+            // The object of a member access is the dmo marker, not a variable
+            break;
+    }
+}
+
+static void find_yield(ASTNode* node, void* data) {
+    if (node->type == AST_YIELD) {
+        *(bool*)data = true;
+    }
+}
+
+bool contains_yield(ASTNode* node) {
+    bool found = false;
+    walk_ast(node, find_yield, &found);
+    return found;
+}
+
+const char* static_type_name(StaticType type) {
+    switch (type) {
+        case TYPE_NUMBER: return "number";
+        case TYPE_STRING: return "string";
+        default: return "unknown";
+    }
+}
+
+// Expressions the type checker could type end their line with ": type"
+static void print_type(ASTNode* node) {
+    if (node->static_type != TYPE_UNKNOWN) {
+        printf(" : %s", static_type_name(node->static_type));
+    }
+    printf("\n");
+}
+
 void print_ast(ASTNode* node, int depth) {
     if (!node) return;
     
@@ -214,7 +351,11 @@ void print_ast(ASTNode* node, int depth) {
                 print_ast(node->program.statements[i], depth + 1);
             }
             break;
-            
+        
+        case AST_USE_STATEMENT:
+            printf("USE: %s\n", node->use_stmt.module_name);
+            break;
+        
         case AST_FUNCTION_DEF:
             printf("FUNCTION_DEF: %s %s\n", node->func_def.return_type, node->func_def.name);
             for (int i = 0; i < node->func_def.param_count; i++) {
@@ -222,46 +363,118 @@ void print_ast(ASTNode* node, int depth) {
             }
             print_ast(node->func_def.body, depth + 1);
             break;
-            
+        
         case AST_VARIABLE_DECL:
             printf("VAR_DECL: %s %s\n", node->var_decl.type, node->var_decl.name);
             if (node->var_decl.initializer) {
                 print_ast(node->var_decl.initializer, depth + 1);
             }
             break;
-            
+        
+        case AST_ASSIGNMENT:
+            printf("ASSIGNMENT");
+            print_type(node);
+            print_ast(node->assignment.target, depth + 1);
+            print_ast(node->assignment.value, depth + 1);
+            break;
+        
         case AST_FUNCTION_CALL:
-            printf("FUNC_CALL: %s\n", node->func_call.name);
+            printf("FUNC_CALL: %s", node->func_call.name);
+            print_type(node);
             for (int i = 0; i < node->func_call.arg_count; i++) {
                 print_ast(node->func_call.arguments[i], depth + 1);
             }
             break;
-            
+        
+        case AST_IF_STATEMENT:
+            printf("IF\n");
+            print_ast(node->if_stmt.condition, depth + 1);
+            print_ast(node->if_stmt.then_stmt, depth + 1);
+            print_ast(node->if_stmt.else_stmt, depth + 1);
+            break;
+        
+        case AST_WHILE_LOOP:
+            printf("WHILE\n");
+            print_ast(node->while_loop.condition, depth + 1);
+            print_ast(node->while_loop.body, depth + 1);
+            break;
+        
+        case AST_FOR_LOOP:
+            printf(node->for_loop.parallel ? "PARALLEL_FOR" : "FOR");
+            if (node->for_loop.counted) {
+                printf(" : counted%s%s",
+                       node->for_loop.counted & COUNTED_BOUND_INVARIANT ? ", bound hoisted" : "",
+                       node->for_loop.counted & COUNTED_OBSERVED ? ", variable observed" : "");
+            }
+            printf("\n");
+            print_ast(node->for_loop.init, depth + 1);
+            print_ast(node->for_loop.condition, depth + 1);
+            print_ast(node->for_loop.increment, depth + 1);
+            print_ast(node->for_loop.body, depth + 1);
+            break;
+        
+        case AST_RETURN_STATEMENT:
+            printf("RETURN\n");
+            print_ast(node->return_stmt.value, depth + 1);
+            break;
+        
         case AST_IDENTIFIER:
-            printf("IDENTIFIER: %s\n", node->identifier.value);
+            printf("IDENTIFIER: %s", node->identifier.value);
+            print_type(node);
             break;
-            
+        
         case AST_NUMBER:
-            printf("NUMBER: %.6g\n", node->number.value);
+            printf("NUMBER: %.6g", node->number.value);
+            print_type(node);
             break;
-            
+        
         case AST_STRING:
-            printf("STRING: \"%s\"\n", node->string.value);
+            printf("STRING: \"%s\"", node->string.value);
+            print_type(node);
             break;
-            
+        
         case AST_BINARY_OP:
-            printf("BINARY_OP: %s\n", token_type_to_string(node->binary_op.operator));
+            printf("BINARY_OP: %s", token_type_to_string(node->binary_op.operator));
+            print_type(node);
             print_ast(node->binary_op.left, depth + 1);
             print_ast(node->binary_op.right, depth + 1);
             break;
-            
+        
+        case AST_UNARY_OP:
+            printf("UNARY_OP: %s", token_type_to_string(node->unary_op.operator));
+            print_type(node);
+            print_ast(node->unary_op.operand, depth + 1);
+            break;
+        
+        case AST_ARRAY_ACCESS:
+            printf("ARRAY_ACCESS");
+            print_type(node);
+            print_ast(node->array_access.array, depth + 1);
+            print_ast(node->array_access.index, depth + 1);
+            break;
+        
+        case AST_MEMBER_ACCESS:
+            printf("MEMBER_ACCESS: %s\n", node->member_access.member);
+            print_ast(node->member_access.object, depth + 1);
+            break;
+        
+        case AST_SPAWN:
+            printf("SPAWN\n");
+            print_ast(node->spawn.call, depth + 1);
+            break;
+        
+        case AST_YIELD:
+            printf("YIELD\n");
+            print_ast(node->yield_stmt.value, depth + 1);
+            break;
+        
         case AST_BLOCK:
             printf("BLOCK\n");
             for (int i = 0; i < node->block.statement_count; i++) {
                 print_ast(node->block.statements[i], depth + 1);
             }
             break;
-            
+        
         default:
             printf("UNKNOWN_NODE: %d\n", node->type);
             break;
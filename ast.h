@@ -28,9 +28,21 @@ typedef enum {
     AST_NUMBER,
     AST_STRING,
     AST_ARRAY_ACCESS,
-    AST_MEMBER_ACCESS
+    AST_MEMBER_ACCESS,
+    AST_PARALLEL,
+    AST_REDUCTION,
+    AST_SPAWN,
+    AST_YIELD
 } ASTNodeType;
 
+// Static type of an expression, filled in by check_types (dmo_types.h).
+// TYPE_UNKNOWN when the value may have any type at run time.
+typedef enum {
+    TYPE_UNKNOWN,
+    TYPE_NUMBER,
+    TYPE_STRING
+} StaticType;
+
 // Forward declaration
 typedef struct ASTNode ASTNode;
 
@@ -39,6 +51,7 @@ struct ASTNode {
     ASTNodeType type;
     int line;
     int column;
+    StaticType static_type;
     
     union {
         // Program node
@@ -100,6 +113,8 @@ struct ASTNode {
             ASTNode* condition;
             ASTNode* increment;
             ASTNode* body;
+            ASTNode* parallel;    // AST_PARALLEL for a parallel for, else NULL
+            int counted;          // COUNTED_* flags from analyze_loops (dmo_loops.h), 0 for other loops
         } for_loop;
         
         // Return statement
@@ -150,6 +165,28 @@ struct ASTNode {
             ASTNode* object;
             char* member;
         } member_access;
+        
+        // Parallel clause of a parallel for
+        struct {
+            ASTNode** reductions;
+            int reduction_count;
+        } parallel;
+        
+        // reduce(+: name)
+        struct {
+            char* operator;    // "+", "*", "min" or "max"
+            char* name;
+        } reduction;
+        
+        // spawn f(args)
+        struct {
+            ASTNode* call;
+        } spawn;
+        
+        // yield value; inside a generator function
+        struct {
+            ASTNode* value;
+        } yield_stmt;
     };
 };
 
@@ -157,6 +194,7 @@ struct ASTNode {
 ASTNode* create_ast_node(ASTNodeType type, int line, int column);
 void free_ast(ASTNode* node);
 void print_ast(ASTNode* node, int depth);
+const char* static_type_name(StaticType type);
 ASTNode* create_program_node(ASTNode** statements, int count);
 ASTNode* create_function_def_node(char* return_type, char* name, ASTNode** params, int param_count, ASTNode* body);
 ASTNode* create_variable_decl_node(char* type, char* name, ASTNode* initializer);
@@ -167,5 +205,13 @@ ASTNode* create_identifier_node(char* name);
 ASTNode* create_number_node(double value);
 ASTNode* create_string_node(char* value);
 ASTNode* create_member_access_node(ASTNode* object, char* member);
+ASTNode* create_array_access_node(ASTNode* array, ASTNode* index);
+
+// Calls visit on node and everything below it, except function parameters
+void walk_ast(ASTNode* node, void (*visit)(ASTNode* node, void* data), void* data);
+
+// Whether a yield statement appears anywhere in node, which makes the
+// function whose body it is a generator
+bool contains_yield(ASTNode* node);
 
 #endif // AST_H
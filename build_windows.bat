@@ -33,9 +33,72 @@ if errorlevel 1 goto error
 gcc -Wall -Wextra -std=c99 -g -c dmo_graphs.c -o dmo_graphs.o
 if errorlevel 1 goto error
 
+gcc -Wall -Wextra -std=c99 -g -c dmo_cache.c -o dmo_cache.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_array.c -o dmo_array.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_map.c -o dmo_map.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_output.c -o dmo_output.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_runtime.c -o dmo_runtime.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_embed.c -o dmo_embed.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_source.c -o dmo_source.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_sched.c -o dmo_sched.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_batch.c -o dmo_batch.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_parallel.c -o dmo_parallel.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_http.c -o dmo_http.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_builtins.c -o dmo_builtins.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_vecmath.c -o dmo_vecmath.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_stack.c -o dmo_stack.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_memo.c -o dmo_memo.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_types.c -o dmo_types.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_loops.c -o dmo_loops.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_repl.c -o dmo_repl.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_limits.c -o dmo_limits.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_file.c -o dmo_file.o
+if errorlevel 1 goto error
+
+gcc -Wall -Wextra -std=c99 -g -c dmo_generator.c -o dmo_generator.o
+if errorlevel 1 goto error
+
 REM Link executable
 echo Linking executable...
-gcc -Wall -Wextra -std=c99 -g -o dmo.exe main.o lexer.o parser.o ast.o interpreter.o modules.o stdlib_funcs.o dmo_graphs.o -lm
+gcc -Wall -Wextra -std=c99 -g -o dmo.exe main.o lexer.o parser.o ast.o interpreter.o modules.o stdlib_funcs.o dmo_graphs.o dmo_cache.o dmo_array.o dmo_map.o dmo_output.o dmo_runtime.o dmo_embed.o dmo_source.o dmo_sched.o dmo_batch.o dmo_parallel.o dmo_http.o dmo_builtins.o dmo_vecmath.o dmo_stack.o dmo_memo.o dmo_types.o dmo_loops.o dmo_repl.o dmo_limits.o dmo_file.o dmo_generator.o -lm -lpthread
 if errorlevel 1 goto error
 
 echo.
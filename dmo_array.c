@@ -0,0 +1,581 @@
+/*
+ * DMO Typed Arrays Implementation
+ * Contiguous f64/i64/u8 buffers with bounds-checked indexing and bulk operations
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_array.h"
+#include "dmo_output.h"
+#include "dmo_limits.h"
+#include "dmo_vecmath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define ARRAY_MIN_CAPACITY 8
+
+static size_t element_size(ArrayKind kind) {
+    switch (kind) {
+        case ARRAY_I64:
+            return sizeof(int64_t);
+        case ARRAY_U8:
+            return sizeof(uint8_t);
+        default:
+            return sizeof(double);
+    }
+}
+
+// NULL when the buffer can't be allocated
+DMOArray* array_create(ArrayKind kind, size_t length) {
+    DMOArray* array = malloc(sizeof(DMOArray));
+    if (!array) {
+        return NULL;
+    }
+    array->refcount = 1;
+    array->kind = kind;
+    array->length = length;
+    array->capacity = length < ARRAY_MIN_CAPACITY ? ARRAY_MIN_CAPACITY : length;
+    array->data = calloc(array->capacity, element_size(kind));
+    if (!array->data) {
+        free(array);
+        return NULL;
+    }
+    return array;
+}
+
+// Atomic, since parallel loops and tasks share arrays across threads
+DMOArray* array_retain(DMOArray* array) {
+    __atomic_add_fetch(&array->refcount, 1, __ATOMIC_RELAXED);
+    return array;
+}
+
+void array_release(DMOArray* array) {
+    if (__atomic_sub_fetch(&array->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(array->data);
+        free(array);
+    }
+}
+
+double array_get(const DMOArray* array, size_t index) {
+    switch (array->kind) {
+        case ARRAY_I64:
+            return (double)array->i64[index];
+        case ARRAY_U8:
+            return (double)array->u8[index];
+        default:
+            return array->f64[index];
+    }
+}
+
+void array_set(DMOArray* array, size_t index, double value) {
+    switch (array->kind) {
+        case ARRAY_I64:
+            array->i64[index] = (int64_t)value;
+            break;
+        case ARRAY_U8:
+            array->u8[index] = (uint8_t)(int64_t)value;
+            break;
+        default:
+            array->f64[index] = value;
+            break;
+    }
+}
+
+// Moves the buffer to a new capacity; false (and the array unchanged) when
+// that many elements can't be allocated
+static bool array_reserve(DMOArray* array, size_t capacity) {
+    size_t size = element_size(array->kind);
+    if (capacity > SIZE_MAX / size) {
+        return false;
+    }
+    void* data = realloc(array->data, capacity * size);
+    if (!data) {
+        return false;
+    }
+    array->data = data;
+    array->capacity = capacity;
+    return true;
+}
+
+// Doubles the capacity when full, so a run of pushes costs O(1) each
+bool array_push(DMOArray* array, double value) {
+    if (array->length == array->capacity && !array_reserve(array, array->capacity * 2)) {
+        return false;
+    }
+    array_set(array, array->length++, value);
+    return true;
+}
+
+// Grows or shrinks to length; elements past the old length are zero
+bool array_resize(DMOArray* array, size_t length) {
+    size_t size = element_size(array->kind);
+    if (length > array->capacity && !array_reserve(array, length)) {
+        return false;
+    }
+    if (length > array->length) {
+        memset((char*)array->data + array->length * size, 0, (length - array->length) * size);
+    }
+    array->length = length;
+    return true;
+}
+
+bool array_check_index(const DMOArray* array, Value index, size_t* out_index) {
+    if (index.type != VALUE_NUMBER) {
+        fprintf(stderr, "Error: Array index must be a number\n");
+        return false;
+    }
+    
+    if (index.number < 0 || index.number >= (double)array->length) {
+        fprintf(stderr, "Error: Array index %.6g out of bounds for length %zu\n",
+                index.number, array->length);
+        return false;
+    }
+    
+    *out_index = (size_t)index.number;
+    return true;
+}
+
+const char* array_kind_name(ArrayKind kind) {
+    switch (kind) {
+        case ARRAY_I64:
+            return "i64";
+        case ARRAY_U8:
+            return "u8";
+        default:
+            return "f64";
+    }
+}
+
+void print_array(const DMOArray* array, DMOOutput* out) {
+    output_char(out, '[');
+    for (size_t i = 0; i < array->length; i++) {
+        if (i > 0) {
+            output_write(out, ", ", 2);
+        }
+        output_number(out, array_get(array, i));
+    }
+    output_char(out, ']');
+}
+
+// Bulk kernels. The SSE2 paths keep two accumulators so consecutive adds
+// do not wait on each other; floating point sums may therefore differ from
+// a left-to-right loop in the last bits.
+
+static double sum_f64(const double* data, size_t n) {
+    size_t i = 0;
+    double total = 0;
+
+#ifdef __SSE2__
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(data + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(data + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    total = lanes[0] + lanes[1];
+#endif
+
+    for (; i < n; i++) {
+        total += data[i];
+    }
+    return total;
+}
+
+static int64_t sum_i64(const int64_t* data, size_t n) {
+    size_t i = 0;
+    int64_t total = 0;
+
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i*)(data + i)));
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    total = lanes[0] + lanes[1];
+#endif
+
+    for (; i < n; i++) {
+        total += data[i];
+    }
+    return total;
+}
+
+static uint64_t sum_u8(const uint8_t* data, size_t n) {
+    size_t i = 0;
+    uint64_t total = 0;
+
+#ifdef __SSE2__
+    // psadbw against zero adds each 8 byte half into a 64 bit lane
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(bytes, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    total = lanes[0] + lanes[1];
+#endif
+
+    for (; i < n; i++) {
+        total += data[i];
+    }
+    return total;
+}
+
+static double extreme_f64(const double* data, size_t n, bool want_max) {
+    size_t i = 1;
+    double best = data[0];
+
+#ifdef __SSE2__
+    if (n >= 4) {
+        __m128d acc0 = _mm_loadu_pd(data);
+        __m128d acc1 = _mm_loadu_pd(data + 2);
+        for (i = 4; i + 4 <= n; i += 4) {
+            __m128d v0 = _mm_loadu_pd(data + i);
+            __m128d v1 = _mm_loadu_pd(data + i + 2);
+            acc0 = want_max ? _mm_max_pd(acc0, v0) : _mm_min_pd(acc0, v0);
+            acc1 = want_max ? _mm_max_pd(acc1, v1) : _mm_min_pd(acc1, v1);
+        }
+        double lanes[4];
+        _mm_storeu_pd(lanes, acc0);
+        _mm_storeu_pd(lanes + 2, acc1);
+        best = lanes[0];
+        for (int lane = 1; lane < 4; lane++) {
+            if (want_max ? lanes[lane] > best : lanes[lane] < best) {
+                best = lanes[lane];
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (want_max ? data[i] > best : data[i] < best) {
+            best = data[i];
+        }
+    }
+    return best;
+}
+
+static double extreme_generic(const DMOArray* array, bool want_max) {
+    double best = array_get(array, 0);
+    for (size_t i = 1; i < array->length; i++) {
+        double value = array_get(array, i);
+        if (want_max ? value > best : value < best) {
+            best = value;
+        }
+    }
+    return best;
+}
+
+double array_sum(const DMOArray* array) {
+    switch (array->kind) {
+        case ARRAY_I64:
+            return (double)sum_i64(array->i64, array->length);
+        case ARRAY_U8:
+            return (double)sum_u8(array->u8, array->length);
+        default:
+            return sum_f64(array->f64, array->length);
+    }
+}
+
+// min and max expect a non-empty array
+double array_min(const DMOArray* array) {
+    if (array->kind == ARRAY_F64) {
+        return extreme_f64(array->f64, array->length, false);
+    }
+    return extreme_generic(array, false);
+}
+
+double array_max(const DMOArray* array) {
+    if (array->kind == ARRAY_F64) {
+        return extreme_f64(array->f64, array->length, true);
+    }
+    return extreme_generic(array, true);
+}
+
+// dot expects arrays of equal length
+double array_dot(const DMOArray* a, const DMOArray* b) {
+    size_t n = a->length;
+    size_t i = 0;
+    double total = 0;
+    
+    if (a->kind != ARRAY_F64 || b->kind != ARRAY_F64) {
+        for (; i < n; i++) {
+            total += array_get(a, i) * array_get(b, i);
+        }
+        return total;
+    }
+
+#ifdef __SSE2__
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a->f64 + i), _mm_loadu_pd(b->f64 + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a->f64 + i + 2), _mm_loadu_pd(b->f64 + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    total = lanes[0] + lanes[1];
+#endif
+
+    for (; i < n; i++) {
+        total += a->f64[i] * b->f64[i];
+    }
+    return total;
+}
+
+void array_scale(DMOArray* array, double factor) {
+    size_t n = array->length;
+    size_t i = 0;
+    
+    if (array->kind != ARRAY_F64) {
+        for (; i < n; i++) {
+            array_set(array, i, array_get(array, i) * factor);
+        }
+        return;
+    }
+    
+    double* data = array->f64;
+#ifdef __SSE2__
+    __m128d k = _mm_set1_pd(factor);
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(data + i, _mm_mul_pd(_mm_loadu_pd(data + i), k));
+    }
+#endif
+    for (; i < n; i++) {
+        data[i] *= factor;
+    }
+}
+
+void array_fill(DMOArray* array, double value) {
+    size_t n = array->length;
+    size_t i = 0;
+    
+    if (array->kind == ARRAY_U8) {
+        memset(array->u8, (uint8_t)(int64_t)value, n);
+        return;
+    }
+    if (array->kind == ARRAY_I64) {
+        int64_t fill = (int64_t)value;
+        for (; i < n; i++) {
+            array->i64[i] = fill;
+        }
+        return;
+    }
+    
+    double* data = array->f64;
+#ifdef __SSE2__
+    __m128d v = _mm_set1_pd(value);
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(data + i, v);
+    }
+#endif
+    for (; i < n; i++) {
+        data[i] = value;
+    }
+}
+
+// Element-wise functions accepted by array.map. Those with a dmo_vecmath
+// kernel run over the whole buffer at once, the others element by element.
+static double map_abs(double x) { return fabs(x); }
+
+// Unlike math.sqrt, array.map keeps libm's NaN for negative elements,
+// which is also what the SSE2 square root gives
+static void map_sqrt(const double* in, double* out, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_sqrt_pd(_mm_loadu_pd(in + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = sqrt(in[i]);
+    }
+}
+
+typedef struct {
+    const char* name;
+    void (*kernel)(const double* in, double* out, size_t n);
+    double (*fn)(double);
+} MapFunction;
+
+static const MapFunction map_functions[] = {
+    {"sin", vec_sin, NULL},
+    {"cos", vec_cos, NULL},
+    {"tan", vec_tan, NULL},
+    {"sqrt", map_sqrt, NULL},
+    {"exp", vec_exp, NULL},
+    {"sigmoid", vec_sigmoid, NULL},
+    {"log", NULL, log},
+    {"abs", NULL, map_abs},
+    {"floor", NULL, floor},
+    {"ceil", NULL, ceil},
+    {NULL, NULL, NULL}
+};
+
+// Writes fn of each element of array into mapped, an f64 array of the same length
+static void map_elements(const MapFunction* fn, const DMOArray* array, DMOArray* mapped) {
+    size_t n = array->length;
+    
+    if (!fn->kernel) {
+        for (size_t i = 0; i < n; i++) {
+            mapped->f64[i] = fn->fn(array_get(array, i));
+        }
+        return;
+    }
+    
+    // Other kinds are converted into the result first and mapped in place
+    const double* in = array->f64;
+    if (array->kind != ARRAY_F64) {
+        for (size_t i = 0; i < n; i++) {
+            mapped->f64[i] = array_get(array, i);
+        }
+        in = mapped->f64;
+    }
+    fn->kernel(in, mapped->f64, n);
+}
+
+// Builtins
+
+bool is_array_function(const char* name) {
+    return strncmp(name, "array.", 6) == 0;
+}
+
+static Value array_value(DMOArray* array) {
+    Value value;
+    value.type = VALUE_ARRAY;
+    value.array = array;
+    return value;
+}
+
+static Value array_new(ArrayKind kind, const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    size_t length = 0;
+    
+    if (arg_count > 0) {
+        Value requested = execute_node(args[0], ctx);
+        if (requested.type != VALUE_NUMBER || !(requested.number >= 0)) {
+            fprintf(stderr, "Error: %s() length must be a non-negative number\n", name);
+        } else if (requested.number >= (double)(SIZE_MAX / element_size(kind))) {
+            fprintf(stderr, "Error: %s() cannot allocate %.6g elements\n", name, requested.number);
+            free_value(requested);
+            return create_void_value();
+        } else {
+            length = (size_t)requested.number;
+        }
+        free_value(requested);
+    }
+    
+    if (!charge_alloc(ctx, length * element_size(kind))) {
+        return create_void_value();
+    }
+    DMOArray* array = array_create(kind, length);
+    if (!array) {
+        fprintf(stderr, "Error: %s() cannot allocate %zu elements\n", name, length);
+        return create_void_value();
+    }
+    return array_value(array);
+}
+
+Value call_array_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    const char* op = name + 6;
+    
+    if (strcmp(op, "f64") == 0) {
+        return array_new(ARRAY_F64, name, args, arg_count, ctx);
+    } else if (strcmp(op, "i64") == 0) {
+        return array_new(ARRAY_I64, name, args, arg_count, ctx);
+    } else if (strcmp(op, "u8") == 0) {
+        return array_new(ARRAY_U8, name, args, arg_count, ctx);
+    }
+    
+    if (arg_count < 1) {
+        fprintf(stderr, "Error: %s() requires an array argument\n", name);
+        return create_void_value();
+    }
+    
+    Value target = execute_node(args[0], ctx);
+    if (target.type != VALUE_ARRAY) {
+        fprintf(stderr, "Error: %s() argument must be an array\n", name);
+        free_value(target);
+        return create_void_value();
+    }
+    
+    DMOArray* array = target.array;
+    Value result = create_void_value();
+    
+    if (strcmp(op, "len") == 0) {
+        result = create_number_value((double)array->length);
+    } else if (strcmp(op, "sum") == 0) {
+        result = create_number_value(array_sum(array));
+    } else if (strcmp(op, "min") == 0 || strcmp(op, "max") == 0) {
+        if (array->length == 0) {
+            fprintf(stderr, "Error: %s() of an empty array\n", name);
+            result = create_number_value(0);
+        } else {
+            result = create_number_value(op[1] == 'i' ? array_min(array) : array_max(array));
+        }
+    } else if (strcmp(op, "push") == 0 || strcmp(op, "scale") == 0 || strcmp(op, "fill") == 0) {
+        Value operand = arg_count > 1 ? execute_node(args[1], ctx) : create_void_value();
+        if (operand.type != VALUE_NUMBER) {
+            fprintf(stderr, "Error: %s() requires a number as second argument\n", name);
+        } else if (op[0] == 'p') {
+            if (charge_alloc(ctx, element_size(array->kind)) && !array_push(array, operand.number)) {
+                fprintf(stderr, "Error: %s() cannot allocate %zu elements\n", name, array->length + 1);
+            }
+        } else if (op[0] == 's') {
+            array_scale(array, operand.number);
+        } else {
+            array_fill(array, operand.number);
+        }
+        free_value(operand);
+    } else if (strcmp(op, "dot") == 0) {
+        Value other = arg_count > 1 ? execute_node(args[1], ctx) : create_void_value();
+        if (other.type != VALUE_ARRAY) {
+            fprintf(stderr, "Error: %s() requires two arrays\n", name);
+            result = create_number_value(0);
+        } else if (other.array->length != array->length) {
+            fprintf(stderr, "Error: %s() arrays differ in length (%zu and %zu)\n",
+                    name, array->length, other.array->length);
+            result = create_number_value(0);
+        } else {
+            result = create_number_value(array_dot(array, other.array));
+        }
+        free_value(other);
+    } else if (strcmp(op, "map") == 0) {
+        Value fn_name = arg_count > 1 ? execute_node(args[1], ctx) : create_void_value();
+        const MapFunction* fn = NULL;
+        if (fn_name.type == VALUE_STRING) {
+            for (int i = 0; map_functions[i].name; i++) {
+                if (strcmp(fn_name.string, map_functions[i].name) == 0) {
+                    fn = &map_functions[i];
+                    break;
+                }
+            }
+        }
+        
+        if (!fn) {
+            fprintf(stderr, "Error: %s() needs a function name such as \"sqrt\" or \"sin\"\n", name);
+        } else if (charge_alloc(ctx, array->length * sizeof(double))) {
+            DMOArray* mapped = array_create(ARRAY_F64, array->length);
+            if (!mapped) {
+                fprintf(stderr, "Error: %s() cannot allocate %zu elements\n", name, array->length);
+            } else {
+                map_elements(fn, array, mapped);
+                result = array_value(mapped);
+            }
+        }
+        free_value(fn_name);
+    } else {
+        fprintf(stderr, "Error: Unknown array function '%s'\n", name);
+    }
+    
+    free_value(target);
+    return result;
+}
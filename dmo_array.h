@@ -0,0 +1,64 @@
+/*
+ * DMO Typed Arrays Header
+ * Contiguous f64/i64/u8 buffers with bounds-checked indexing and bulk operations
+ */
+
+#ifndef DMO_ARRAY_H
+#define DMO_ARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "interpreter.h"
+
+// Element storage of an array
+typedef enum {
+    ARRAY_F64,
+    ARRAY_I64,
+    ARRAY_U8
+} ArrayKind;
+
+// Arrays are shared by reference: copy_value takes a reference and
+// free_value drops one, the buffer goes away with the last reference
+struct DMOArray {
+    int refcount;
+    ArrayKind kind;
+    size_t length;
+    size_t capacity;
+    union {
+        double* f64;
+        int64_t* i64;
+        uint8_t* u8;
+        void* data;
+    };
+};
+
+// Lifetime; array_create gives NULL when the buffer can't be allocated
+DMOArray* array_create(ArrayKind kind, size_t length);
+DMOArray* array_retain(DMOArray* array);
+void array_release(DMOArray* array);
+
+// Element access, callers check the index against length. array_push and
+// array_resize return false, leaving the array as it was, when out of memory.
+double array_get(const DMOArray* array, size_t index);
+void array_set(DMOArray* array, size_t index, double value);
+bool array_push(DMOArray* array, double value);
+bool array_resize(DMOArray* array, size_t length);
+bool array_check_index(const DMOArray* array, Value index, size_t* out_index);
+const char* array_kind_name(ArrayKind kind);
+void print_array(const DMOArray* array, DMOOutput* out);
+
+// Bulk kernels, SSE2 where available with scalar fallbacks
+double array_sum(const DMOArray* array);
+double array_min(const DMOArray* array);
+double array_max(const DMOArray* array);
+double array_dot(const DMOArray* a, const DMOArray* b);
+void array_scale(DMOArray* array, double factor);
+void array_fill(DMOArray* array, double value);
+
+// Builtins: array.f64/i64/u8, array.len, array.push, array.sum, array.min,
+// array.max, array.dot, array.scale, array.fill, array.map
+bool is_array_function(const char* name);
+Value call_array_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+#endif // DMO_ARRAY_H
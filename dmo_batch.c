@@ -0,0 +1,306 @@
+/*
+ * DMO Batch Runner Implementation
+ * Runs many independent scripts on a work-stealing pool of interpreters
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_batch.h"
+#include "dmo_source.h"
+#include "dmo_runtime.h"
+#include "dmo_cache.h"
+#include "dmo_output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static bool has_dmo_extension(const char* path) {
+    const char* ext = strrchr(path, '.');
+    return ext && strcmp(ext, ".dmo") == 0;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void add_path(char*** paths, int* count, int* capacity, char* path) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        *paths = realloc(*paths, sizeof(char*) * *capacity);
+    }
+    (*paths)[(*count)++] = path;
+}
+
+// Directory: its .dmo files in name order. Anything else is read as a list
+// with one path per line; blank lines and lines starting with # are skipped.
+static int collect_batch_files(const char* target, char*** out_paths) {
+    char** paths = NULL;
+    int count = 0;
+    int capacity = 0;
+    
+    struct stat st;
+    if (stat(target, &st) != 0) {
+        fprintf(stderr, "Error: Cannot open batch target '%s'\n", target);
+        *out_paths = NULL;
+        return -1;
+    }
+    
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(target);
+        if (!dir) {
+            fprintf(stderr, "Error: Cannot open directory '%s'\n", target);
+            *out_paths = NULL;
+            return -1;
+        }
+        
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (!has_dmo_extension(entry->d_name)) {
+                continue;
+            }
+            char* path = malloc(strlen(target) + strlen(entry->d_name) + 2);
+            sprintf(path, "%s/%s", target, entry->d_name);
+            add_path(&paths, &count, &capacity, path);
+        }
+        closedir(dir);
+        
+        qsort(paths, count, sizeof(char*), compare_paths);
+    } else {
+        size_t length = 0;
+        char* list = read_file(target, &length);
+        if (!list) {
+            *out_paths = NULL;
+            return -1;
+        }
+        
+        char* line = list;
+        while (line < list + length) {
+            char* end = strchr(line, '\n');
+            if (!end) {
+                end = list + length;
+            }
+            
+            // Trim trailing \r and blanks
+            char* last = end;
+            while (last > line && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) {
+                last--;
+            }
+            if (last > line && line[0] != '#') {
+                char* path = malloc(last - line + 1);
+                memcpy(path, line, last - line);
+                path[last - line] = '\0';
+                add_path(&paths, &count, &capacity, path);
+            }
+            line = end + 1;
+        }
+        free(list);
+    }
+    
+    *out_paths = paths;
+    return count;
+}
+
+// Identical sources share one AST. The lock is not held while parsing;
+// if two workers build the same program at once, the second one to
+// finish frees its copy and uses the first.
+static ASTNode* find_or_build_program(BatchJob* job, const SourceBuffer* source) {
+    BatchRun* batch = job->batch;
+    uint64_t hash = dmoc_hash(source->data, source->length);
+    
+    pthread_mutex_lock(&batch->programs_lock);
+    for (BatchProgram* program = batch->programs; program; program = program->next) {
+        if (program->hash == hash && program->length == source->length &&
+            memcmp(program->source, source->data, source->length) == 0) {
+            pthread_mutex_unlock(&batch->programs_lock);
+            job->shared = true;
+            return program->ast;
+        }
+    }
+    pthread_mutex_unlock(&batch->programs_lock);
+    
+    ASTNode* ast = build_program(job->path, source);
+    if (!ast) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&batch->programs_lock);
+    for (BatchProgram* program = batch->programs; program; program = program->next) {
+        if (program->hash == hash && program->length == source->length &&
+            memcmp(program->source, source->data, source->length) == 0) {
+            pthread_mutex_unlock(&batch->programs_lock);
+            free_ast(ast);
+            job->shared = true;
+            return program->ast;
+        }
+    }
+    
+    BatchProgram* program = malloc(sizeof(BatchProgram));
+    program->hash = hash;
+    program->length = source->length;
+    program->source = malloc(source->length);
+    memcpy(program->source, source->data, source->length);
+    program->ast = ast;
+    program->next = batch->programs;
+    batch->programs = program;
+    pthread_mutex_unlock(&batch->programs_lock);
+    
+    return ast;
+}
+
+// report.dmo -> report.out
+static bool write_batch_output(const char* script_path, const char* text, size_t length) {
+    size_t base = strlen(script_path) - strlen(".dmo");
+    char* path = malloc(base + strlen(".out") + 1);
+    memcpy(path, script_path, base);
+    strcpy(path + base, ".out");
+    
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", path);
+        free(path);
+        return false;
+    }
+    
+    bool ok = fwrite(text, 1, length, file) == length;
+    ok = fclose(file) == 0 && ok;
+    free(path);
+    return ok;
+}
+
+static void run_batch_job(void* arg, int worker) {
+    BatchJob* job = arg;
+    BatchRun* batch = job->batch;
+    double start = now_seconds();
+    
+    SourceBuffer source;
+    if (!load_source(job->path, &source)) {
+        job->latency = now_seconds() - start;
+        return;
+    }
+    
+    ASTNode* ast = find_or_build_program(job, &source);
+    release_source(&source);
+    if (!ast) {
+        job->latency = now_seconds() - start;
+        return;
+    }
+    
+    // Runtimes stay with their worker and are reset between scripts, so
+    // modules are set up once per worker rather than once per script
+    if (!batch->runtimes[worker]) {
+        batch->runtimes[worker] = create_runtime(NULL);
+    }
+    DMORuntime* runtime = batch->runtimes[worker];
+    
+    int status = interpret_with_runtime(ast, job->path, runtime);
+    
+    size_t length = 0;
+    const char* text = output_text(&runtime->output, &length);
+    job->ok = write_batch_output(job->path, text, length) && status == 0;
+    reset_runtime(runtime);
+    
+    job->latency = now_seconds() - start;
+}
+
+static int compare_latency(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_batch_summary(BatchRun* batch, int worker_count, double elapsed, unsigned long steals) {
+    int failed = 0;
+    int shared = 0;
+    double* latencies = malloc(sizeof(double) * batch->job_count);
+    
+    for (int i = 0; i < batch->job_count; i++) {
+        BatchJob* job = &batch->jobs[i];
+        if (!job->ok) {
+            fprintf(stderr, "Error: Script '%s' failed\n", job->path);
+            failed++;
+        }
+        if (job->shared) {
+            shared++;
+        }
+        latencies[i] = job->latency;
+    }
+    qsort(latencies, batch->job_count, sizeof(double), compare_latency);
+    
+    int n = batch->job_count;
+    printf("Batch: %d scripts on %d workers in %.3f s (%.1f scripts/s)\n",
+           n, worker_count, elapsed, elapsed > 0 ? n / elapsed : 0.0);
+    printf("  Failed: %d\n", failed);
+    printf("  Shared programs: %d (identical sources parsed once)\n", shared);
+    printf("  Latency: p50 %.3f ms, p95 %.3f ms, max %.3f ms\n",
+           latencies[n / 2] * 1e3, latencies[(n * 95) / 100] * 1e3,
+           latencies[n - 1] * 1e3);
+    printf("  Steals: %lu\n", steals);
+    
+    free(latencies);
+}
+
+int run_batch(const char* target, int worker_count) {
+    char** paths = NULL;
+    int count = collect_batch_files(target, &paths);
+    if (count < 0) {
+        return 1;
+    }
+    if (count == 0) {
+        fprintf(stderr, "Error: No .dmo files in '%s'\n", target);
+        free(paths);
+        return 1;
+    }
+    
+    BatchRun batch;
+    batch.job_count = count;
+    batch.jobs = calloc(count, sizeof(BatchJob));
+    batch.runtimes = calloc(worker_count, sizeof(DMORuntime*));
+    batch.programs = NULL;
+    pthread_mutex_init(&batch.programs_lock, NULL);
+    
+    double start = now_seconds();
+    DMOScheduler* sched = create_scheduler(worker_count);
+    
+    // Deal the scripts out round-robin; workers that finish early steal
+    for (int i = 0; i < count; i++) {
+        batch.jobs[i].batch = &batch;
+        batch.jobs[i].path = paths[i];
+        if (!has_dmo_extension(paths[i])) {
+            fprintf(stderr, "Error: File must have .dmo extension: '%s'\n", paths[i]);
+            continue;
+        }
+        scheduler_submit(sched, i % worker_count, run_batch_job, &batch.jobs[i]);
+    }
+    
+    scheduler_wait(sched);
+    double elapsed = now_seconds() - start;
+    unsigned long steals = sched->steals;
+    free_scheduler(sched);
+    
+    print_batch_summary(&batch, worker_count, elapsed, steals);
+    
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        failed += !batch.jobs[i].ok;
+        free(paths[i]);
+    }
+    for (int i = 0; i < worker_count; i++) {
+        if (batch.runtimes[i]) {
+            free_runtime(batch.runtimes[i]);
+        }
+    }
+    while (batch.programs) {
+        BatchProgram* next = batch.programs->next;
+        free_ast(batch.programs->ast);
+        free(batch.programs->source);
+        free(batch.programs);
+        batch.programs = next;
+    }
+    pthread_mutex_destroy(&batch.programs_lock);
+    free(batch.runtimes);
+    free(batch.jobs);
+    free(paths);
+    
+    return failed > 0 ? 1 : 0;
+}
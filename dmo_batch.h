@@ -0,0 +1,49 @@
+/*
+ * DMO Batch Runner Header
+ * Runs many independent scripts on a work-stealing pool of interpreters
+ */
+
+#ifndef DMO_BATCH_H
+#define DMO_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "interpreter.h"
+#include "dmo_sched.h"
+
+typedef struct BatchRun BatchRun;
+
+typedef struct {
+    BatchRun* batch;
+    char* path;
+    bool ok;
+    bool shared;       // ran a program already parsed for an identical source
+    double latency;    // seconds from loading the source to writing the output
+} BatchJob;
+
+// Parsed programs of the run, keyed by source text. Read-only once built,
+// so every worker can execute the same AST.
+typedef struct BatchProgram {
+    uint64_t hash;
+    size_t length;
+    char* source;
+    ASTNode* ast;
+    struct BatchProgram* next;
+} BatchProgram;
+
+struct BatchRun {
+    BatchJob* jobs;
+    int job_count;
+    DMORuntime** runtimes;    // one per worker, each with its own output sink
+    BatchProgram* programs;
+    pthread_mutex_t programs_lock;
+};
+
+// Runs every .dmo file of a directory, or every path listed one per line
+// in a text file. Each script's output goes to a .out file next to it.
+// Returns 0 when all scripts ran.
+int run_batch(const char* target, int worker_count);
+
+#endif // DMO_BATCH_H
@@ -0,0 +1,381 @@
+/*
+ * DMO Builtin Table Implementation
+ * Hash-indexed lookup of builtin and extension functions by name
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_builtins.h"
+#include "stdlib_funcs.h"
+#include "dmo_graphs.h"
+#include "dmo_array.h"
+#include "dmo_map.h"
+#include "dmo_parallel.h"
+#include "dmo_runtime.h"
+#include "dmo_file.h"
+#include "dmo_generator.h"
+#include "modules.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define BUILTIN_INITIAL_CAPACITY 64
+
+static uint64_t hash_name(const char* name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ULL;
+    }
+    return hash ? hash : 1;
+}
+
+BuiltinTable* create_builtin_table() {
+    BuiltinTable* table = malloc(sizeof(BuiltinTable));
+    table->capacity = BUILTIN_INITIAL_CAPACITY;
+    table->count = 0;
+    table->slots = calloc(table->capacity, sizeof(DMOBuiltin));
+    return table;
+}
+
+void free_builtin_table(BuiltinTable* table) {
+    if (!table) {
+        return;
+    }
+    
+    for (size_t i = 0; i < table->capacity; i++) {
+        free(table->slots[i].name);
+    }
+    free(table->slots);
+    free(table);
+}
+
+static DMOBuiltin* table_slot(const BuiltinTable* table, const char* name, uint64_t hash) {
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)hash & mask;
+    
+    while (table->slots[index].hash != 0) {
+        if (table->slots[index].hash == hash && strcmp(table->slots[index].name, name) == 0) {
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+    return &table->slots[index];
+}
+
+static void table_grow(BuiltinTable* table) {
+    DMOBuiltin* old = table->slots;
+    size_t old_capacity = table->capacity;
+    
+    table->capacity *= 2;
+    table->slots = calloc(table->capacity, sizeof(DMOBuiltin));
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].hash != 0) {
+            *table_slot(table, old[i].name, old[i].hash) = old[i];
+        }
+    }
+    free(old);
+}
+
+bool builtin_table_add(BuiltinTable* table, const char* name, const DMOBuiltin* entry) {
+    // Kept at most half full so probe runs stay short
+    if ((table->count + 1) * 2 > table->capacity) {
+        table_grow(table);
+    }
+    
+    uint64_t hash = hash_name(name);
+    DMOBuiltin* slot = table_slot(table, name, hash);
+    if (slot->hash != 0) {
+        return false;
+    }
+    
+    *slot = *entry;
+    slot->name = strdup(name);
+    slot->hash = hash;
+    table->count++;
+    return true;
+}
+
+const DMOBuiltin* builtin_table_find(const BuiltinTable* table, const char* name) {
+    const DMOBuiltin* slot = table_slot(table, name, hash_name(name));
+    return slot->hash != 0 ? slot : NULL;
+}
+
+static bool signature_letter(char c, bool result) {
+    return c == 'n' || c == 's' || c == 'a' || c == 'm' || c == '?' || (result && c == 'v');
+}
+
+static int letter_type(char c) {
+    switch (c) {
+        case 'n': return VALUE_NUMBER;
+        case 's': return VALUE_STRING;
+        case 'a': return VALUE_ARRAY;
+        case 'm': return VALUE_MAP;
+    }
+    return -1;
+}
+
+bool parse_signature(const char* text, DMOSignature* signature) {
+    memset(signature, 0, sizeof(DMOSignature));
+    if (!signature_letter(text[0], true) || text[1] != '(') {
+        return false;
+    }
+    signature->result = text[0];
+    
+    bool optional = false;
+    const char* p = text + 2;
+    for (; *p && *p != ')'; p++) {
+        if (*p == '|' && !optional) {
+            optional = true;
+            signature->min_args = signature->param_count;
+        } else if (strncmp(p, "...", 3) == 0 && p[3] == ')') {
+            signature->max_args = -1;
+            p += 2;
+        } else if (signature_letter(*p, false) && signature->param_count < DMO_MAX_PARAMS) {
+            signature->types[signature->param_count++] = letter_type(*p);
+        } else {
+            return false;
+        }
+    }
+    if (*p != ')' || p[1] != '\0') {
+        return false;
+    }
+    
+    if (!optional) {
+        signature->min_args = signature->param_count;
+    }
+    if (signature->max_args != -1) {
+        signature->max_args = signature->param_count;
+    }
+    return true;
+}
+
+static const char* type_name(int type) {
+    switch (type) {
+        case VALUE_NUMBER: return "a number";
+        case VALUE_STRING: return "a string";
+        case VALUE_ARRAY: return "an array";
+        case VALUE_MAP: return "a map";
+    }
+    return "a value";
+}
+
+// What a call that failed its checks evaluates to
+static Value empty_result(char result) {
+    switch (result) {
+        case 'n': return create_number_value(0);
+        case 's': return create_string_value("");
+    }
+    return create_void_value();
+}
+
+Value call_value_function(DMOValueFunction function, const DMOSignature* signature,
+                          const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    if (arg_count < signature->min_args ||
+        (signature->max_args >= 0 && arg_count > signature->max_args)) {
+        if (signature->min_args == signature->max_args) {
+            fprintf(stderr, "Error: %s() requires exactly %d argument%s\n",
+                    name, signature->min_args, signature->min_args == 1 ? "" : "s");
+        } else if (arg_count < signature->min_args) {
+            fprintf(stderr, "Error: %s() requires at least %d argument%s\n",
+                    name, signature->min_args, signature->min_args == 1 ? "" : "s");
+        } else {
+            fprintf(stderr, "Error: %s() takes at most %d argument%s\n",
+                    name, signature->max_args, signature->max_args == 1 ? "" : "s");
+        }
+        return empty_result(signature->result);
+    }
+    
+    Value stack_args[BUILTIN_STACK_ARGS];
+    Value* values = arg_count <= BUILTIN_STACK_ARGS ? stack_args : malloc(arg_count * sizeof(Value));
+    
+    bool valid = true;
+    for (int i = 0; i < arg_count; i++) {
+        values[i] = execute_node(args[i], ctx);
+        if (valid && i < signature->param_count && signature->types[i] >= 0 &&
+            values[i].type != (ValueType)signature->types[i]) {
+            fprintf(stderr, "Error: %s() argument %d must be %s\n",
+                    name, i + 1, type_name(signature->types[i]));
+            valid = false;
+        }
+    }
+    
+    Value result = valid ? function(values, arg_count, ctx) : empty_result(signature->result);
+    
+    for (int i = 0; i < arg_count; i++) {
+        if (values[i].type != VALUE_NUMBER) {
+            free_value(values[i]);
+        }
+    }
+    if (values != stack_args) {
+        free(values);
+    }
+    return result;
+}
+
+typedef struct {
+    const char* name;
+    DMONativeFunction native;
+    DMOFamilyFunction family;
+    DMOValueFunction value;
+    const char* signature;
+} CoreBuiltin;
+
+// Every fixed builtin name. Graphics element names such as dmo[i] or
+// dmo_key are built by the script and matched by pattern instead.
+static const CoreBuiltin core_table[] = {
+    {"show.txt", builtin_show_txt, NULL, NULL, NULL},
+    {"scanf", builtin_scanf, NULL, NULL, NULL},
+    {"fget", builtin_fget, NULL, NULL, NULL},
+    {"cls", builtin_system, NULL, NULL, NULL},
+    {"clear", builtin_system, NULL, NULL, NULL},
+    {"system", builtin_system, NULL, NULL, NULL},
+    
+    {"dmo.gr.create.window", NULL, NULL, dmo_gr_create_window, GRAPHICS_WINDOW_SIGNATURE},
+    {"dmo.gr.create.line", NULL, NULL, dmo_gr_create_line, GRAPHICS_LINE_SIGNATURE},
+    {"dmo.gr.create.sqr", NULL, NULL, dmo_gr_create_sqr, GRAPHICS_SQR_SIGNATURE},
+    {"dmo.gr.create.crle", NULL, NULL, dmo_gr_create_crle, GRAPHICS_CRLE_SIGNATURE},
+    {"dmo.gr.display", NULL, NULL, dmo_gr_display, GRAPHICS_DISPLAY_SIGNATURE},
+    
+    {"array.f64", NULL, call_array_function, NULL, NULL},
+    {"array.i64", NULL, call_array_function, NULL, NULL},
+    {"array.u8", NULL, call_array_function, NULL, NULL},
+    {"array.len", NULL, call_array_function, NULL, NULL},
+    {"array.push", NULL, call_array_function, NULL, NULL},
+    {"array.fill", NULL, call_array_function, NULL, NULL},
+    {"array.sum", NULL, call_array_function, NULL, NULL},
+    {"array.min", NULL, call_array_function, NULL, NULL},
+    {"array.max", NULL, call_array_function, NULL, NULL},
+    {"array.dot", NULL, call_array_function, NULL, NULL},
+    {"array.scale", NULL, call_array_function, NULL, NULL},
+    {"array.map", NULL, call_array_function, NULL, NULL},
+    
+    {"map.new", NULL, call_map_function, NULL, NULL},
+    {"map.len", NULL, call_map_function, NULL, NULL},
+    {"map.get", NULL, call_map_function, NULL, NULL},
+    {"map.set", NULL, call_map_function, NULL, NULL},
+    {"map.has", NULL, call_map_function, NULL, NULL},
+    {"map.delete", NULL, call_map_function, NULL, NULL},
+    {"map.next", NULL, call_map_function, NULL, NULL},
+    {"map.key", NULL, call_map_function, NULL, NULL},
+    {"map.value", NULL, call_map_function, NULL, NULL},
+    
+    {"join", NULL, call_parallel_function, NULL, NULL},
+    
+    {"gen.more", NULL, NULL, gen_more, "n(n)"},
+    {"gen.next", NULL, NULL, gen_next, "?(n)"},
+    {"gen.close", NULL, NULL, gen_close, "v(n)"},
+    
+    {"request.get", NULL, NULL, request_get, "s(s...)"},
+    {"request.post", NULL, NULL, request_post, "s(ss...)"},
+    {"request.get_async", NULL, NULL, request_get_async, "n(s...)"},
+    {"request.post_async", NULL, NULL, request_post_async, "n(ss...)"},
+    {"request.wait_any", NULL, NULL, request_wait_any, "n(...)"},
+    {"request.wait_all", NULL, NULL, request_wait_all, "n(...)"},
+    {"request.result", NULL, NULL, request_result, "s(n)"},
+    {"request.status", NULL, NULL, request_status, "n(n)"},
+    {"request.open", NULL, NULL, request_open, "n(s)"},
+    {"request.more", NULL, NULL, request_more, "n(n)"},
+    {"request.read_line", NULL, NULL, request_read_line, "s(n)"},
+    {"request.read_chunk", NULL, NULL, request_read_chunk, "s(n)"},
+    {"request.close", NULL, NULL, request_close, "v(n)"},
+    {"request.set_concurrency", NULL, NULL, request_set_concurrency, "v(n)"},
+    {"request.set_timeout", NULL, NULL, request_set_timeout, "v(n)"},
+    
+    {"file.open", NULL, NULL, file_open, "n(s|s)"},
+    {"file.more", NULL, NULL, file_more, "n(n)"},
+    {"file.read_line", NULL, NULL, file_read_line, "s(n)"},
+    {"file.read", NULL, NULL, file_read, "s(n|n)"},
+    {"file.write", NULL, NULL, file_write, "v(ns)"},
+    {"file.write_line", NULL, NULL, file_write_line, "v(ns)"},
+    {"file.close", NULL, NULL, file_close, "v(n)"},
+    {"file.count_lines", NULL, NULL, file_count_lines, "n(s)"},
+    
+    {"sin", NULL, NULL, math_sin, "n(n)"},
+    {"cos", NULL, NULL, math_cos, "n(n)"},
+    {"tan", NULL, NULL, math_tan, "n(n)"},
+    {"sigmoid", NULL, NULL, math_sigmoid, "n(n)"},
+    {"sqrt", NULL, NULL, math_sqrt, "n(n)"},
+    {"pow", NULL, NULL, math_pow, "n(nn)"},
+    {"math.sin", NULL, NULL, math_batch_sin, "a(aa)"},
+    {"math.cos", NULL, NULL, math_batch_cos, "a(aa)"},
+    {"math.tan", NULL, NULL, math_batch_tan, "a(aa)"},
+    {"math.sigmoid", NULL, NULL, math_batch_sigmoid, "a(aa)"},
+    {"math.sqrt", NULL, NULL, math_batch_sqrt, "a(aa)"},
+    {"math.pow", NULL, NULL, math_batch_pow, "a(ana)"},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static BuiltinTable* core;
+static pthread_once_t core_once = PTHREAD_ONCE_INIT;
+
+static void build_core_builtins() {
+    core = create_builtin_table();
+    for (int i = 0; core_table[i].name; i++) {
+        DMOBuiltin entry = {NULL, 0, core_table[i].native, core_table[i].family, core_table[i].value, {0}};
+        if (entry.value && !parse_signature(core_table[i].signature, &entry.signature)) {
+            fprintf(stderr, "Error: Bad signature '%s' for builtin %s\n",
+                    core_table[i].signature, core_table[i].name);
+            continue;
+        }
+        builtin_table_add(core, core_table[i].name, &entry);
+    }
+}
+
+const BuiltinTable* core_builtins() {
+    pthread_once(&core_once, build_core_builtins);
+    return core;
+}
+
+const DMOBuiltin* find_builtin(DMORuntime* runtime, const char* name) {
+    const DMOBuiltin* builtin = builtin_table_find(core_builtins(), name);
+    if (!builtin && runtime->extensions) {
+        builtin = builtin_table_find(runtime->extensions, name);
+    }
+    return builtin;
+}
+
+Value invoke_builtin(const DMOBuiltin* builtin, const char* name,
+                     ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    if (builtin->value) {
+        return call_value_function(builtin->value, &builtin->signature, name, args, arg_count, ctx);
+    }
+    if (builtin->native) {
+        return builtin->native(args, arg_count, ctx);
+    }
+    return builtin->family(name, args, arg_count, ctx);
+}
+
+static bool register_entry(const char* name, const DMOBuiltin* entry, InterpreterContext* ctx) {
+    DMORuntime* runtime = ctx->runtime;
+    
+    if (builtin_table_find(core_builtins(), name)) {
+        fprintf(stderr, "Error: Extension function '%s' would replace a builtin\n", name);
+        return false;
+    }
+    
+    if (!runtime->extensions) {
+        runtime->extensions = create_builtin_table();
+    }
+    if (!builtin_table_add(runtime->extensions, name, entry)) {
+        fprintf(stderr, "Error: Extension function '%s' is already registered\n", name);
+        return false;
+    }
+    
+    dmo_log(DMO_LOG_DEBUG, "Registered extension function: %s\n", name);
+    return true;
+}
+
+bool register_function(const char* name, DMONativeFunction function, InterpreterContext* ctx) {
+    DMOBuiltin entry = {NULL, 0, function, NULL, NULL, {0}};
+    return register_entry(name, &entry, ctx);
+}
+
+bool register_value_function(const char* name, const char* signature,
+                             DMOValueFunction function, InterpreterContext* ctx) {
+    DMOBuiltin entry = {NULL, 0, NULL, NULL, function, {0}};
+    if (!parse_signature(signature, &entry.signature)) {
+        fprintf(stderr, "Error: Bad signature '%s' for extension function '%s'\n", signature, name);
+        return false;
+    }
+    return register_entry(name, &entry, ctx);
+}
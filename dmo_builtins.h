@@ -0,0 +1,73 @@
+/*
+ * DMO Builtin Table Header
+ * Hash-indexed lookup of builtin and extension functions by name
+ */
+
+#ifndef DMO_BUILTINS_H
+#define DMO_BUILTINS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "interpreter.h"
+#include "dmo_extension.h"
+
+#define DMO_MAX_PARAMS 16        // declared parameters of a signature
+#define BUILTIN_STACK_ARGS 8     // evaluated arguments kept on the C stack
+
+// A family of builtins sharing one dispatcher that looks at the name
+typedef Value (*DMOFamilyFunction)(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+// A parsed signature, see dmo_extension.h
+typedef struct {
+    char result;                  // letter of the result type
+    int min_args;
+    int max_args;                 // -1 when extra arguments are accepted
+    int param_count;
+    int types[DMO_MAX_PARAMS];    // ValueType of each declared parameter, -1 for any
+} DMOSignature;
+
+// Exactly one of native, family and value is set; value comes with its
+// signature. hash 0 marks an empty slot.
+typedef struct {
+    char* name;
+    uint64_t hash;
+    DMONativeFunction native;
+    DMOFamilyFunction family;
+    DMOValueFunction value;
+    DMOSignature signature;
+} DMOBuiltin;
+
+// Open addressing with linear probing; entries are never removed
+typedef struct BuiltinTable {
+    DMOBuiltin* slots;
+    size_t capacity;     // power of two
+    size_t count;
+} BuiltinTable;
+
+// Function prototypes
+BuiltinTable* create_builtin_table();
+void free_builtin_table(BuiltinTable* table);
+bool builtin_table_add(BuiltinTable* table, const char* name, const DMOBuiltin* entry);
+const DMOBuiltin* builtin_table_find(const BuiltinTable* table, const char* name);
+
+// Every name the interpreter itself provides, built once per process and
+// shared read-only by all runtimes
+const BuiltinTable* core_builtins();
+
+// Looks name up in the builtins, then in the runtime's extensions. NULL
+// means it is a dynamic graphics name or a user-defined function.
+const DMOBuiltin* find_builtin(DMORuntime* runtime, const char* name);
+Value invoke_builtin(const DMOBuiltin* builtin, const char* name,
+                     ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+// Signatures are parsed once, when a function is registered
+bool parse_signature(const char* text, DMOSignature* signature);
+
+// Evaluates the arguments into a Value array, on the stack for up to
+// BUILTIN_STACK_ARGS of them, checks them against the signature and makes
+// the call. name is only used in error messages.
+Value call_value_function(DMOValueFunction function, const DMOSignature* signature,
+                          const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+#endif // DMO_BUILTINS_H
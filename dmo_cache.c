@@ -0,0 +1,635 @@
+/*
+ * DMO Precompiled Program Cache Implementation
+ * Flattens the AST into a position independent .dmoc image and rebuilds it on load
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define DMOC_BYTE_ORDER 0x01020304u
+
+// Growable buffers used while flattening the tree
+typedef struct {
+    DMOCNode* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    
+    uint32_t* lists;
+    uint32_t list_count;
+    uint32_t list_capacity;
+    
+    char* strings;
+    uint32_t string_bytes;
+    uint32_t string_capacity;
+    
+    // Open addressing table of string offsets (+1) for deduplication
+    uint32_t* string_slots;
+    uint32_t slot_capacity;
+    uint32_t slot_used;
+} DMOCWriter;
+
+// Not FNV-1a itself: FNV's constants, but eight bytes are xored in per
+// multiply and the high half folded down after each, with the tail taken
+// a byte at a time. Images run to megabytes, so a byte-at-a-time hash
+// would dominate load time. Values differ from FNV-1a's.
+uint64_t dmoc_hash(const char* data, size_t length) {
+    uint64_t hash = 1469598103934665603ULL ^ length;
+    size_t i = 0;
+    
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash ^= word;
+        hash *= 1099511628211ULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool dmoc_cache_enabled() {
+    const char* disabled = getenv("DMO_NO_CACHE");
+    return !disabled || strcmp(disabled, "0") == 0;
+}
+
+char* dmoc_cache_path(const char* source_file, uint64_t source_hash) {
+    const char* cache_dir = getenv("DMO_CACHE_DIR");
+    
+    if (cache_dir && cache_dir[0]) {
+        // Content addressed: identical scripts share one entry
+        size_t len = strlen(cache_dir) + 32;
+        char* path = malloc(len);
+        snprintf(path, len, "%s/%016llx.dmoc", cache_dir, (unsigned long long)source_hash);
+        return path;
+    }
+    
+    // Next to the source: hello.dmo -> hello.dmoc
+    size_t len = strlen(source_file);
+    char* path = malloc(len + 2);
+    memcpy(path, source_file, len);
+    path[len] = 'c';
+    path[len + 1] = '\0';
+    return path;
+}
+
+// Serialization
+
+static uint32_t writer_add_string(DMOCWriter* w, const char* str) {
+    if (!str) {
+        return 0;
+    }
+    
+    size_t len = strlen(str);
+    uint64_t hash = dmoc_hash(str, len);
+    
+    // Keep the dedup table at most half full
+    if ((w->slot_used + 1) * 2 > w->slot_capacity) {
+        uint32_t new_capacity = w->slot_capacity ? w->slot_capacity * 2 : 256;
+        uint32_t* new_slots = calloc(new_capacity, sizeof(uint32_t));
+        for (uint32_t i = 0; i < w->slot_capacity; i++) {
+            uint32_t ref = w->string_slots[i];
+            if (!ref) continue;
+            const char* existing = w->strings + ref - 1;
+            uint32_t pos = (uint32_t)dmoc_hash(existing, strlen(existing)) & (new_capacity - 1);
+            while (new_slots[pos]) {
+                pos = (pos + 1) & (new_capacity - 1);
+            }
+            new_slots[pos] = ref;
+        }
+        free(w->string_slots);
+        w->string_slots = new_slots;
+        w->slot_capacity = new_capacity;
+    }
+    
+    uint32_t pos = (uint32_t)hash & (w->slot_capacity - 1);
+    while (w->string_slots[pos]) {
+        uint32_t ref = w->string_slots[pos];
+        if (strcmp(w->strings + ref - 1, str) == 0) {
+            return ref;
+        }
+        pos = (pos + 1) & (w->slot_capacity - 1);
+    }
+    
+    if (w->string_bytes + len + 1 > w->string_capacity) {
+        while (w->string_bytes + len + 1 > w->string_capacity) {
+            w->string_capacity = w->string_capacity ? w->string_capacity * 2 : 1024;
+        }
+        w->strings = realloc(w->strings, w->string_capacity);
+    }
+    
+    uint32_t ref = w->string_bytes + 1;
+    memcpy(w->strings + w->string_bytes, str, len + 1);
+    w->string_bytes += (uint32_t)len + 1;
+    w->string_slots[pos] = ref;
+    w->slot_used++;
+    return ref;
+}
+
+static uint32_t writer_reserve_list(DMOCWriter* w, int count) {
+    if (w->list_count + count > w->list_capacity) {
+        while (w->list_count + count > w->list_capacity) {
+            w->list_capacity = w->list_capacity ? w->list_capacity * 2 : 256;
+        }
+        w->lists = realloc(w->lists, sizeof(uint32_t) * w->list_capacity);
+    }
+    uint32_t offset = w->list_count;
+    w->list_count += count;
+    return offset;
+}
+
+static uint32_t writer_add_node(DMOCWriter* w, ASTNode* node);
+
+static void writer_add_list(DMOCWriter* w, ASTNode** items, int count, uint32_t* offset, uint32_t* out_count) {
+    *offset = writer_reserve_list(w, count);
+    *out_count = (uint32_t)count;
+    for (int i = 0; i < count; i++) {
+        uint32_t child = writer_add_node(w, items[i]);
+        w->lists[*offset + i] = child;
+    }
+}
+
+static uint32_t writer_add_node(DMOCWriter* w, ASTNode* node) {
+    if (!node) {
+        return 0;
+    }
+    
+    if (w->node_count >= w->node_capacity) {
+        w->node_capacity = w->node_capacity ? w->node_capacity * 2 : 256;
+        w->nodes = realloc(w->nodes, sizeof(DMOCNode) * w->node_capacity);
+    }
+    
+    // Reserve the slot first so parents always precede their children
+    uint32_t index = w->node_count++;
+    DMOCNode record;
+    memset(&record, 0, sizeof(record));
+    record.type = node->type;
+    record.line = node->line;
+    record.column = node->column;
+    
+    switch (node->type) {
+        case AST_PROGRAM:
+            writer_add_list(w, node->program.statements, node->program.statement_count, &record.a, &record.b);
+            break;
+        case AST_USE_STATEMENT:
+            record.a = writer_add_string(w, node->use_stmt.module_name);
+            break;
+        case AST_FUNCTION_DEF:
+            record.a = writer_add_string(w, node->func_def.return_type);
+            record.b = writer_add_string(w, node->func_def.name);
+            writer_add_list(w, node->func_def.parameters, node->func_def.param_count, &record.c, &record.d);
+            record.e = writer_add_node(w, node->func_def.body);
+            break;
+        case AST_VARIABLE_DECL:
+            record.a = writer_add_string(w, node->var_decl.type);
+            record.b = writer_add_string(w, node->var_decl.name);
+            record.c = writer_add_node(w, node->var_decl.initializer);
+            break;
+        case AST_ASSIGNMENT:
+            record.a = writer_add_node(w, node->assignment.target);
+            record.b = writer_add_node(w, node->assignment.value);
+            break;
+        case AST_FUNCTION_CALL:
+            record.a = writer_add_string(w, node->func_call.name);
+            writer_add_list(w, node->func_call.arguments, node->func_call.arg_count, &record.b, &record.c);
+            break;
+        case AST_IF_STATEMENT:
+            record.a = writer_add_node(w, node->if_stmt.condition);
+            record.b = writer_add_node(w, node->if_stmt.then_stmt);
+            record.c = writer_add_node(w, node->if_stmt.else_stmt);
+            break;
+        case AST_WHILE_LOOP:
+            record.a = writer_add_node(w, node->while_loop.condition);
+            record.b = writer_add_node(w, node->while_loop.body);
+            break;
+        case AST_FOR_LOOP:
+            record.a = writer_add_node(w, node->for_loop.init);
+            record.b = writer_add_node(w, node->for_loop.condition);
+            record.c = writer_add_node(w, node->for_loop.increment);
+            record.d = writer_add_node(w, node->for_loop.body);
+            record.e = writer_add_node(w, node->for_loop.parallel);
+            break;
+        case AST_RETURN_STATEMENT:
+            record.a = writer_add_node(w, node->return_stmt.value);
+            break;
+        case AST_BLOCK:
+            writer_add_list(w, node->block.statements, node->block.statement_count, &record.a, &record.b);
+            break;
+        case AST_BINARY_OP:
+            record.a = (uint32_t)node->binary_op.operator;
+            record.b = writer_add_node(w, node->binary_op.left);
+            record.c = writer_add_node(w, node->binary_op.right);
+            break;
+        case AST_UNARY_OP:
+            record.a = (uint32_t)node->unary_op.operator;
+            record.b = writer_add_node(w, node->unary_op.operand);
+            break;
+        case AST_IDENTIFIER:
+            record.a = writer_add_string(w, node->identifier.value);
+            break;
+        case AST_NUMBER:
+            memcpy(&record.a, &node->number.value, sizeof(double));
+            break;
+        case AST_STRING:
+            record.a = writer_add_string(w, node->string.value);
+            break;
+        case AST_ARRAY_ACCESS:
+            record.a = writer_add_node(w, node->array_access.array);
+            record.b = writer_add_node(w, node->array_access.index);
+            break;
+        case AST_MEMBER_ACCESS:
+            record.a = writer_add_node(w, node->member_access.object);
+            record.b = writer_add_string(w, node->member_access.member);
+            break;
+        case AST_PARALLEL:
+            writer_add_list(w, node->parallel.reductions, node->parallel.reduction_count, &record.a, &record.b);
+            break;
+        case AST_REDUCTION:
+            record.a = writer_add_string(w, node->reduction.operator);
+            record.b = writer_add_string(w, node->reduction.name);
+            break;
+        case AST_SPAWN:
+            record.a = writer_add_node(w, node->spawn.call);
+            break;
+        case AST_YIELD:
+            record.a = writer_add_node(w, node->yield_stmt.value);
+            break;
+        default:
+            break;
+    }
+    
+    w->nodes[index] = record;
+    return index + 1;
+}
+
+void* dmoc_serialize(ASTNode* ast, uint64_t source_hash, uint64_t source_size, size_t* out_size) {
+    DMOCWriter w;
+    memset(&w, 0, sizeof(w));
+    
+    uint32_t root = writer_add_node(&w, ast);
+    
+    size_t size = sizeof(DMOCHeader) +
+                  sizeof(DMOCNode) * w.node_count +
+                  sizeof(uint32_t) * w.list_count +
+                  w.string_bytes;
+    char* image = malloc(size);
+    
+    DMOCHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DMOC_MAGIC, 4);
+    header.version = DMOC_VERSION;
+    header.byte_order = DMOC_BYTE_ORDER;
+    header.node_size = sizeof(DMOCNode);
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.node_count = w.node_count;
+    header.list_count = w.list_count;
+    header.string_bytes = w.string_bytes;
+    header.root = root;
+    
+    char* cursor = image;
+    memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    if (w.node_count) memcpy(cursor, w.nodes, sizeof(DMOCNode) * w.node_count);
+    cursor += sizeof(DMOCNode) * w.node_count;
+    if (w.list_count) memcpy(cursor, w.lists, sizeof(uint32_t) * w.list_count);
+    cursor += sizeof(uint32_t) * w.list_count;
+    if (w.string_bytes) memcpy(cursor, w.strings, w.string_bytes);
+    
+    ((DMOCHeader*)image)->image_hash = dmoc_hash(image + sizeof(DMOCHeader), size - sizeof(DMOCHeader));
+    
+    free(w.nodes);
+    free(w.lists);
+    free(w.strings);
+    free(w.string_slots);
+    
+    *out_size = size;
+    return image;
+}
+
+// Deserialization
+
+typedef struct {
+    const DMOCNode* records;
+    const uint32_t* lists;
+    const char* strings;
+    const DMOCHeader* header;
+    ASTNode** nodes;
+    bool* claimed;
+    bool failed;
+} DMOCReader;
+
+static char* reader_string(DMOCReader* r, uint32_t ref) {
+    if (ref == 0) {
+        return NULL;
+    }
+    if (ref > r->header->string_bytes) {
+        r->failed = true;
+        return NULL;
+    }
+    return strdup(r->strings + ref - 1);
+}
+
+// Resolves a child reference; each node may be claimed by exactly one parent
+// and children always come after their parent, so a damaged file can never
+// produce a cycle or a shared subtree.
+static ASTNode* reader_child(DMOCReader* r, uint32_t parent, uint32_t ref) {
+    if (ref == 0) {
+        return NULL;
+    }
+    uint32_t index = ref - 1;
+    if (index >= r->header->node_count || index <= parent || r->claimed[index]) {
+        r->failed = true;
+        return NULL;
+    }
+    r->claimed[index] = true;
+    return r->nodes[index];
+}
+
+static ASTNode** reader_list(DMOCReader* r, uint32_t parent, uint32_t offset, uint32_t count) {
+    if (count == 0) {
+        return NULL;
+    }
+    if (offset > r->header->list_count || count > r->header->list_count - offset) {
+        r->failed = true;
+        return NULL;
+    }
+    ASTNode** items = malloc(sizeof(ASTNode*) * count);
+    for (uint32_t i = 0; i < count; i++) {
+        items[i] = reader_child(r, parent, r->lists[offset + i]);
+    }
+    return items;
+}
+
+ASTNode* dmoc_deserialize(const void* data, size_t size, uint64_t expected_hash, uint64_t expected_size) {
+    if (size < sizeof(DMOCHeader)) {
+        return NULL;
+    }
+    
+    const DMOCHeader* header = data;
+    if (memcmp(header->magic, DMOC_MAGIC, 4) != 0 ||
+        header->version != DMOC_VERSION ||
+        header->byte_order != DMOC_BYTE_ORDER ||
+        header->node_size != sizeof(DMOCNode) ||
+        header->source_hash != expected_hash ||
+        header->source_size != expected_size ||
+        header->node_count == 0 ||
+        header->root != 1) {
+        return NULL;
+    }
+    
+    size_t expected = sizeof(DMOCHeader) +
+                      sizeof(DMOCNode) * (size_t)header->node_count +
+                      sizeof(uint32_t) * (size_t)header->list_count +
+                      header->string_bytes;
+    if (expected != size) {
+        return NULL;
+    }
+    
+    // Reject torn or bit-rotted files before trusting any offsets
+    if (dmoc_hash((const char*)data + sizeof(DMOCHeader), size - sizeof(DMOCHeader)) != header->image_hash) {
+        return NULL;
+    }
+    
+    DMOCReader r;
+    r.header = header;
+    r.records = (const DMOCNode*)((const char*)data + sizeof(DMOCHeader));
+    r.lists = (const uint32_t*)(r.records + header->node_count);
+    r.strings = (const char*)(r.lists + header->list_count);
+    r.failed = header->string_bytes > 0 && r.strings[header->string_bytes - 1] != '\0';
+    if (r.failed) {
+        return NULL;
+    }
+    
+    uint32_t count = header->node_count;
+    r.nodes = malloc(sizeof(ASTNode*) * count);
+    r.claimed = calloc(count, sizeof(bool));
+    
+    for (uint32_t i = 0; i < count; i++) {
+        const DMOCNode* rec = &r.records[i];
+        if (rec->type > AST_YIELD) {
+            r.failed = true;
+        }
+        r.nodes[i] = create_ast_node((ASTNodeType)rec->type, rec->line, rec->column);
+    }
+    r.claimed[0] = true;
+    
+    // Single fixup pass: wire children and copy strings out of the mapping
+    for (uint32_t i = 0; i < count && !r.failed; i++) {
+        const DMOCNode* rec = &r.records[i];
+        ASTNode* node = r.nodes[i];
+        
+        switch (node->type) {
+            case AST_PROGRAM:
+                node->program.statements = reader_list(&r, i, rec->a, rec->b);
+                node->program.statement_count = (int)rec->b;
+                break;
+            case AST_USE_STATEMENT:
+                node->use_stmt.module_name = reader_string(&r, rec->a);
+                break;
+            case AST_FUNCTION_DEF:
+                node->func_def.return_type = reader_string(&r, rec->a);
+                node->func_def.name = reader_string(&r, rec->b);
+                node->func_def.parameters = reader_list(&r, i, rec->c, rec->d);
+                node->func_def.param_count = (int)rec->d;
+                node->func_def.body = reader_child(&r, i, rec->e);
+                break;
+            case AST_VARIABLE_DECL:
+                node->var_decl.type = reader_string(&r, rec->a);
+                node->var_decl.name = reader_string(&r, rec->b);
+                node->var_decl.initializer = reader_child(&r, i, rec->c);
+                break;
+            case AST_ASSIGNMENT:
+                node->assignment.target = reader_child(&r, i, rec->a);
+                node->assignment.value = reader_child(&r, i, rec->b);
+                break;
+            case AST_FUNCTION_CALL:
+                node->func_call.name = reader_string(&r, rec->a);
+                node->func_call.arguments = reader_list(&r, i, rec->b, rec->c);
+                node->func_call.arg_count = (int)rec->c;
+                break;
+            case AST_IF_STATEMENT:
+                node->if_stmt.condition = reader_child(&r, i, rec->a);
+                node->if_stmt.then_stmt = reader_child(&r, i, rec->b);
+                node->if_stmt.else_stmt = reader_child(&r, i, rec->c);
+                break;
+            case AST_WHILE_LOOP:
+                node->while_loop.condition = reader_child(&r, i, rec->a);
+                node->while_loop.body = reader_child(&r, i, rec->b);
+                break;
+            case AST_FOR_LOOP:
+                node->for_loop.init = reader_child(&r, i, rec->a);
+                node->for_loop.condition = reader_child(&r, i, rec->b);
+                node->for_loop.increment = reader_child(&r, i, rec->c);
+                node->for_loop.body = reader_child(&r, i, rec->d);
+                node->for_loop.parallel = reader_child(&r, i, rec->e);
+                break;
+            case AST_RETURN_STATEMENT:
+                node->return_stmt.value = reader_child(&r, i, rec->a);
+                break;
+            case AST_BLOCK:
+                node->block.statements = reader_list(&r, i, rec->a, rec->b);
+                node->block.statement_count = (int)rec->b;
+                break;
+            case AST_BINARY_OP:
+                node->binary_op.operator = (TokenType)rec->a;
+                node->binary_op.left = reader_child(&r, i, rec->b);
+                node->binary_op.right = reader_child(&r, i, rec->c);
+                break;
+            case AST_UNARY_OP:
+                node->unary_op.operator = (TokenType)rec->a;
+                node->unary_op.operand = reader_child(&r, i, rec->b);
+                break;
+            case AST_IDENTIFIER:
+                node->identifier.value = reader_string(&r, rec->a);
+                break;
+            case AST_NUMBER:
+                memcpy(&node->number.value, &rec->a, sizeof(double));
+                break;
+            case AST_STRING:
+                node->string.value = reader_string(&r, rec->a);
+                break;
+            case AST_ARRAY_ACCESS:
+                node->array_access.array = reader_child(&r, i, rec->a);
+                node->array_access.index = reader_child(&r, i, rec->b);
+                break;
+            case AST_MEMBER_ACCESS:
+                node->member_access.object = reader_child(&r, i, rec->a);
+                node->member_access.member = reader_string(&r, rec->b);
+                break;
+            case AST_PARALLEL:
+                node->parallel.reductions = reader_list(&r, i, rec->a, rec->b);
+                node->parallel.reduction_count = (int)rec->b;
+                break;
+            case AST_REDUCTION:
+                node->reduction.operator = reader_string(&r, rec->a);
+                node->reduction.name = reader_string(&r, rec->b);
+                break;
+            case AST_SPAWN:
+                node->spawn.call = reader_child(&r, i, rec->a);
+                break;
+            case AST_YIELD:
+                node->yield_stmt.value = reader_child(&r, i, rec->a);
+                break;
+            default:
+                break;
+        }
+    }
+    
+    ASTNode* root = r.nodes[0];
+    
+    if (r.failed) {
+        // Free claimed subtrees through the root, then any orphans
+        for (uint32_t i = 1; i < count; i++) {
+            if (!r.claimed[i]) {
+                free_ast(r.nodes[i]);
+            }
+        }
+        free_ast(root);
+        root = NULL;
+    }
+    
+    free(r.nodes);
+    free(r.claimed);
+    return root;
+}
+
+// Cache files
+
+ASTNode* load_cached_program(const char* source_file, const char* source, size_t length) {
+    if (!dmoc_cache_enabled()) {
+        return NULL;
+    }
+    
+    uint64_t hash = dmoc_hash(source, length);
+    char* path = dmoc_cache_path(source_file, hash);
+    ASTNode* ast = NULL;
+
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(DMOCHeader)) {
+            void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                ast = dmoc_deserialize(map, st.st_size, hash, length);
+                munmap(map, st.st_size);
+            }
+        }
+        close(fd);
+    }
+#else
+    FILE* file = fopen(path, "rb");
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (size >= (long)sizeof(DMOCHeader)) {
+            char* buffer = malloc(size);
+            if (fread(buffer, 1, size, file) == (size_t)size) {
+                ast = dmoc_deserialize(buffer, size, hash, length);
+            }
+            free(buffer);
+        }
+        fclose(file);
+    }
+#endif
+
+    free(path);
+    return ast;
+}
+
+bool save_cached_program(const char* source_file, const char* source, size_t length, ASTNode* ast) {
+    if (!ast || !dmoc_cache_enabled()) {
+        return false;
+    }
+    
+    uint64_t hash = dmoc_hash(source, length);
+    char* path = dmoc_cache_path(source_file, hash);
+    
+    size_t size;
+    void* image = dmoc_serialize(ast, hash, length, &size);
+    
+    // Write to a private temp file and rename, so concurrent runs of the
+    // same script never observe a half written cache entry. The image
+    // address keeps runtimes on different threads of one process apart.
+    size_t tmp_len = strlen(path) + 48;
+    char* tmp_path = malloc(tmp_len);
+#ifndef _WIN32
+    snprintf(tmp_path, tmp_len, "%s.%ld.%lx.tmp", path, (long)getpid(), (unsigned long)(uintptr_t)image);
+#else
+    snprintf(tmp_path, tmp_len, "%s.%lx.tmp", path, (unsigned long)(uintptr_t)image);
+#endif
+
+    bool saved = false;
+    FILE* file = fopen(tmp_path, "wb");
+    if (file) {
+        bool written = fwrite(image, 1, size, file) == size;
+        written = fclose(file) == 0 && written;
+#ifdef _WIN32
+        remove(path);
+#endif
+        if (written && rename(tmp_path, path) == 0) {
+            saved = true;
+        } else {
+            remove(tmp_path);
+        }
+    }
+    
+    free(tmp_path);
+    free(image);
+    free(path);
+    return saved;
+}
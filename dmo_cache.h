@@ -0,0 +1,55 @@
+/*
+ * DMO Precompiled Program Cache Header
+ * Serializes parsed programs to .dmoc files so unchanged scripts skip lexing and parsing
+ */
+
+#ifndef DMO_CACHE_H
+#define DMO_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "ast.h"
+
+// Bump whenever the on-disk layout or the AST shape changes
+#define DMOC_VERSION 4
+#define DMOC_MAGIC "DMOC"
+
+// File header, followed by the node table, the child list table and the string table
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;     // 0x01020304 as written by the producing machine
+    uint32_t node_size;      // sizeof(DMOCNode), guards against layout drift
+    uint64_t source_hash;    // dmoc_hash of the source text
+    uint64_t source_size;
+    uint64_t image_hash;     // dmoc_hash of everything after the header
+    uint32_t node_count;
+    uint32_t list_count;     // entries in the child list table
+    uint32_t string_bytes;
+    uint32_t root;           // node index + 1
+    uint32_t reserved;
+} DMOCHeader;
+
+// Flat 32 byte node record. Child references are node index + 1 (0 = NULL),
+// strings are string table offset + 1 (0 = NULL), lists are (offset, count)
+// pairs into the child list table. Number literals keep their double in (a, b).
+typedef struct {
+    uint32_t type;
+    int32_t line;
+    int32_t column;
+    uint32_t a, b, c, d, e;
+} DMOCNode;
+
+// Function prototypes
+uint64_t dmoc_hash(const char* data, size_t length);
+char* dmoc_cache_path(const char* source_file, uint64_t source_hash);
+ASTNode* load_cached_program(const char* source_file, const char* source, size_t length);
+bool save_cached_program(const char* source_file, const char* source, size_t length, ASTNode* ast);
+bool dmoc_cache_enabled();
+
+// Lower level entry points, used by the cache and by tools that ship .dmoc files
+ASTNode* dmoc_deserialize(const void* data, size_t size, uint64_t expected_hash, uint64_t expected_size);
+void* dmoc_serialize(ASTNode* ast, uint64_t source_hash, uint64_t source_size, size_t* out_size);
+
+#endif // DMO_CACHE_H
@@ -0,0 +1,84 @@
+/*
+ * DMO Embedding API Implementation
+ * Compile scripts once and run them many times inside a host program
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_embed.h"
+#include "dmo_runtime.h"
+#include "lexer.h"
+#include "parser.h"
+#include "dmo_types.h"
+#include "dmo_loops.h"
+#include <stdlib.h>
+
+struct DMOProgram {
+    ASTNode* ast;
+};
+
+DMORuntime* dmo_open() {
+    return create_runtime(NULL);
+}
+
+void dmo_close(DMORuntime* runtime) {
+    free_runtime(runtime);
+}
+
+DMOProgram* dmo_compile(const char* source, size_t length) {
+    TokenList* tokens = tokenize_buffer(source, length);
+    if (!tokens) {
+        return NULL;
+    }
+    
+    // The AST keeps copies of everything it needs, so neither the tokens
+    // nor the caller's source have to outlive it
+    ASTNode* ast = parse(tokens);
+    free_token_list(tokens);
+    if (!ast) {
+        return NULL;
+    }
+    check_types(ast);
+    analyze_loops(ast);
+    
+    DMOProgram* program = malloc(sizeof(DMOProgram));
+    program->ast = ast;
+    return program;
+}
+
+void dmo_free_program(DMOProgram* program) {
+    if (!program) {
+        return;
+    }
+    free_ast(program->ast);
+    free(program);
+}
+
+void dmo_set_number(DMORuntime* runtime, const char* name, double value) {
+    set_runtime_global(runtime, name, "int", create_number_value(value));
+}
+
+void dmo_set_string(DMORuntime* runtime, const char* name, const char* value) {
+    Value text = create_string_value(value);
+    set_runtime_global(runtime, name, "string", text);
+    free_value(text);
+}
+
+void dmo_set_limits(DMORuntime* runtime, const DMOLimits* limits) {
+    runtime->limits = *limits;
+}
+
+void dmo_set_jobs(DMORuntime* runtime, int jobs) {
+    runtime->jobs = jobs;
+}
+
+int dmo_run(DMORuntime* runtime, const DMOProgram* program) {
+    return interpret_with_runtime(program->ast, "<embedded>", runtime);
+}
+
+const char* dmo_get_output(DMORuntime* runtime, size_t* length) {
+    return output_text(&runtime->output, length);
+}
+
+void dmo_reset(DMORuntime* runtime) {
+    reset_runtime(runtime);
+}
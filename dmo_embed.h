@@ -0,0 +1,45 @@
+/*
+ * DMO Embedding API Header
+ * Compile scripts once and run them many times inside a host program
+ */
+
+#ifndef DMO_EMBED_H
+#define DMO_EMBED_H
+
+#include <stddef.h>
+#include "interpreter.h"
+#include "dmo_limits.h"
+
+// A parsed script. It is read-only while running, so one program can be
+// run on any number of runtimes, also from different threads.
+typedef struct DMOProgram DMOProgram;
+
+// Runtimes made by dmo_open capture their output in memory. Keep one per
+// thread and reuse it: modules stay loaded between runs.
+DMORuntime* dmo_open();
+void dmo_close(DMORuntime* runtime);
+
+// Returns NULL and reports to stderr when the source doesn't parse
+DMOProgram* dmo_compile(const char* source, size_t length);
+void dmo_free_program(DMOProgram* program);
+
+// Globals visible to every following run, until dmo_reset
+void dmo_set_number(DMORuntime* runtime, const char* name, double value);
+void dmo_set_string(DMORuntime* runtime, const char* name, const char* value);
+
+// Limits of each following run, all 0 for none. A runtime starts with
+// dmo_limits. A run that reaches one is stopped, reports it on stderr and
+// returns non-zero.
+void dmo_set_limits(DMORuntime* runtime, const DMOLimits* limits);
+
+// Worker threads of parallel for and spawn, 0 (the default) for DMO_JOBS
+// or one per core. Only counts before the runtime's first parallel run.
+void dmo_set_jobs(DMORuntime* runtime, int jobs);
+
+// Runs the program, calling main() if it has one. Output accumulates
+// until dmo_reset; the returned text stays valid until the next call.
+int dmo_run(DMORuntime* runtime, const DMOProgram* program);
+const char* dmo_get_output(DMORuntime* runtime, size_t* length);
+void dmo_reset(DMORuntime* runtime);
+
+#endif // DMO_EMBED_H
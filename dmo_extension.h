@@ -0,0 +1,48 @@
+/*
+ * DMO Extension Header
+ * What a native extension needs to add functions to the language
+ *
+ * An extension is a shared object named <module>.so on the module search
+ * path (DMO_PATH, then ".", then "extensions"). `use <module>;` loads it
+ * and calls its init_<module>_extension(ctx), which registers functions:
+ *
+ *     gcc -shared -fPIC -I. my_ext.c -o my_ext.so
+ *
+ * The extension calls back into the interpreter (execute_node,
+ * create_string_value, ...), so dmo must be linked with -rdynamic.
+ * Extensions are loaded with dlopen and are not available on Windows;
+ * see example_extension.c for a complete one.
+ */
+
+#ifndef DMO_EXTENSION_H
+#define DMO_EXTENSION_H
+
+#include "interpreter.h"
+
+// Arguments arrive unevaluated; the function runs execute_node on each
+// one it needs and frees the values it gets back
+typedef Value (*DMONativeFunction)(ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+// Arguments arrive evaluated and checked against the signature given at
+// registration. They are borrowed for the call: the function must not free
+// them, and copies with copy_value whatever it keeps.
+typedef Value (*DMOValueFunction)(const Value* args, int arg_count, InterpreterContext* ctx);
+
+// Signatures are "<result>(<parameters>)", one letter per value:
+//   n number, s string, a array, m map, ? any, v void (result only).
+// Parameters after '|' are optional and a trailing "..." accepts any
+// number of extra arguments of any type, e.g. "n(n)", "s(s|s)", "v(n...)".
+// A call that does not match prints an error and returns the empty value
+// of the result type without calling the function.
+
+// Make name callable in the runtime of ctx. They return false if the
+// name is taken by a builtin or another extension, or the signature is
+// malformed.
+bool register_function(const char* name, DMONativeFunction function, InterpreterContext* ctx);
+bool register_value_function(const char* name, const char* signature,
+                             DMOValueFunction function, InterpreterContext* ctx);
+
+// Signature of the init symbol every extension exports
+typedef void (*DMOExtensionInit)(InterpreterContext* ctx);
+
+#endif // DMO_EXTENSION_H
@@ -0,0 +1,442 @@
+/*
+ * DMO File I/O Implementation
+ * Files opened by handle: mapped or buffered reads by line or in bulk, buffered writes
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_file.h"
+#include "dmo_runtime.h"
+#include "dmo_output.h"
+#include "dmo_limits.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const char* find_newline(const char* data, size_t length) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 64 <= length; i += 64) {
+        const __m128i* p = (const __m128i*)(data + i);
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(p), newline);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(p + 1), newline);
+        __m128i c = _mm_cmpeq_epi8(_mm_loadu_si128(p + 2), newline);
+        __m128i d = _mm_cmpeq_epi8(_mm_loadu_si128(p + 3), newline);
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)))) {
+            uint64_t mask = (uint64_t)(unsigned)_mm_movemask_epi8(a) |
+                            (uint64_t)(unsigned)_mm_movemask_epi8(b) << 16 |
+                            (uint64_t)(unsigned)_mm_movemask_epi8(c) << 32 |
+                            (uint64_t)(unsigned)_mm_movemask_epi8(d) << 48;
+            return data + i + __builtin_ctzll(mask);
+        }
+    }
+    for (; i + 16 <= length; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), newline));
+        if (mask) {
+            return data + i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (data[i] == '\n') {
+            return data + i;
+        }
+    }
+    return NULL;
+}
+
+size_t count_newlines(const char* data, size_t length) {
+    size_t i = 0;
+    size_t count = 0;
+
+#ifdef __SSE2__
+    // A compare gives -1 in each matching byte, so subtracting it counts
+    // per byte lane. Four compares a step fill a lane in at most 63 steps,
+    // then psadbw adds the lanes up.
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = _mm_setzero_si128();
+    while (i + 64 <= length) {
+        size_t steps = (length - i) / 64;
+        if (steps > 63) {
+            steps = 63;
+        }
+        
+        __m128i counts = _mm_setzero_si128();
+        for (size_t step = 0; step < steps; step++, i += 64) {
+            const __m128i* p = (const __m128i*)(data + i);
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(_mm_loadu_si128(p), newline));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(_mm_loadu_si128(p + 1), newline));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(_mm_loadu_si128(p + 2), newline));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(_mm_loadu_si128(p + 3), newline));
+        }
+        total = _mm_add_epi64(total, _mm_sad_epu8(counts, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, total);
+    count = lanes[0] + lanes[1];
+#endif
+
+    for (; i < length; i++) {
+        count += data[i] == '\n';
+    }
+    return count;
+}
+
+// Maps a regular file read-only. False for empty files, pipes and devices
+// and anything mmap refuses, which are read through a buffer instead.
+static bool map_file(const char* path, char** data, size_t* length) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    bool mapped = false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            // Lines are read front to back, so the kernel can read ahead
+            // and drop pages behind
+            posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+            *data = map;
+            *length = st.st_size;
+            mapped = true;
+        }
+    }
+    close(fd);
+    return mapped;
+#else
+    (void)path;
+    (void)data;
+    (void)length;
+    return false;
+#endif
+}
+
+static void unmap_file(char* data, size_t length) {
+#ifndef _WIN32
+    munmap(data, length);
+#else
+    (void)data;
+    (void)length;
+#endif
+}
+
+long long count_file_lines(const char* path) {
+    char* data;
+    size_t length;
+    if (map_file(path, &data, &length)) {
+        size_t count = count_newlines(data, length);
+        unmap_file(data, length);
+        return (long long)count;
+    }
+    
+    FILE* stream = fopen(path, "rb");
+    if (!stream) {
+        return -1;
+    }
+    
+    char* buffer = malloc(FILE_BUFFER_SIZE);
+    long long count = 0;
+    size_t read;
+    while ((read = fread(buffer, 1, FILE_BUFFER_SIZE, stream)) > 0) {
+        count += count_newlines(buffer, read);
+    }
+    free(buffer);
+    fclose(stream);
+    return count;
+}
+
+DMOFileTable* create_file_table() {
+    DMOFileTable* table = malloc(sizeof(DMOFileTable));
+    table->files = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    pthread_mutex_init(&table->lock, NULL);
+    return table;
+}
+
+static void close_file(DMOFile* file) {
+    if (file->mapped) {
+        unmap_file(file->data, file->length);
+    } else {
+        free(file->data);
+    }
+    if (file->stream) {
+        fclose(file->stream);
+    }
+    free(file);
+}
+
+void close_all_files(DMOFileTable* table) {
+    pthread_mutex_lock(&table->lock);
+    for (int i = 0; i < table->count; i++) {
+        if (table->files[i]) {
+            close_file(table->files[i]);
+        }
+    }
+    free(table->files);
+    table->files = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    pthread_mutex_unlock(&table->lock);
+}
+
+void free_file_table(DMOFileTable* table) {
+    if (!table) {
+        return;
+    }
+    
+    close_all_files(table);
+    pthread_mutex_destroy(&table->lock);
+    free(table);
+}
+
+static DMOFile* open_file(const char* path, const char* mode) {
+    DMOFile* file = calloc(1, sizeof(DMOFile));
+    if (strcmp(mode, "r") == 0 && map_file(path, &file->data, &file->length)) {
+        file->mapped = true;
+        file->at_end = true;
+        return file;
+    }
+    
+    file->writing = strcmp(mode, "r") != 0;
+    file->stream = fopen(path, strcmp(mode, "r") == 0 ? "rb" : strcmp(mode, "w") == 0 ? "wb" : "ab");
+    if (!file->stream) {
+        free(file);
+        return NULL;
+    }
+    
+    if (file->writing) {
+        setvbuf(file->stream, NULL, _IOFBF, FILE_BUFFER_SIZE);
+    } else {
+        file->capacity = FILE_BUFFER_SIZE;
+        file->data = malloc(file->capacity);
+    }
+    return file;
+}
+
+// Reads more of a stream behind what is still unread, growing the buffer
+// when that fills it. One read at a time, so lines from a pipe are handed
+// out as they arrive. False at the end.
+static bool fill(DMOFile* file) {
+    if (file->at_end) {
+        return false;
+    }
+    
+    if (file->pos > 0) {
+        memmove(file->data, file->data + file->pos, file->length - file->pos);
+        file->length -= file->pos;
+        file->pos = 0;
+    }
+    if (file->length == file->capacity) {
+        file->capacity *= 2;
+        file->data = realloc(file->data, file->capacity);
+    }
+
+#ifndef _WIN32
+    ssize_t count;
+    do {
+        count = read(fileno(file->stream), file->data + file->length, file->capacity - file->length);
+    } while (count < 0 && errno == EINTR);
+#else
+    long count = (long)fread(file->data + file->length, 1, file->capacity - file->length, file->stream);
+#endif
+    if (count <= 0) {
+        file->at_end = true;
+        return false;
+    }
+    file->length += count;
+    return true;
+}
+
+// Finds the next line without its \n or \r\n and moves past it. The line
+// stays in place, in the mapping or the buffer, until the next read.
+static bool next_line(DMOFile* file, const char** start, size_t* length) {
+    size_t scanned = 0;
+    while (true) {
+        const char* begin = file->data + file->pos;
+        size_t available = file->length - file->pos;
+        const char* newline = find_newline(begin + scanned, available - scanned);
+        if (newline) {
+            size_t line = (size_t)(newline - begin);
+            file->pos += line + 1;
+            *start = begin;
+            *length = line > 0 && begin[line - 1] == '\r' ? line - 1 : line;
+            return true;
+        }
+        
+        if (available < FILE_LINE_MAX && fill(file)) {
+            scanned = available;
+            continue;
+        }
+        
+        // The last line has no newline, or the line is too long for one piece
+        *start = file->data + file->pos;
+        *length = available;
+        file->pos += available;
+        return available > 0;
+    }
+}
+
+// Strings are the one copy a line gets, charged to the run's budget
+static Value string_from(const char* start, size_t length, InterpreterContext* ctx) {
+    if (!charge_alloc(ctx, length + 1)) {
+        return create_string_value("");
+    }
+    
+    Value value;
+    value.type = VALUE_STRING;
+    value.string = malloc(length + 1);
+    memcpy(value.string, start, length);
+    value.string[length] = '\0';
+    return value;
+}
+
+static DMOFile* find_file(DMOFileTable* table, int handle) {
+    if (handle < 1 || handle > table->count || !table->files[handle - 1]) {
+        fprintf(stderr, "Error: Unknown or closed file handle %d\n", handle);
+        return NULL;
+    }
+    return table->files[handle - 1];
+}
+
+Value file_open(const Value* args, int arg_count, InterpreterContext* ctx) {
+    const char* mode = arg_count > 1 ? args[1].string : "r";
+    if (strcmp(mode, "r") != 0 && strcmp(mode, "w") != 0 && strcmp(mode, "a") != 0) {
+        fprintf(stderr, "Error: file.open mode must be \"r\", \"w\" or \"a\"\n");
+        return create_number_value(0);
+    }
+    
+    // Opening a FIFO blocks until the other end is opened, so whatever was
+    // printed goes out first
+    output_flush(&ctx->runtime->output);
+    
+    DMOFile* file = open_file(args[0].string, mode);
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", args[0].string);
+        return create_number_value(0);
+    }
+    
+    DMOFileTable* table = runtime_files(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 8;
+        table->files = realloc(table->files, sizeof(DMOFile*) * table->capacity);
+    }
+    table->files[table->count++] = file;
+    int handle = table->count;
+    pthread_mutex_unlock(&table->lock);
+    return create_number_value(handle);
+}
+
+Value file_more(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOFileTable* table = runtime_files(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    DMOFile* file = find_file(table, (int)args[0].number);
+    bool more = file && !file->writing && (file->pos < file->length || fill(file));
+    pthread_mutex_unlock(&table->lock);
+    return create_number_value(more);
+}
+
+Value file_read_line(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOFileTable* table = runtime_files(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    DMOFile* file = find_file(table, (int)args[0].number);
+    const char* start = NULL;
+    size_t length = 0;
+    Value line = file && !file->writing && next_line(file, &start, &length)
+        ? string_from(start, length, ctx) : create_string_value("");
+    pthread_mutex_unlock(&table->lock);
+    return line;
+}
+
+// file.read(h) returns the rest of the file, file.read(h, n) at most n bytes
+Value file_read(const Value* args, int arg_count, InterpreterContext* ctx) {
+    DMOFileTable* table = runtime_files(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    DMOFile* file = find_file(table, (int)args[0].number);
+    if (!file || file->writing) {
+        pthread_mutex_unlock(&table->lock);
+        return create_string_value("");
+    }
+    
+    size_t wanted = arg_count > 1 && args[1].number >= 0 ? (size_t)args[1].number : SIZE_MAX;
+    while (file->length - file->pos < wanted && fill(file)) {
+    }
+    size_t length = file->length - file->pos < wanted ? file->length - file->pos : wanted;
+    Value text = string_from(file->data + file->pos, length, ctx);
+    file->pos += length;
+    pthread_mutex_unlock(&table->lock);
+    return text;
+}
+
+// What is written counts against the run's output limit, checked after
+// each write as for printed text
+static void write_text(int handle, const char* text, bool newline, InterpreterContext* ctx) {
+    DMOFileTable* table = runtime_files(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    DMOFile* file = find_file(table, handle);
+    size_t length = strlen(text);
+    if (file && !file->writing) {
+        fprintf(stderr, "Error: Writing needs a file opened with \"w\" or \"a\"\n");
+    } else if (file) {
+        fwrite(text, 1, length, file->stream);
+        if (newline) {
+            fputc('\n', file->stream);
+        }
+        charge_output(ctx, length + newline);
+    }
+    pthread_mutex_unlock(&table->lock);
+}
+
+Value file_write(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    write_text((int)args[0].number, args[1].string, false, ctx);
+    return create_void_value();
+}
+
+Value file_write_line(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    write_text((int)args[0].number, args[1].string, true, ctx);
+    return create_void_value();
+}
+
+Value file_close(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOFileTable* table = runtime_files(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    int handle = (int)args[0].number;
+    if (find_file(table, handle)) {
+        close_file(table->files[handle - 1]);
+        table->files[handle - 1] = NULL;
+    }
+    pthread_mutex_unlock(&table->lock);
+    return create_void_value();
+}
+
+Value file_count_lines(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    long long count = count_file_lines(args[0].string);
+    if (count < 0) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", args[0].string);
+    }
+    return create_number_value((double)count);
+}
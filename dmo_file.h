@@ -0,0 +1,72 @@
+/*
+ * DMO File I/O Header
+ * Files opened by handle: mapped or buffered reads by line or in bulk, buffered writes
+ */
+
+#ifndef DMO_FILE_H
+#define DMO_FILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "interpreter.h"
+
+#define FILE_BUFFER_SIZE (64 * 1024)      // read and write buffer of a stream
+#define FILE_LINE_MAX (16 * 1024 * 1024)  // longer lines are returned in pieces
+
+// One open file. A regular file opened for reading is mapped whole and
+// lines are cut straight out of the mapping; pipes, devices and files
+// mmap refuses are read through a buffer that holds at least the current
+// line. Files opened for writing go through a FILE_BUFFER_SIZE stdio buffer.
+typedef struct {
+    FILE* stream;        // NULL when mapped
+    bool writing;
+    bool mapped;
+    bool at_end;         // the stream has nothing more to read
+    char* data;          // the mapping, or the read buffer
+    size_t length;       // bytes of data filled
+    size_t pos;          // next unread byte of data
+    size_t capacity;
+} DMOFile;
+
+// Open files of one runtime by handle; handle n is slot n - 1, NULL once
+// closed. Loop chunks and tasks share their runtime's table, hence the lock.
+typedef struct DMOFileTable {
+    DMOFile** files;
+    int count;
+    int capacity;
+    pthread_mutex_t lock;
+} DMOFileTable;
+
+// Function prototypes
+DMOFileTable* create_file_table();
+void free_file_table(DMOFileTable* table);
+
+// Closes every file, flushing what was written
+void close_all_files(DMOFileTable* table);
+
+// Newline scanning, SSE2 where available with scalar fallbacks. 64 bytes
+// are compared per step, so a long line costs a few instructions per
+// cache line.
+const char* find_newline(const char* data, size_t length);
+size_t count_newlines(const char* data, size_t length);
+
+// Lines of a file the way wc -l counts them, without opening a handle.
+// -1 if it can't be read.
+long long count_file_lines(const char* path);
+
+// Builtins: file.open(path, mode) with mode "r" (default), "w" or "a";
+// file.more, file.read_line, file.read(h, max_bytes), file.write(h, text),
+// file.write_line(h, text), file.close and file.count_lines(path). Handles
+// are > 0, 0 when the file can't be opened.
+Value file_open(const Value* args, int arg_count, InterpreterContext* ctx);
+Value file_more(const Value* args, int arg_count, InterpreterContext* ctx);
+Value file_read_line(const Value* args, int arg_count, InterpreterContext* ctx);
+Value file_read(const Value* args, int arg_count, InterpreterContext* ctx);
+Value file_write(const Value* args, int arg_count, InterpreterContext* ctx);
+Value file_write_line(const Value* args, int arg_count, InterpreterContext* ctx);
+Value file_close(const Value* args, int arg_count, InterpreterContext* ctx);
+Value file_count_lines(const Value* args, int arg_count, InterpreterContext* ctx);
+
+#endif // DMO_FILE_H
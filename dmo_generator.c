@@ -0,0 +1,251 @@
+/*
+ * DMO Generator Implementation
+ * Functions that yield: suspended interpreter frames resumed one value at a time
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_generator.h"
+#include "dmo_runtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+DMOGeneratorTable* create_generator_table() {
+    DMOGeneratorTable* table = malloc(sizeof(DMOGeneratorTable));
+    table->generators = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    pthread_mutex_init(&table->lock, NULL);
+    pthread_cond_init(&table->released, NULL);
+    return table;
+}
+
+static void free_generator(DMOGenerator* generator) {
+    if (generator->frame) {
+        free_interpreter_context(generator->frame);
+    }
+    if (generator->has_value) {
+        free_value(generator->value);
+    }
+    free(generator->points);
+    free(generator);
+}
+
+void close_all_generators(DMOGeneratorTable* table) {
+    pthread_mutex_lock(&table->lock);
+    for (int i = 0; i < table->count; i++) {
+        if (table->generators[i]) {
+            free_generator(table->generators[i]);
+        }
+    }
+    free(table->generators);
+    table->generators = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    pthread_mutex_unlock(&table->lock);
+}
+
+void free_generator_table(DMOGeneratorTable* table) {
+    if (!table) {
+        return;
+    }
+    
+    close_all_generators(table);
+    pthread_mutex_destroy(&table->lock);
+    pthread_cond_destroy(&table->released);
+    free(table);
+}
+
+Value create_generator(Function* func, ASTNode* call, InterpreterContext* ctx) {
+    DMOGenerator* generator = calloc(1, sizeof(DMOGenerator));
+    generator->value = create_void_value();
+    
+    // The body sees its parameters and its own variables only, since the
+    // caller's frame may be gone by the time it runs
+    InterpreterContext* frame = create_interpreter_context();
+    frame->global_funcs = visible_functions(ctx);
+    frame->function = func;
+    frame->generator = generator;
+    for (int i = 0; i < func->param_count && i < call->func_call.arg_count; i++) {
+        Value arg_value = execute_node(call->func_call.arguments[i], ctx);
+        ASTNode* param = func->parameters[i];
+        set_variable(frame, param->var_decl.name, param->var_decl.type, arg_value);
+        free_value(arg_value);
+    }
+    generator->frame = frame;
+    
+    DMOGeneratorTable* table = runtime_generators(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 8;
+        table->generators = realloc(table->generators, sizeof(DMOGenerator*) * table->capacity);
+    }
+    table->generators[table->count++] = generator;
+    int handle = table->count;
+    pthread_mutex_unlock(&table->lock);
+    return create_number_value(handle);
+}
+
+Value execute_yield(ASTNode* node, InterpreterContext* ctx) {
+    DMOGenerator* generator = ctx->generator;
+    if (!generator) {
+        fprintf(stderr, "Error: yield outside the body of a generator function\n");
+        return create_void_value();
+    }
+    
+    // Resuming ends here and the body goes on after the yield
+    if (generator->resuming) {
+        generator->resuming = false;
+        return create_void_value();
+    }
+    
+    Value value = execute_node(node->yield_stmt.value, ctx);
+    if (ctx->has_return) {
+        // A limit was hit working out the value
+        free_value(value);
+        return create_void_value();
+    }
+    
+    generator->yielded = true;
+    ctx->has_return = true;
+    free_value(ctx->return_value);
+    ctx->return_value = value;
+    return create_void_value();
+}
+
+// Positions are saved from the yield outwards and taken from the body
+// inwards, so the last one saved is the first one taken
+int resume_position(DMOGenerator* generator, ASTNode* node) {
+    if (!generator->resuming || generator->point_count == 0 ||
+        generator->points[generator->point_count - 1].node != node) {
+        return -1;
+    }
+    return generator->points[--generator->point_count].position;
+}
+
+void save_position(DMOGenerator* generator, ASTNode* node, int position) {
+    if (!generator->yielded) {
+        return;
+    }
+    
+    if (generator->point_count == generator->point_capacity) {
+        generator->point_capacity = generator->point_capacity ? generator->point_capacity * 2 : 8;
+        generator->points = realloc(generator->points, sizeof(ResumePoint) * generator->point_capacity);
+    }
+    generator->points[generator->point_count].node = node;
+    generator->points[generator->point_count].position = position;
+    generator->point_count++;
+}
+
+static DMOGenerator* find_generator(DMOGeneratorTable* table, int handle) {
+    if (handle < 1 || handle > table->count || !table->generators[handle - 1]) {
+        fprintf(stderr, "Error: Unknown or closed generator handle %d\n", handle);
+        return NULL;
+    }
+    return table->generators[handle - 1];
+}
+
+// The generator of handle, marked as resumed by ctx's thread so that no
+// other thread resumes or closes it meanwhile; a thread resuming it
+// already is waited for. NULL when there is none, or when ctx's own
+// thread is resuming it, as when its body asks for its next value.
+static DMOGenerator* claim_generator(DMOGeneratorTable* table, int handle, InterpreterContext* ctx) {
+    pthread_mutex_lock(&table->lock);
+    DMOGenerator* generator = find_generator(table, handle);
+    while (generator && generator->resumer && generator->resumer != ctx->calls) {
+        pthread_cond_wait(&table->released, &table->lock);
+        generator = find_generator(table, handle);
+    }
+    if (generator && generator->resumer) {
+        fprintf(stderr, "Error: Generator %d is already running\n", handle);
+        generator = NULL;
+    } else if (generator) {
+        generator->resumer = ctx->calls;
+    }
+    pthread_mutex_unlock(&table->lock);
+    return generator;
+}
+
+static void release_generator(DMOGeneratorTable* table, DMOGenerator* generator) {
+    pthread_mutex_lock(&table->lock);
+    generator->resumer = NULL;
+    pthread_cond_broadcast(&table->released);
+    pthread_mutex_unlock(&table->lock);
+}
+
+// Runs the body to its next yield, unless a value is waiting already.
+// Once the body has ended, returned or been stopped by a limit, its frame
+// is freed and there are no more values.
+static void advance(DMOGenerator* generator, InterpreterContext* ctx) {
+    InterpreterContext* frame = generator->frame;
+    if (generator->has_value || !frame) {
+        return;
+    }
+    
+    generator->resuming = generator->started;
+    generator->started = true;
+    free_value(resume_frame(frame, ctx));
+    
+    if (generator->yielded) {
+        generator->yielded = false;
+        frame->has_return = false;
+        generator->value = frame->return_value;
+        generator->has_value = true;
+        frame->return_value = create_void_value();
+        return;
+    }
+    
+    free_interpreter_context(frame);
+    generator->frame = NULL;
+    generator->point_count = 0;
+    generator->resuming = false;
+}
+
+Value gen_more(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGeneratorTable* table = runtime_generators(ctx->runtime);
+    DMOGenerator* generator = claim_generator(table, (int)args[0].number, ctx);
+    if (!generator) {
+        return create_number_value(0);
+    }
+    
+    advance(generator, ctx);
+    bool more = generator->has_value;
+    release_generator(table, generator);
+    return create_number_value(more);
+}
+
+Value gen_next(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGeneratorTable* table = runtime_generators(ctx->runtime);
+    DMOGenerator* generator = claim_generator(table, (int)args[0].number, ctx);
+    if (!generator) {
+        return create_void_value();
+    }
+    
+    advance(generator, ctx);
+    Value value = create_void_value();
+    if (generator->has_value) {
+        value = generator->value;
+        generator->value = create_void_value();
+        generator->has_value = false;
+    }
+    release_generator(table, generator);
+    return value;
+}
+
+// Closing a generator that hasn't ended drops the rest of its body
+Value gen_close(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGeneratorTable* table = runtime_generators(ctx->runtime);
+    pthread_mutex_lock(&table->lock);
+    int handle = (int)args[0].number;
+    DMOGenerator* generator = find_generator(table, handle);
+    if (generator && generator->resumer) {
+        fprintf(stderr, "Error: Generator %d is running and can't be closed\n", handle);
+    } else if (generator) {
+        free_generator(generator);
+        table->generators[handle - 1] = NULL;
+    }
+    pthread_mutex_unlock(&table->lock);
+    return create_void_value();
+}
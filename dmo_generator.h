@@ -0,0 +1,80 @@
+/*
+ * DMO Generator Header
+ * Functions that yield: suspended interpreter frames resumed one value at a time
+ */
+
+#ifndef DMO_GENERATOR_H
+#define DMO_GENERATOR_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "interpreter.h"
+
+// Where the body of a suspended generator was: the statement of a block,
+// the branch of an if (1 then, 2 else), or 0 for the body of a loop
+typedef struct {
+    ASTNode* node;
+    int position;
+} ResumePoint;
+
+// A call of a function whose body yields. The body runs in a frame of
+// its own that lives from call to call, and nothing of a suspended body
+// stays on the C stack: a yield unwinds to the caller like a return,
+// with each statement on the way out saving its position, and the next
+// resume runs down those positions again, skipping what already ran,
+// until it is back at the yield. Memory so stays that of the frame's
+// variables, however many values the generator produces.
+struct DMOGenerator {
+    InterpreterContext* frame;  // NULL once the body has ended
+    ResumePoint* points;        // innermost first
+    int point_count;
+    int point_capacity;
+    bool started;
+    bool resuming;              // running down to the yield it stopped at
+    bool yielded;               // unwinding from a yield
+    DMOCallStack* resumer;      // calls of the thread resuming it, NULL when none is
+    bool has_value;             // gen.more found a value gen.next hasn't taken
+    Value value;
+};
+
+// Generators of one runtime by handle; handle n is slot n - 1, NULL once
+// closed. Loop chunks and tasks share their runtime's table, hence the
+// lock. A generator is resumed by one thread at a time; others wait for
+// released.
+typedef struct DMOGeneratorTable {
+    DMOGenerator** generators;
+    int count;
+    int capacity;
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+} DMOGeneratorTable;
+
+// Function prototypes
+DMOGeneratorTable* create_generator_table();
+void free_generator_table(DMOGeneratorTable* table);
+
+// Frees every generator. Their frames point at the program's functions,
+// so this runs before those go.
+void close_all_generators(DMOGeneratorTable* table);
+
+// A call of a generator function from ctx: binds the arguments in a new
+// frame without running any of the body and returns the handle
+Value create_generator(Function* func, ASTNode* call, InterpreterContext* ctx);
+
+// yield value; suspends the generator running in ctx
+Value execute_yield(ASTNode* node, InterpreterContext* ctx);
+
+// Called by blocks, ifs and loops of a generator's body. resume_position
+// is the position node saved when the generator is resuming, -1 when it
+// isn't; save_position records one while a yield unwinds.
+int resume_position(DMOGenerator* generator, ASTNode* node);
+void save_position(DMOGenerator* generator, ASTNode* node, int position);
+
+// Builtins: gen.more(g) runs g to its next yield and tells whether there
+// was one, gen.next(g) returns that value (running g first when gen.more
+// wasn't called), void once g has ended, and gen.close(g) frees g
+Value gen_more(const Value* args, int arg_count, InterpreterContext* ctx);
+Value gen_next(const Value* args, int arg_count, InterpreterContext* ctx);
+Value gen_close(const Value* args, int arg_count, InterpreterContext* ctx);
+
+#endif // DMO_GENERATOR_H
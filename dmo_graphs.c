@@ -5,18 +5,15 @@
 
 #define _POSIX_C_SOURCE 200809L
 #include "dmo_graphs.h"
+#include "dmo_output.h"
+#include "dmo_runtime.h"
+#include "dmo_builtins.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static DMOGraphicsContext* graphics_ctx = NULL;
-
-void init_dmo_graphics() {
-    if (graphics_ctx) {
-        return; // Already initialized
-    }
-    
-    graphics_ctx = malloc(sizeof(DMOGraphicsContext));
+DMOGraphicsContext* init_dmo_graphics() {
+    DMOGraphicsContext* graphics_ctx = malloc(sizeof(DMOGraphicsContext));
     graphics_ctx->window_width = 800;
     graphics_ctx->window_height = 600;
     graphics_ctx->window_title = strdup("DMO Graphics Window");
@@ -37,16 +34,17 @@ void init_dmo_graphics() {
     graphics_ctx->input.mouse_x = 0;
     graphics_ctx->input.mouse_y = 0;
     
-    printf("Diamond Graphics Library initialized\n");
+    dmo_log(DMO_LOG_INFO, "Diamond Graphics Library initialized\n");
+    return graphics_ctx;
 }
 
-void cleanup_dmo_graphics() {
+void cleanup_dmo_graphics(DMOGraphicsContext* graphics_ctx) {
     if (!graphics_ctx) {
         return;
     }
     
     if (graphics_ctx->svg_output) {
-        end_svg_output();
+        end_svg_output(graphics_ctx);
     }
     
     // Free elements array
@@ -59,36 +57,35 @@ void cleanup_dmo_graphics() {
     
     free(graphics_ctx->window_title);
     free(graphics_ctx);
-    graphics_ctx = NULL;
     
-    printf("Diamond Graphics Library cleaned up\n");
+    dmo_log(DMO_LOG_INFO, "Diamond Graphics Library cleaned up\n");
 }
 
-void start_svg_output() {
+void start_svg_output(DMOGraphicsContext* graphics_ctx) {
     if (!graphics_ctx || graphics_ctx->svg_output) {
         return;
     }
     
     graphics_ctx->svg_output = fopen(graphics_ctx->svg_filename, "w");
     if (graphics_ctx->svg_output) {
-        write_svg_header();
-        printf("SVG output started: %s\n", graphics_ctx->svg_filename);
+        write_svg_header(graphics_ctx);
+        dmo_log(DMO_LOG_INFO, "SVG output started: %s\n", graphics_ctx->svg_filename);
     }
 }
 
-void end_svg_output() {
+void end_svg_output(DMOGraphicsContext* graphics_ctx) {
     if (!graphics_ctx || !graphics_ctx->svg_output) {
         return;
     }
     
-    write_svg_footer();
+    write_svg_footer(graphics_ctx);
     fclose(graphics_ctx->svg_output);
     graphics_ctx->svg_output = NULL;
     
-    printf("SVG output saved: %s\n", graphics_ctx->svg_filename);
+    dmo_log(DMO_LOG_INFO, "SVG output saved: %s\n", graphics_ctx->svg_filename);
 }
 
-void write_svg_header() {
+void write_svg_header(DMOGraphicsContext* graphics_ctx) {
     if (!graphics_ctx->svg_output) {
         return;
     }
@@ -101,7 +98,7 @@ void write_svg_header() {
         graphics_ctx->window_width, graphics_ctx->window_height, graphics_ctx->window_title);
 }
 
-void write_svg_footer() {
+void write_svg_footer(DMOGraphicsContext* graphics_ctx) {
     if (!graphics_ctx->svg_output) {
         return;
     }
@@ -109,7 +106,17 @@ void write_svg_footer() {
     fprintf(graphics_ctx->svg_output, "</svg>\n");
 }
 
+// Names matched by pattern are not in the builtin table, so their
+// signature is parsed here on each call
+static Value call_graphics(DMOValueFunction function, const char* signature_text, const char* name,
+                           ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    DMOSignature signature;
+    parse_signature(signature_text, &signature);
+    return call_value_function(function, &signature, name, args, arg_count, ctx);
+}
+
 Value call_dmo_graphics_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    DMOGraphicsContext* graphics_ctx = ctx->runtime ? runtime_graphics(ctx->runtime) : NULL;
     if (!graphics_ctx) {
         fprintf(stderr, "Error: Graphics system not initialized\n");
         return create_void_value();
@@ -117,100 +124,86 @@ Value call_dmo_graphics_function(const char* name, ASTNode** args, int arg_count
     
     // Handle dmo.gr.create.window
     if (strstr(name, "dmo.gr.create.window") || strstr(name, "create.window")) {
-        return dmo_gr_create_window(args, arg_count, ctx);
+        return call_graphics(dmo_gr_create_window, GRAPHICS_WINDOW_SIGNATURE, name, args, arg_count, ctx);
     }
     
     // Handle dmo.gr.create.line
     if (strstr(name, "dmo.gr.create.line") || strstr(name, "create.line")) {
-        return dmo_gr_create_line(args, arg_count, ctx);
+        return call_graphics(dmo_gr_create_line, GRAPHICS_LINE_SIGNATURE, name, args, arg_count, ctx);
     }
     
     // Handle dmo.gr.create.sqr
     if (strstr(name, "dmo.gr.create.sqr") || strstr(name, "create.sqr")) {
-        return dmo_gr_create_sqr(args, arg_count, ctx);
+        return call_graphics(dmo_gr_create_sqr, GRAPHICS_SQR_SIGNATURE, name, args, arg_count, ctx);
     }
     
     // Handle dmo.gr.create.crle
     if (strstr(name, "dmo.gr.create.crle") || strstr(name, "create.crle")) {
-        return dmo_gr_create_crle(args, arg_count, ctx);
+        return call_graphics(dmo_gr_create_crle, GRAPHICS_CRLE_SIGNATURE, name, args, arg_count, ctx);
     }
     
     // Handle dmo.gr.display
     if (strstr(name, "dmo.gr.display") || strstr(name, "display")) {
-        return dmo_gr_display(args, arg_count, ctx);
+        return call_graphics(dmo_gr_display, GRAPHICS_DISPLAY_SIGNATURE, name, args, arg_count, ctx);
     }
     
     // Handle input detection functions
     if (strstr(name, "dmo_key")) {
-        return dmo_key_pressed(args, arg_count, ctx);
+        return call_graphics(dmo_key_pressed, "n(s)", name, args, arg_count, ctx);
     }
     
     if (strstr(name, "dmo[") || strstr(name, "dmo_element")) {
-        return dmo_element_pressed(args, arg_count, ctx);
+        return call_graphics(dmo_element_pressed, "n(s)", name, args, arg_count, ctx);
     }
     
     if (strstr(name, "collide")) {
-        return dmo_collide(args, arg_count, ctx);
+        return call_graphics(dmo_collide, "n(ss)", name, args, arg_count, ctx);
     }
     
     fprintf(stderr, "Error: Unknown graphics function '%s'\n", name);
     return create_void_value();
 }
 
-Value dmo_gr_create_window(ASTNode** args, int arg_count, InterpreterContext* ctx) {
+Value dmo_gr_create_window(const Value* args, int arg_count, InterpreterContext* ctx) {
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
+    
     // Parse arguments: title="title", size=349
-    char* title = "DMO Graphics Window";
+    const char* title = "DMO Graphics Window";
     int size = 500;
     
     for (int i = 0; i < arg_count; i++) {
         // For simplicity, assume first arg is title, second is size
-        Value arg = execute_node(args[i], ctx);
-        
-        if (i == 0 && arg.type == VALUE_STRING) {
-            title = arg.string;
-        } else if ((i == 1 || (i == 0 && arg.type == VALUE_NUMBER)) && arg.type == VALUE_NUMBER) {
-            size = (int)arg.number;
-        }
-        
-        if (i > 0 || arg.type != VALUE_STRING) {
-            free_value(arg);
+        if (i == 0 && args[i].type == VALUE_STRING) {
+            title = args[i].string;
+        } else if ((i == 1 || i == 0) && args[i].type == VALUE_NUMBER) {
+            size = (int)args[i].number;
         }
     }
     
     // Update graphics context
     free(graphics_ctx->window_title);
     graphics_ctx->window_title = strdup(title);
+    title = graphics_ctx->window_title;
     graphics_ctx->window_width = size;
     graphics_ctx->window_height = size;
     graphics_ctx->window_created = true;
     
     // Start SVG output
-    start_svg_output();
+    start_svg_output(graphics_ctx);
     
-    printf("Created window: '%s' (size: %dx%d)\n", title, size, size);
+    dmo_log(DMO_LOG_DEBUG, "Created window: '%s' (size: %dx%d)\n", title, size, size);
     
     return create_void_value();
 }
 
-Value dmo_gr_create_line(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count < 1) {
-        fprintf(stderr, "Error: create.line requires at least one argument\n");
-        return create_void_value();
-    }
-    
-    Value length_val = execute_node(args[0], ctx);
-    if (length_val.type != VALUE_NUMBER) {
-        fprintf(stderr, "Error: line length must be a number\n");
-        free_value(length_val);
-        return create_void_value();
-    }
-    
-    int length = (int)length_val.number;
-    free_value(length_val);
+Value dmo_gr_create_line(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
+    int length = (int)args[0].number;
     
     // Ensure SVG output is started
     if (!graphics_ctx->svg_output) {
-        start_svg_output();
+        start_svg_output(graphics_ctx);
     }
     
     // Draw line in SVG (simple horizontal line)
@@ -221,32 +214,24 @@ Value dmo_gr_create_line(ASTNode** args, int arg_count, InterpreterContext* ctx)
             50 + length);
     }
     
-    printf("Created line with length: %d\n", length);
+    dmo_log(DMO_LOG_DEBUG, "Created line with length: %d\n", length);
     
     return create_void_value();
 }
 
-Value dmo_gr_create_sqr(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count < 4) {
-        fprintf(stderr, "Error: create.sqr requires 4 arguments (x, y, width, height)\n");
-        return create_void_value();
-    }
+Value dmo_gr_create_sqr(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
     
+    // x, y, width, height
     int coords[4];
     for (int i = 0; i < 4; i++) {
-        Value val = execute_node(args[i], ctx);
-        if (val.type != VALUE_NUMBER) {
-            fprintf(stderr, "Error: square coordinates must be numbers\n");
-            free_value(val);
-            return create_void_value();
-        }
-        coords[i] = (int)val.number;
-        free_value(val);
+        coords[i] = (int)args[i].number;
     }
     
     // Ensure SVG output is started
     if (!graphics_ctx->svg_output) {
-        start_svg_output();
+        start_svg_output(graphics_ctx);
     }
     
     // Draw rectangle in SVG
@@ -257,42 +242,25 @@ Value dmo_gr_create_sqr(ASTNode** args, int arg_count, InterpreterContext* ctx)
             coords[0], coords[1], coords[2], coords[3]);
     }
     
-    printf("Created square at (%d, %d) with size %dx%d\n", 
-           coords[0], coords[1], coords[2], coords[3]);
+    dmo_log(DMO_LOG_DEBUG, "Created square at (%d, %d) with size %dx%d\n", 
+            coords[0], coords[1], coords[2], coords[3]);
     
     return create_void_value();
 }
 
-Value dmo_gr_create_crle(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count < 1) {
-        fprintf(stderr, "Error: create.crle requires at least one argument\n");
-        return create_void_value();
-    }
-    
-    Value radius_val = execute_node(args[0], ctx);
-    if (radius_val.type != VALUE_NUMBER) {
-        fprintf(stderr, "Error: circle radius must be a number\n");
-        free_value(radius_val);
-        return create_void_value();
-    }
-    
-    int radius = (int)radius_val.number;
-    free_value(radius_val);
-    
+Value dmo_gr_create_crle(const Value* args, int arg_count, InterpreterContext* ctx) {
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
+    int radius = (int)args[0].number;
     int center_x = 150, center_y = 150;
     
     // Check for second argument (might be center position or curve parameter)
-    if (arg_count >= 2) {
-        Value second_val = execute_node(args[1], ctx);
-        if (second_val.type == VALUE_NUMBER) {
-            center_y = (int)second_val.number;
-        }
-        free_value(second_val);
+    if (arg_count >= 2 && args[1].type == VALUE_NUMBER) {
+        center_y = (int)args[1].number;
     }
     
     // Ensure SVG output is started
     if (!graphics_ctx->svg_output) {
-        start_svg_output();
+        start_svg_output(graphics_ctx);
     }
     
     // Draw circle in SVG
@@ -303,14 +271,14 @@ Value dmo_gr_create_crle(ASTNode** args, int arg_count, InterpreterContext* ctx)
                 "  <circle cx=\"%d\" cy=\"%d\" r=\"%d\" "
                 "fill=\"none\" stroke=\"black\" stroke-width=\"2\"/>\n",
                 center_x, center_y, radius);
-            printf("Created circle at (%d, %d) with radius: %d\n", center_x, center_y, radius);
+            dmo_log(DMO_LOG_DEBUG, "Created circle at (%d, %d) with radius: %d\n", center_x, center_y, radius);
         } else {
             // Curve (simplified as an ellipse)
             fprintf(graphics_ctx->svg_output,
                 "  <ellipse cx=\"%d\" cy=\"%d\" rx=\"%d\" ry=\"%d\" "
                 "fill=\"none\" stroke=\"black\" stroke-width=\"2\"/>\n",
                 center_x, center_y, radius, center_y);
-            printf("Created curve with radius: %d, parameter: %d\n", radius, center_y);
+            dmo_log(DMO_LOG_DEBUG, "Created curve with radius: %d, parameter: %d\n", radius, center_y);
         }
     }
     
@@ -318,7 +286,7 @@ Value dmo_gr_create_crle(ASTNode** args, int arg_count, InterpreterContext* ctx)
 }
 
 // Utility functions for graphics
-void add_graphics_element(const char* id, int x, int y, int width, int height, Color color, int type) {
+void add_graphics_element(DMOGraphicsContext* graphics_ctx, const char* id, int x, int y, int width, int height, Color color, int type) {
     if (!graphics_ctx) return;
     
     if (graphics_ctx->element_count >= graphics_ctx->element_capacity) {
@@ -341,7 +309,7 @@ void add_graphics_element(const char* id, int x, int y, int width, int height, C
     element->type = type;
 }
 
-GraphicsElement* find_element_by_id(const char* id) {
+GraphicsElement* find_element_by_id(DMOGraphicsContext* graphics_ctx, const char* id) {
     if (!graphics_ctx || !id) return NULL;
     
     for (int i = 0; i < graphics_ctx->element_count; i++) {
@@ -370,18 +338,9 @@ Color parse_color(int r, int g, int b) {
 }
 
 // Advanced graphics functions
-Value dmo_gr_display(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count < 1) {
-        fprintf(stderr, "Error: display requires at least text argument\n");
-        return create_void_value();
-    }
-    
-    Value text_val = execute_node(args[0], ctx);
-    if (text_val.type != VALUE_STRING) {
-        fprintf(stderr, "Error: display text must be a string\n");
-        free_value(text_val);
-        return create_void_value();
-    }
+Value dmo_gr_display(const Value* args, int arg_count, InterpreterContext* ctx) {
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
+    const char* text = args[0].string;
     
     // Default parameters
     int x = 10, y = 10, width = 100, height = 20;
@@ -391,38 +350,24 @@ Value dmo_gr_display(ASTNode** args, int arg_count, InterpreterContext* ctx) {
     // Parse named parameters (simplified - would need proper parser enhancement)
     // For now, use positional parameters: text, x, y, width, height, r, g, b, id
     if (arg_count >= 3) {
-        Value x_val = execute_node(args[1], ctx);
-        Value y_val = execute_node(args[2], ctx);
-        if (x_val.type == VALUE_NUMBER) x = (int)x_val.number;
-        if (y_val.type == VALUE_NUMBER) y = (int)y_val.number;
-        free_value(x_val);
-        free_value(y_val);
+        if (args[1].type == VALUE_NUMBER) x = (int)args[1].number;
+        if (args[2].type == VALUE_NUMBER) y = (int)args[2].number;
     }
     
     if (arg_count >= 5) {
-        Value w_val = execute_node(args[3], ctx);
-        Value h_val = execute_node(args[4], ctx);
-        if (w_val.type == VALUE_NUMBER) width = (int)w_val.number;
-        if (h_val.type == VALUE_NUMBER) height = (int)h_val.number;
-        free_value(w_val);
-        free_value(h_val);
+        if (args[3].type == VALUE_NUMBER) width = (int)args[3].number;
+        if (args[4].type == VALUE_NUMBER) height = (int)args[4].number;
     }
     
     if (arg_count >= 8) {
-        Value r_val = execute_node(args[5], ctx);
-        Value g_val = execute_node(args[6], ctx);
-        Value b_val = execute_node(args[7], ctx);
-        if (r_val.type == VALUE_NUMBER && g_val.type == VALUE_NUMBER && b_val.type == VALUE_NUMBER) {
-            color = parse_color((int)r_val.number, (int)g_val.number, (int)b_val.number);
+        if (args[5].type == VALUE_NUMBER && args[6].type == VALUE_NUMBER && args[7].type == VALUE_NUMBER) {
+            color = parse_color((int)args[5].number, (int)args[6].number, (int)args[7].number);
         }
-        free_value(r_val);
-        free_value(g_val);
-        free_value(b_val);
     }
     
     // Ensure SVG output is started
     if (!graphics_ctx->svg_output) {
-        start_svg_output();
+        start_svg_output(graphics_ctx);
     }
     
     // Draw text in SVG
@@ -430,60 +375,40 @@ Value dmo_gr_display(ASTNode** args, int arg_count, InterpreterContext* ctx) {
         fprintf(graphics_ctx->svg_output,
             "  <text x=\"%d\" y=\"%d\" font-family=\"Arial\" font-size=\"%d\" "
             "fill=\"rgb(%d,%d,%d)\">%s</text>\n",
-            x, y + height, height, color.r, color.g, color.b, text_val.string);
-        printf("Display text '%s' at (%d, %d) with color rgb(%d,%d,%d)\n", 
-               text_val.string, x, y, color.r, color.g, color.b);
+            x, y + height, height, color.r, color.g, color.b, text);
+        dmo_log(DMO_LOG_DEBUG, "Display text '%s' at (%d, %d) with color rgb(%d,%d,%d)\n", 
+                text, x, y, color.r, color.g, color.b);
     }
     
     // Add to elements list
-    add_graphics_element(id, x, y, width, height, color, 3); // type 3 = text
+    add_graphics_element(graphics_ctx, id, x, y, width, height, color, 3); // type 3 = text
     
-    free_value(text_val);
     return create_void_value();
 }
 
 // Input detection functions
-Value dmo_key_pressed(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count != 1) {
-        fprintf(stderr, "Error: dmo_key requires exactly one argument\n");
-        return create_number_value(0);
-    }
-    
-    Value key_val = execute_node(args[0], ctx);
-    if (key_val.type != VALUE_STRING) {
-        fprintf(stderr, "Error: dmo_key argument must be a string\n");
-        free_value(key_val);
-        return create_number_value(0);
-    }
+Value dmo_key_pressed(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
+    const char* key = args[0].string;
     
     // Simulate key press detection (in real implementation would check actual input)
     // For demo purposes, simulate some key presses
     bool pressed = false;
-    if (strcmp(key_val.string, "a") == 0) {
+    if (strcmp(key, "a") == 0) {
         pressed = graphics_ctx->input.keys['a'];
-    } else if (strcmp(key_val.string, "space") == 0) {
+    } else if (strcmp(key, "space") == 0) {
         pressed = graphics_ctx->input.keys[' '];
     }
     // Add more key mappings as needed
     
-    free_value(key_val);
     return create_number_value(pressed ? 1 : 0);
 }
 
-Value dmo_element_pressed(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count != 1) {
-        fprintf(stderr, "Error: dmo element check requires exactly one argument\n");
-        return create_number_value(0);
-    }
-    
-    Value id_val = execute_node(args[0], ctx);
-    if (id_val.type != VALUE_STRING) {
-        fprintf(stderr, "Error: element ID must be a string\n");
-        free_value(id_val);
-        return create_number_value(0);
-    }
-    
-    GraphicsElement* element = find_element_by_id(id_val.string);
+Value dmo_element_pressed(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
+    GraphicsElement* element = find_element_by_id(graphics_ctx, args[0].string);
     bool pressed = false;
     
     if (element && graphics_ctx->input.mouse_pressed) {
@@ -494,32 +419,16 @@ Value dmo_element_pressed(ASTNode** args, int arg_count, InterpreterContext* ctx
                   graphics_ctx->input.mouse_y <= element->y + element->height);
     }
     
-    free_value(id_val);
     return create_number_value(pressed ? 1 : 0);
 }
 
-Value dmo_collide(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count != 2) {
-        fprintf(stderr, "Error: collide requires exactly two element IDs\n");
-        return create_number_value(0);
-    }
-    
-    Value id1_val = execute_node(args[0], ctx);
-    Value id2_val = execute_node(args[1], ctx);
-    
-    if (id1_val.type != VALUE_STRING || id2_val.type != VALUE_STRING) {
-        fprintf(stderr, "Error: collide arguments must be strings\n");
-        free_value(id1_val);
-        free_value(id2_val);
-        return create_number_value(0);
-    }
-    
-    GraphicsElement* elem1 = find_element_by_id(id1_val.string);
-    GraphicsElement* elem2 = find_element_by_id(id2_val.string);
+Value dmo_collide(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    DMOGraphicsContext* graphics_ctx = runtime_graphics(ctx->runtime);
+    GraphicsElement* elem1 = find_element_by_id(graphics_ctx, args[0].string);
+    GraphicsElement* elem2 = find_element_by_id(graphics_ctx, args[1].string);
     
     bool colliding = check_collision(elem1, elem2);
     
-    free_value(id1_val);
-    free_value(id2_val);
     return create_number_value(colliding ? 1 : 0);
 }
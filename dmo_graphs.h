@@ -47,32 +47,38 @@ typedef struct {
 } DMOGraphicsContext;
 
 // Function prototypes
-void init_dmo_graphics();
-void cleanup_dmo_graphics();
+DMOGraphicsContext* init_dmo_graphics();
+void cleanup_dmo_graphics(DMOGraphicsContext* graphics_ctx);
 Value call_dmo_graphics_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
 
-// Graphics function implementations
-Value dmo_gr_create_window(ASTNode** args, int arg_count, InterpreterContext* ctx);
-Value dmo_gr_create_line(ASTNode** args, int arg_count, InterpreterContext* ctx);
-Value dmo_gr_create_sqr(ASTNode** args, int arg_count, InterpreterContext* ctx);
-Value dmo_gr_create_crle(ASTNode** args, int arg_count, InterpreterContext* ctx);
-Value dmo_gr_display(ASTNode** args, int arg_count, InterpreterContext* ctx);
+// Graphics function implementations. They take evaluated arguments that
+// match these signatures (see dmo_extension.h)
+#define GRAPHICS_WINDOW_SIGNATURE "v(...)"       // title and/or size
+#define GRAPHICS_LINE_SIGNATURE "v(n...)"        // length
+#define GRAPHICS_SQR_SIGNATURE "v(nnnn...)"      // x, y, width, height
+#define GRAPHICS_CRLE_SIGNATURE "v(n...)"        // radius, curve parameter
+#define GRAPHICS_DISPLAY_SIGNATURE "v(s...)"     // text, x, y, width, height, r, g, b
+Value dmo_gr_create_window(const Value* args, int arg_count, InterpreterContext* ctx);
+Value dmo_gr_create_line(const Value* args, int arg_count, InterpreterContext* ctx);
+Value dmo_gr_create_sqr(const Value* args, int arg_count, InterpreterContext* ctx);
+Value dmo_gr_create_crle(const Value* args, int arg_count, InterpreterContext* ctx);
+Value dmo_gr_display(const Value* args, int arg_count, InterpreterContext* ctx);
 
 // Input and collision detection
-Value dmo_key_pressed(ASTNode** args, int arg_count, InterpreterContext* ctx);
-Value dmo_element_pressed(ASTNode** args, int arg_count, InterpreterContext* ctx);
-Value dmo_collide(ASTNode** args, int arg_count, InterpreterContext* ctx);
+Value dmo_key_pressed(const Value* args, int arg_count, InterpreterContext* ctx);
+Value dmo_element_pressed(const Value* args, int arg_count, InterpreterContext* ctx);
+Value dmo_collide(const Value* args, int arg_count, InterpreterContext* ctx);
 
 // Utility functions for graphics
-void add_graphics_element(const char* id, int x, int y, int width, int height, Color color, int type);
-GraphicsElement* find_element_by_id(const char* id);
+void add_graphics_element(DMOGraphicsContext* graphics_ctx, const char* id, int x, int y, int width, int height, Color color, int type);
+GraphicsElement* find_element_by_id(DMOGraphicsContext* graphics_ctx, const char* id);
 bool check_collision(GraphicsElement* a, GraphicsElement* b);
 Color parse_color(int r, int g, int b);
 
 // Utility functions
-void start_svg_output();
-void end_svg_output();
-void write_svg_header();
-void write_svg_footer();
+void start_svg_output(DMOGraphicsContext* graphics_ctx);
+void end_svg_output(DMOGraphicsContext* graphics_ctx);
+void write_svg_header(DMOGraphicsContext* graphics_ctx);
+void write_svg_footer(DMOGraphicsContext* graphics_ctx);
 
 #endif // DMO_GRAPHS_H
@@ -0,0 +1,1036 @@
+/*
+ * DMO HTTP Client Implementation
+ * In-process HTTP/1.1 client with keep-alive connection pooling
+ * and an event loop for concurrent requests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_http.h"
+#include "dmo_output.h"
+#include "dmo_runtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define HTTP_READ_SIZE (16 * 1024)
+#define HTTP_EVENT_BATCH 64
+
+typedef struct {
+    char host[256];
+    int port;
+    const char* path;    // points into the URL
+} HttpUrl;
+
+typedef enum {
+    WATCH_ADD,
+    WATCH_MODIFY,
+    WATCH_REMOVE
+} WatchChange;
+
+#ifndef _WIN32
+
+static bool parse_url(const char* url, HttpUrl* parsed) {
+    if (strncmp(url, "http://", 7) != 0) {
+        return false;
+    }
+    
+    const char* host = url + 7;
+    size_t host_length = strcspn(host, ":/?#");
+    if (host_length == 0 || host_length >= sizeof(parsed->host)) {
+        return false;
+    }
+    memcpy(parsed->host, host, host_length);
+    parsed->host[host_length] = '\0';
+    
+    const char* rest = host + host_length;
+    parsed->port = 80;
+    if (*rest == ':') {
+        char* end;
+        long port = strtol(rest + 1, &end, 10);
+        if (end == rest + 1 || port <= 0 || port > 65535) {
+            return false;
+        }
+        parsed->port = (int)port;
+        rest = end;
+    }
+    
+    parsed->path = rest;
+    return *rest == '\0' || *rest == '/' || *rest == '?' || *rest == '#';
+}
+
+static void buffer_init(HttpBuffer* buf) {
+    buf->capacity = 256;
+    buf->data = malloc(buf->capacity);
+    buf->data[0] = '\0';
+    buf->length = 0;
+}
+
+static void buffer_reserve(HttpBuffer* buf, size_t extra) {
+    if (buf->length + extra + 1 > buf->capacity) {
+        while (buf->length + extra + 1 > buf->capacity) {
+            buf->capacity *= 2;
+        }
+        buf->data = realloc(buf->data, buf->capacity);
+    }
+}
+
+static void buffer_append(HttpBuffer* buf, const char* data, size_t length) {
+    buffer_reserve(buf, length);
+    memcpy(buf->data + buf->length, data, length);
+    buf->length += length;
+    buf->data[buf->length] = '\0';
+}
+
+static void buffer_string(HttpBuffer* buf, const char* text) {
+    buffer_append(buf, text, strlen(text));
+}
+
+static void close_connection(HttpConnection* conn) {
+    close(conn->fd);
+    free(conn->host);
+    free(conn);
+}
+
+// A pooled connection is only usable if the server has not closed it and
+// has not sent anything unasked
+static bool connection_idle(HttpConnection* conn) {
+    char byte;
+    ssize_t n = recv(conn->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static HttpConnection* pool_take(HttpPool* pool, const char* host, int port) {
+    HttpConnection* found = NULL;
+    
+    pthread_mutex_lock(&pool->lock);
+    HttpConnection** link = &pool->idle;
+    while (*link) {
+        HttpConnection* conn = *link;
+        if (conn->port != port || strcmp(conn->host, host) != 0) {
+            link = &conn->next;
+            continue;
+        }
+        
+        *link = conn->next;
+        pool->idle_count--;
+        if (connection_idle(conn)) {
+            found = conn;
+            pool->reused++;
+            break;
+        }
+        close_connection(conn);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    
+    return found;
+}
+
+static void pool_put(HttpPool* pool, HttpConnection* conn) {
+    pthread_mutex_lock(&pool->lock);
+    int same_host = 0;
+    for (HttpConnection* idle = pool->idle; idle; idle = idle->next) {
+        if (idle->port == conn->port && strcmp(idle->host, conn->host) == 0) {
+            same_host++;
+        }
+    }
+    
+    bool keep = same_host < HTTP_MAX_IDLE_PER_HOST && pool->idle_count < HTTP_MAX_IDLE;
+    if (keep) {
+        conn->next = pool->idle;
+        pool->idle = conn;
+        pool->idle_count++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    
+    if (!keep) {
+        close_connection(conn);
+    }
+}
+
+static bool wants_write(HttpRequest* req) {
+    return req->state == HTTP_CONNECTING || req->state == HTTP_SENDING;
+}
+
+static void watch(HttpLoop* loop, HttpRequest* req, WatchChange change) {
+#ifdef __linux__
+    struct epoll_event event;
+    event.events = wants_write(req) ? EPOLLOUT : EPOLLIN;
+    event.data.ptr = req;
+    int op = change == WATCH_ADD ? EPOLL_CTL_ADD : change == WATCH_MODIFY ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    epoll_ctl(loop->poll_fd, op, req->conn->fd, &event);
+#else
+    // poll() gets the interest from each request's state every time
+    (void)loop; (void)req; (void)change;
+#endif
+}
+
+static void finish_request(HttpPool* pool, HttpLoop* loop, HttpRequest* req, bool ok) {
+    if (req->conn) {
+        watch(loop, req, WATCH_REMOVE);
+        
+        // Anything left over was not asked for, so the connection can't be trusted
+        if (ok && req->keep_alive && req->parsed == req->in.length) {
+            pool_put(pool, req->conn);
+        } else {
+            close_connection(req->conn);
+        }
+        req->conn = NULL;
+    }
+    if (req->addresses) {
+        freeaddrinfo(req->addresses);
+        req->addresses = NULL;
+    }
+    
+    req->state = ok ? HTTP_DONE : HTTP_FAILED;
+    loop->active--;
+    dmo_log(DMO_LOG_DEBUG, "HTTP %s: %d\n", req->url, ok ? req->status : 0);
+}
+
+static void fail_request(HttpPool* pool, HttpLoop* loop, HttpRequest* req, const char* reason) {
+    fprintf(stderr, "Error: HTTP request to %s failed: %s\n", req->url, reason);
+    finish_request(pool, loop, req, false);
+}
+
+// Tries the remaining addresses of the host until a connect is under way
+static void connect_next(HttpPool* pool, HttpLoop* loop, HttpRequest* req) {
+    for (; req->address; req->address = req->address->ai_next) {
+        struct addrinfo* addr = req->address;
+        int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        
+        int result = connect(fd, addr->ai_addr, addr->ai_addrlen);
+        if (result != 0 && errno != EINPROGRESS) {
+            close(fd);
+            continue;
+        }
+        
+        req->conn = malloc(sizeof(HttpConnection));
+        req->conn->host = strdup(req->host);
+        req->conn->port = req->port;
+        req->conn->fd = fd;
+        req->conn->next = NULL;
+        req->state = result == 0 ? HTTP_SENDING : HTTP_CONNECTING;
+        watch(loop, req, WATCH_ADD);
+        
+        pthread_mutex_lock(&pool->lock);
+        pool->opened++;
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    
+    fail_request(pool, loop, req, "cannot connect");
+}
+
+// Name lookup blocks; everything after it is non-blocking
+static void begin_connect(HttpPool* pool, HttpLoop* loop, HttpRequest* req) {
+    char port[16];
+    snprintf(port, sizeof(port), "%d", req->port);
+    
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    
+    if (getaddrinfo(req->host, port, &hints, &req->addresses) != 0) {
+        req->addresses = NULL;
+        fail_request(pool, loop, req, "cannot resolve host");
+        return;
+    }
+    req->address = req->addresses;
+    connect_next(pool, loop, req);
+}
+
+static void start_request(HttpPool* pool, HttpLoop* loop, HttpRequest* req) {
+    loop->active++;
+    
+    pthread_mutex_lock(&pool->lock);
+    req->deadline = now_seconds() + pool->timeout;
+    pthread_mutex_unlock(&pool->lock);
+    
+    req->conn = pool_take(pool, req->host, req->port);
+    if (req->conn) {
+        req->reused = true;
+        req->state = HTTP_SENDING;
+        watch(loop, req, WATCH_ADD);
+        return;
+    }
+    begin_connect(pool, loop, req);
+}
+
+// A pooled connection may have been closed by the server since its last
+// use; then the request is sent once more on a new connection
+static bool retry_stale(HttpPool* pool, HttpLoop* loop, HttpRequest* req) {
+    if (!req->reused || req->received || req->retried) {
+        return false;
+    }
+    
+    watch(loop, req, WATCH_REMOVE);
+    close_connection(req->conn);
+    req->conn = NULL;
+    req->reused = false;
+    req->retried = true;
+    req->sent = 0;
+    begin_connect(pool, loop, req);
+    return true;
+}
+
+static bool header_is(const char* line, const char* name, const char** value) {
+    size_t length = strlen(name);
+    if (strncasecmp(line, name, length) != 0 || line[length] != ':') {
+        return false;
+    }
+    *value = line + length + 1;
+    while (**value == ' ' || **value == '\t') {
+        (*value)++;
+    }
+    return true;
+}
+
+static bool parse_line(HttpRequest* req, const char* line) {
+    switch (req->state) {
+        case HTTP_STATUS_LINE: {
+            int major, minor;
+            if (sscanf(line, "HTTP/%d.%d %d", &major, &minor, &req->status) != 3) {
+                return false;
+            }
+            req->keep_alive = major > 1 || (major == 1 && minor >= 1);
+            req->chunked = false;
+            req->has_length = false;
+            req->state = HTTP_HEADERS;
+            return true;
+        }
+        
+        case HTTP_HEADERS: {
+            const char* value;
+            if (line[0] != '\0') {
+                if (header_is(line, "Content-Length", &value)) {
+                    req->remaining = strtoull(value, NULL, 10);
+                    req->has_length = true;
+                } else if (header_is(line, "Transfer-Encoding", &value)) {
+                    req->chunked = strstr(value, "chunked") != NULL;
+                } else if (header_is(line, "Connection", &value)) {
+                    if (strncasecmp(value, "close", 5) == 0) {
+                        req->keep_alive = false;
+                    } else if (strncasecmp(value, "keep-alive", 10) == 0) {
+                        req->keep_alive = true;
+                    }
+                }
+                return true;
+            }
+            
+            // Interim 1xx responses come before the real one
+            if (req->status < 200) {
+                req->state = HTTP_STATUS_LINE;
+            } else if (req->head_request || req->status == 204 || req->status == 304) {
+                req->state = HTTP_DONE;
+            } else if (req->chunked) {
+                req->state = HTTP_CHUNK_SIZE;
+            } else if (req->has_length) {
+                req->state = req->remaining > 0 ? HTTP_BODY_LENGTH : HTTP_DONE;
+            } else {
+                req->state = HTTP_BODY_CLOSE;
+                req->keep_alive = false;
+            }
+            return true;
+        }
+        
+        case HTTP_CHUNK_SIZE: {
+            // Chunk extensions after ';' are ignored
+            char* end;
+            req->remaining = strtoull(line, &end, 16);
+            if (end == line) {
+                return false;
+            }
+            req->state = req->remaining > 0 ? HTTP_CHUNK_DATA : HTTP_TRAILERS;
+            return true;
+        }
+        
+        case HTTP_CHUNK_END:
+            req->state = HTTP_CHUNK_SIZE;
+            return line[0] == '\0';
+        
+        case HTTP_TRAILERS:
+            if (line[0] == '\0') {
+                req->state = HTTP_DONE;
+            }
+            return true;
+        
+        default:
+            return false;
+    }
+}
+
+// Consumes what has arrived; false if the response is malformed
+static bool parse_response(HttpRequest* req) {
+    while (req->state != HTTP_DONE) {
+        char* data = req->in.data + req->parsed;
+        size_t available = req->in.length - req->parsed;
+        
+        if (req->state == HTTP_BODY_CLOSE) {
+            buffer_append(&req->body, data, available);
+            req->parsed += available;
+            return true;
+        }
+        
+        if (req->state == HTTP_BODY_LENGTH || req->state == HTTP_CHUNK_DATA) {
+            size_t take = available < req->remaining ? available : (size_t)req->remaining;
+            buffer_append(&req->body, data, take);
+            req->parsed += take;
+            req->remaining -= take;
+            if (req->remaining > 0) {
+                return true;
+            }
+            req->state = req->state == HTTP_BODY_LENGTH ? HTTP_DONE : HTTP_CHUNK_END;
+            continue;
+        }
+        
+        // Everything else is line by line
+        char* newline = memchr(data, '\n', available);
+        if (!newline) {
+            return available <= HTTP_MAX_LINE;
+        }
+        *newline = '\0';
+        if (newline > data && newline[-1] == '\r') {
+            newline[-1] = '\0';
+        }
+        req->parsed += (size_t)(newline - data) + 1;
+        if (!parse_line(req, data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void on_writable(HttpPool* pool, HttpLoop* loop, HttpRequest* req) {
+    if (req->state == HTTP_CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(req->conn->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            watch(loop, req, WATCH_REMOVE);
+            close_connection(req->conn);
+            req->conn = NULL;
+            req->address = req->address->ai_next;
+            connect_next(pool, loop, req);
+            return;
+        }
+        req->state = HTTP_SENDING;
+    }
+    
+    while (req->sent < req->out.length) {
+        ssize_t sent = send(req->conn->fd, req->out.data + req->sent, req->out.length - req->sent, MSG_NOSIGNAL);
+        if (sent > 0) {
+            req->sent += (size_t)sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (!retry_stale(pool, loop, req)) {
+            fail_request(pool, loop, req, "connection closed while sending");
+        }
+        return;
+    }
+    
+    req->state = HTTP_STATUS_LINE;
+    watch(loop, req, WATCH_MODIFY);
+}
+
+static void on_readable(HttpPool* pool, HttpLoop* loop, HttpRequest* req) {
+    while (true) {
+        buffer_reserve(&req->in, HTTP_READ_SIZE);
+        ssize_t n = recv(req->conn->fd, req->in.data + req->in.length,
+                         req->in.capacity - req->in.length - 1, 0);
+        if (n > 0) {
+            req->in.length += (size_t)n;
+            req->in.data[req->in.length] = '\0';
+            req->received = true;
+            
+            if (!parse_response(req)) {
+                fail_request(pool, loop, req, "malformed response");
+                return;
+            }
+            if (req->state == HTTP_DONE) {
+                finish_request(pool, loop, req, true);
+                return;
+            }
+            if (req->parsed == req->in.length) {
+                req->parsed = req->in.length = 0;
+            }
+            
+            // A stream gives the reader a turn after every read
+            if (req->streaming) {
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        
+        // End of stream or a reset
+        if (n == 0 && req->state == HTTP_BODY_CLOSE) {
+            finish_request(pool, loop, req, true);
+        } else if (!retry_stale(pool, loop, req)) {
+            fail_request(pool, loop, req, n == 0 ? "connection closed early" : strerror(errno));
+        }
+        return;
+    }
+}
+
+static void dispatch(HttpPool* pool, HttpLoop* loop, HttpRequest* req) {
+    if (wants_write(req)) {
+        on_writable(pool, loop, req);
+    } else {
+        on_readable(pool, loop, req);
+    }
+}
+
+static bool in_flight(HttpRequest* req) {
+    return req && req->state != HTTP_QUEUED && req->state != HTTP_DONE && req->state != HTTP_FAILED;
+}
+
+// Fails requests past their deadline and returns the time to the next one
+static double expire_requests(HttpPool* pool, HttpLoop* loop) {
+    double now = now_seconds();
+    double next = HTTP_DEFAULT_TIMEOUT;
+    for (int i = 0; i < loop->next_queued; i++) {
+        HttpRequest* req = loop->requests[i];
+        if (!in_flight(req)) {
+            continue;
+        }
+        if (req->deadline <= now) {
+            fail_request(pool, loop, req, "timed out");
+        } else if (req->deadline - now < next) {
+            next = req->deadline - now;
+        }
+    }
+    return next;
+}
+
+static void wait_for_events(HttpPool* pool, HttpLoop* loop, double seconds) {
+    int timeout_ms = (int)(seconds * 1000) + 1;
+
+#ifdef __linux__
+    struct epoll_event events[HTTP_EVENT_BATCH];
+    int count = epoll_wait(loop->poll_fd, events, HTTP_EVENT_BATCH, timeout_ms);
+    for (int i = 0; i < count; i++) {
+        dispatch(pool, loop, events[i].data.ptr);
+    }
+#else
+    struct pollfd* fds = malloc(sizeof(struct pollfd) * loop->active);
+    HttpRequest** owners = malloc(sizeof(HttpRequest*) * loop->active);
+    int count = 0;
+    for (int i = 0; i < loop->next_queued && count < loop->active; i++) {
+        HttpRequest* req = loop->requests[i];
+        if (in_flight(req) && req->conn) {
+            fds[count].fd = req->conn->fd;
+            fds[count].events = wants_write(req) ? POLLOUT : POLLIN;
+            fds[count].revents = 0;
+            owners[count++] = req;
+        }
+    }
+    if (poll(fds, count, timeout_ms) > 0) {
+        for (int i = 0; i < count; i++) {
+            if (fds[i].revents) {
+                dispatch(pool, loop, owners[i]);
+            }
+        }
+    }
+    free(fds);
+    free(owners);
+#endif
+}
+
+static bool request_finished(HttpLoop* loop, int handle) {
+    HttpRequest* req = http_find(loop, handle);
+    return !req || req->state == HTTP_DONE || req->state == HTTP_FAILED;
+}
+
+static bool all_finished(HttpLoop* loop, int handle) {
+    (void)handle;
+    return loop->active == 0 && loop->next_queued == loop->count;
+}
+
+static int unreported_finished(HttpLoop* loop) {
+    for (int i = 0; i < loop->next_queued; i++) {
+        HttpRequest* req = loop->requests[i];
+        if (req && !req->reported && (req->state == HTTP_DONE || req->state == HTTP_FAILED)) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static bool any_finished(HttpLoop* loop, int handle) {
+    (void)handle;
+    return unreported_finished(loop) != 0;
+}
+
+// Starts queued requests as slots free up and waits on the sockets until
+// done() holds or nothing is left to do
+static void run_loop(HttpPool* pool, HttpLoop* loop, bool (*done)(HttpLoop*, int), int handle) {
+    while (!done(loop, handle)) {
+        while (loop->next_queued < loop->count && loop->active < loop->max_active) {
+            HttpRequest* req = loop->requests[loop->next_queued++];
+            if (req) {
+                start_request(pool, loop, req);
+            }
+        }
+        if (loop->active == 0) {
+            if (loop->next_queued == loop->count) {
+                return;
+            }
+            continue;
+        }
+        
+        double next_deadline = expire_requests(pool, loop);
+        if (loop->active > 0) {
+            wait_for_events(pool, loop, next_deadline);
+        }
+    }
+}
+
+int http_submit(HttpLoop* loop, const char* method, const char* url, const char* body) {
+    HttpUrl parsed;
+    if (!parse_url(url, &parsed)) {
+        return 0;
+    }
+    
+    HttpRequest* req = calloc(1, sizeof(HttpRequest));
+    req->state = HTTP_QUEUED;
+    req->url = strdup(url);
+    strcpy(req->host, parsed.host);
+    req->port = parsed.port;
+    req->head_request = strcmp(method, "HEAD") == 0;
+    buffer_init(&req->in);
+    buffer_init(&req->body);
+    
+    HttpBuffer* out = &req->out;
+    buffer_init(out);
+    buffer_string(out, method);
+    buffer_string(out, " ");
+    size_t path_length = strcspn(parsed.path, "#");
+    if (path_length == 0 || parsed.path[0] != '/') {
+        buffer_string(out, "/");
+    }
+    buffer_append(out, parsed.path, path_length);
+    buffer_string(out, " HTTP/1.1\r\nHost: ");
+    buffer_string(out, parsed.host);
+    if (parsed.port != 80) {
+        char port[16];
+        snprintf(port, sizeof(port), ":%d", parsed.port);
+        buffer_string(out, port);
+    }
+    buffer_string(out, "\r\nUser-Agent: dmo\r\nAccept: */*\r\n");
+    if (body) {
+        char length[64];
+        snprintf(length, sizeof(length), "Content-Length: %zu\r\n", strlen(body));
+        buffer_string(out, "Content-Type: application/x-www-form-urlencoded\r\n");
+        buffer_string(out, length);
+    }
+    buffer_string(out, "\r\n");
+    if (body) {
+        buffer_string(out, body);
+    }
+    
+    if (loop->count == loop->capacity) {
+        loop->capacity = loop->capacity ? loop->capacity * 2 : 16;
+        loop->requests = realloc(loop->requests, sizeof(HttpRequest*) * loop->capacity);
+    }
+    loop->requests[loop->count++] = req;
+    return loop->count;
+}
+
+void http_wait(HttpPool* pool, HttpLoop* loop, int handle) {
+    run_loop(pool, loop, request_finished, handle);
+}
+
+int http_wait_any(HttpPool* pool, HttpLoop* loop) {
+    run_loop(pool, loop, any_finished, 0);
+    int handle = unreported_finished(loop);
+    if (handle) {
+        loop->requests[handle - 1]->reported = true;
+    }
+    return handle;
+}
+
+int http_wait_all(HttpPool* pool, HttpLoop* loop) {
+    run_loop(pool, loop, all_finished, 0);
+    int succeeded = 0;
+    for (int i = 0; i < loop->count; i++) {
+        HttpRequest* req = loop->requests[i];
+        if (req) {
+            req->reported = true;
+            succeeded += req->state == HTTP_DONE;
+        }
+    }
+    return succeeded;
+}
+
+bool http_request(HttpPool* pool, const char* method, const char* url,
+                  const char* body, HttpResponse* response) {
+    HttpLoop loop;
+    http_loop_init(&loop, 1);
+    
+    bool ok = false;
+    int handle = http_submit(&loop, method, url, body);
+    if (handle) {
+        http_wait(pool, &loop, handle);
+        HttpRequest* req = http_take(&loop, handle);
+        if (req->state == HTTP_DONE) {
+            response->status = req->status;
+            response->body = req->body.data;
+            response->length = req->body.length;
+            req->body.data = NULL;
+            ok = true;
+        }
+        http_free_request(req);
+    }
+    
+    http_loop_free(&loop);
+    return ok;
+}
+
+static HttpLoop* find_stream(HttpPool* pool, int handle) {
+    if (handle < 1 || handle > pool->stream_count || !pool->streams[handle - 1]) {
+        fprintf(stderr, "Error: Unknown or closed stream handle %d\n", handle);
+        return NULL;
+    }
+    return pool->streams[handle - 1];
+}
+
+static size_t unread(HttpRequest* req) {
+    return req->body.length - req->consumed;
+}
+
+static bool stream_progress(HttpLoop* loop, int handle) {
+    HttpRequest* req = loop->requests[handle - 1];
+    return unread(req) > req->wanted || req->state == HTTP_DONE || req->state == HTTP_FAILED;
+}
+
+// Reads until more of the body has arrived; false once the response ended
+// without more
+static bool stream_fill(HttpPool* pool, HttpLoop* loop) {
+    HttpRequest* req = loop->requests[0];
+    if (req->consumed == req->body.length) {
+        req->consumed = req->body.length = 0;
+    } else if (req->consumed >= HTTP_READ_SIZE) {
+        memmove(req->body.data, req->body.data + req->consumed, unread(req));
+        req->body.length -= req->consumed;
+        req->consumed = 0;
+    }
+    
+    req->wanted = unread(req);
+    run_loop(pool, loop, stream_progress, 1);
+    return unread(req) > req->wanted;
+}
+
+static char* stream_take(HttpRequest* req, size_t length, size_t skip) {
+    char* text = malloc(length + 1);
+    memcpy(text, req->body.data + req->consumed, length);
+    text[length] = '\0';
+    req->consumed += length + skip;
+    return text;
+}
+
+int http_open_stream(HttpPool* pool, const char* method, const char* url, const char* body) {
+    HttpLoop* loop = malloc(sizeof(HttpLoop));
+    http_loop_init(loop, 1);
+    if (!http_submit(loop, method, url, body)) {
+        http_loop_free(loop);
+        free(loop);
+        return 0;
+    }
+    loop->requests[0]->streaming = true;
+    
+    if (pool->stream_count == pool->stream_capacity) {
+        pool->stream_capacity = pool->stream_capacity ? pool->stream_capacity * 2 : 8;
+        pool->streams = realloc(pool->streams, sizeof(HttpLoop*) * pool->stream_capacity);
+    }
+    pool->streams[pool->stream_count++] = loop;
+    return pool->stream_count;
+}
+
+bool http_stream_more(HttpPool* pool, int handle) {
+    HttpLoop* loop = find_stream(pool, handle);
+    if (!loop) {
+        return false;
+    }
+    
+    HttpRequest* req = loop->requests[0];
+    while (unread(req) == 0) {
+        if (!stream_fill(pool, loop)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+char* http_stream_line(HttpPool* pool, int handle) {
+    HttpLoop* loop = find_stream(pool, handle);
+    if (!loop) {
+        return NULL;
+    }
+    
+    HttpRequest* req = loop->requests[0];
+    size_t scanned = 0;
+    while (true) {
+        char* start = req->body.data + req->consumed;
+        size_t available = unread(req);
+        char* newline = memchr(start + scanned, '\n', available - scanned);
+        if (newline) {
+            size_t length = (size_t)(newline - start);
+            return stream_take(req, length > 0 && start[length - 1] == '\r' ? length - 1 : length,
+                               length > 0 && start[length - 1] == '\r' ? 2 : 1);
+        }
+        if (available >= HTTP_STREAM_LINE_MAX) {
+            return stream_take(req, available, 0);
+        }
+        
+        scanned = available;
+        if (!stream_fill(pool, loop)) {
+            return available > 0 ? stream_take(req, available, 0) : NULL;
+        }
+    }
+}
+
+char* http_stream_chunk(HttpPool* pool, int handle) {
+    HttpLoop* loop = find_stream(pool, handle);
+    if (!loop) {
+        return NULL;
+    }
+    
+    HttpRequest* req = loop->requests[0];
+    if (unread(req) == 0 && !stream_fill(pool, loop)) {
+        return NULL;
+    }
+    return stream_take(req, unread(req), 0);
+}
+
+#else
+
+// Without BSD sockets the request module falls back to curl
+static void close_connection(HttpConnection* conn) {
+    free(conn->host);
+    free(conn);
+}
+
+int http_submit(HttpLoop* loop, const char* method, const char* url, const char* body) {
+    (void)loop; (void)method; (void)url; (void)body;
+    return 0;
+}
+
+void http_wait(HttpPool* pool, HttpLoop* loop, int handle) {
+    (void)pool; (void)loop; (void)handle;
+}
+
+int http_wait_any(HttpPool* pool, HttpLoop* loop) {
+    (void)pool; (void)loop;
+    return 0;
+}
+
+int http_wait_all(HttpPool* pool, HttpLoop* loop) {
+    (void)pool; (void)loop;
+    return 0;
+}
+
+bool http_request(HttpPool* pool, const char* method, const char* url,
+                  const char* body, HttpResponse* response) {
+    (void)pool; (void)method; (void)url; (void)body; (void)response;
+    return false;
+}
+
+int http_open_stream(HttpPool* pool, const char* method, const char* url, const char* body) {
+    (void)pool; (void)method; (void)url; (void)body;
+    return 0;
+}
+
+bool http_stream_more(HttpPool* pool, int handle) {
+    (void)pool; (void)handle;
+    return false;
+}
+
+char* http_stream_line(HttpPool* pool, int handle) {
+    (void)pool; (void)handle;
+    return NULL;
+}
+
+char* http_stream_chunk(HttpPool* pool, int handle) {
+    (void)pool; (void)handle;
+    return NULL;
+}
+
+#endif
+
+void http_loop_init(HttpLoop* loop, int max_active) {
+    loop->requests = NULL;
+    loop->count = 0;
+    loop->capacity = 0;
+    loop->next_queued = 0;
+    loop->active = 0;
+    loop->max_active = max_active;
+#ifdef __linux__
+    loop->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+#else
+    loop->poll_fd = -1;
+#endif
+}
+
+void http_free_request(HttpRequest* req) {
+    if (req->conn) {
+        close_connection(req->conn);
+    }
+#ifndef _WIN32
+    if (req->addresses) {
+        freeaddrinfo(req->addresses);
+    }
+#endif
+    free(req->url);
+    free(req->out.data);
+    free(req->in.data);
+    free(req->body.data);
+    free(req);
+}
+
+void http_loop_free(HttpLoop* loop) {
+    for (int i = 0; i < loop->count; i++) {
+        if (loop->requests[i]) {
+            http_free_request(loop->requests[i]);
+        }
+    }
+    free(loop->requests);
+#ifdef __linux__
+    close(loop->poll_fd);
+#endif
+}
+
+HttpRequest* http_find(HttpLoop* loop, int handle) {
+    if (handle < 1 || handle > loop->count) {
+        return NULL;
+    }
+    return loop->requests[handle - 1];
+}
+
+HttpRequest* http_take(HttpLoop* loop, int handle) {
+    HttpRequest* req = http_find(loop, handle);
+    if (req) {
+        loop->requests[handle - 1] = NULL;
+    }
+    return req;
+}
+
+bool http_close_stream(HttpPool* pool, int handle) {
+    if (handle < 1 || handle > pool->stream_count || !pool->streams[handle - 1]) {
+        return false;
+    }
+    http_loop_free(pool->streams[handle - 1]);
+    free(pool->streams[handle - 1]);
+    pool->streams[handle - 1] = NULL;
+    return true;
+}
+
+static void close_all_streams(HttpPool* pool) {
+    for (int i = 1; i <= pool->stream_count; i++) {
+        http_close_stream(pool, i);
+    }
+    free(pool->streams);
+    pool->streams = NULL;
+    pool->stream_count = 0;
+    pool->stream_capacity = 0;
+}
+
+HttpPool* create_http_pool() {
+    HttpPool* pool = malloc(sizeof(HttpPool));
+    pool->idle = NULL;
+    pool->idle_count = 0;
+    pool->opened = 0;
+    pool->reused = 0;
+    pool->timeout = HTTP_DEFAULT_TIMEOUT;
+    pthread_mutex_init(&pool->lock, NULL);
+    http_loop_init(&pool->async, HTTP_DEFAULT_CONCURRENCY);
+    pool->streams = NULL;
+    pool->stream_count = 0;
+    pool->stream_capacity = 0;
+    pthread_mutex_init(&pool->async_lock, NULL);
+    return pool;
+}
+
+void free_http_pool(HttpPool* pool) {
+    close_all_streams(pool);
+    http_loop_free(&pool->async);
+    pthread_mutex_destroy(&pool->async_lock);
+    
+    HttpConnection* conn = pool->idle;
+    while (conn) {
+        HttpConnection* next = conn->next;
+        close_connection(conn);
+        conn = next;
+    }
+    
+    if (pool->opened > 0) {
+        dmo_log(DMO_LOG_INFO, "HTTP connections: %lu opened, %lu reused\n", pool->opened, pool->reused);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void http_configure(HttpPool* pool, int concurrency, double timeout) {
+    if (timeout > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->timeout = timeout;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if (concurrency > 0) {
+        pthread_mutex_lock(&pool->async_lock);
+        pool->async.max_active = concurrency;
+        pthread_mutex_unlock(&pool->async_lock);
+    }
+}
+
+void http_cancel_all(HttpPool* pool) {
+    pthread_mutex_lock(&pool->async_lock);
+    int max_active = pool->async.max_active;
+    http_loop_free(&pool->async);
+    http_loop_init(&pool->async, max_active);
+    close_all_streams(pool);
+    pthread_mutex_unlock(&pool->async_lock);
+}
+
+void free_http_response(HttpResponse* response) {
+    free(response->body);
+    response->body = NULL;
+    response->length = 0;
+}
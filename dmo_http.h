@@ -0,0 +1,161 @@
+/*
+ * DMO HTTP Client Header
+ * In-process HTTP/1.1 client with keep-alive connection pooling
+ * and an event loop for concurrent requests
+ */
+
+#ifndef DMO_HTTP_H
+#define DMO_HTTP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define HTTP_MAX_IDLE_PER_HOST 4
+#define HTTP_MAX_IDLE 32
+#define HTTP_DEFAULT_CONCURRENCY 64
+#define HTTP_DEFAULT_TIMEOUT 30.0    // seconds per request, from its start
+#define HTTP_MAX_LINE 8192
+#define HTTP_STREAM_LINE_MAX (1024 * 1024)    // longer lines are returned in pieces
+
+// Growable byte buffer, always NUL-terminated
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} HttpBuffer;
+
+// An open connection, idle in a pool or owned by one request
+typedef struct HttpConnection {
+    char* host;
+    int port;
+    int fd;
+    struct HttpConnection* next;
+} HttpConnection;
+
+// Progress of one request through the event loop
+typedef enum {
+    HTTP_QUEUED,         // waiting for a free concurrency slot
+    HTTP_CONNECTING,
+    HTTP_SENDING,
+    HTTP_STATUS_LINE,
+    HTTP_HEADERS,
+    HTTP_BODY_LENGTH,
+    HTTP_CHUNK_SIZE,
+    HTTP_CHUNK_DATA,
+    HTTP_CHUNK_END,
+    HTTP_TRAILERS,
+    HTTP_BODY_CLOSE,     // body runs until the server closes
+    HTTP_DONE,
+    HTTP_FAILED
+} HttpState;
+
+typedef struct HttpRequest {
+    HttpState state;
+    char* url;
+    char host[256];
+    int port;
+    bool head_request;
+    HttpConnection* conn;
+    struct addrinfo* addresses;   // left to try while connecting
+    struct addrinfo* address;
+    HttpBuffer out;
+    size_t sent;
+    HttpBuffer in;
+    size_t parsed;
+    HttpBuffer body;
+    unsigned long long remaining;
+    bool chunked;
+    bool has_length;
+    bool keep_alive;
+    bool reused;         // connection came from the pool
+    bool retried;
+    bool received;       // any response bytes arrived
+    bool reported;       // returned by wait_any already
+    bool streaming;      // body is handed out as it arrives
+    size_t consumed;     // bytes of body already handed out
+    size_t wanted;       // unread bytes a stream reader already has
+    int status;
+    double deadline;
+} HttpRequest;
+
+// Requests of one loop by handle; handle n is slot n - 1
+typedef struct {
+    HttpRequest** requests;
+    int count;
+    int capacity;
+    int next_queued;     // requests start in handle order
+    int active;          // started and not finished
+    int max_active;
+    int poll_fd;         // epoll instance on Linux
+} HttpLoop;
+
+// Idle keep-alive connections of one runtime, newest first, and the
+// runtime's loop for asynchronous requests. Loop chunks and tasks share
+// their runtime's pool, hence the locks; one thread drives the loop at
+// a time.
+typedef struct HttpPool {
+    HttpConnection* idle;
+    int idle_count;
+    unsigned long opened;
+    unsigned long reused;
+    double timeout;
+    pthread_mutex_t lock;
+    HttpLoop async;
+    HttpLoop** streams;  // one private loop per open stream, handle n is slot n - 1
+    int stream_count;
+    int stream_capacity;
+    pthread_mutex_t async_lock;
+} HttpPool;
+
+typedef struct {
+    int status;
+    char* body;      // NUL-terminated, may also contain NUL bytes
+    size_t length;
+} HttpResponse;
+
+// Function prototypes
+HttpPool* create_http_pool();
+void free_http_pool(HttpPool* pool);
+
+// Concurrency of the asynchronous loop and the timeout of every request;
+// values <= 0 are left unchanged
+void http_configure(HttpPool* pool, int concurrency, double timeout);
+
+// Drops the asynchronous requests and streams; idle connections stay
+void http_cancel_all(HttpPool* pool);
+
+// Sends one request for an http:// URL and waits for the response, reusing
+// a pooled connection to the same host when there is one. body may be
+// NULL. Returns false if the URL is not http:// or the request failed.
+bool http_request(HttpPool* pool, const char* method, const char* url,
+                  const char* body, HttpResponse* response);
+void free_http_response(HttpResponse* response);
+
+// Event loop. Submitting only queues the request; it makes progress while
+// the loop is waited on. Handles are > 0, 0 means the URL was not http://.
+void http_loop_init(HttpLoop* loop, int max_active);
+void http_loop_free(HttpLoop* loop);
+int http_submit(HttpLoop* loop, const char* method, const char* url, const char* body);
+void http_wait(HttpPool* pool, HttpLoop* loop, int handle);
+int http_wait_any(HttpPool* pool, HttpLoop* loop);     // a finished handle not returned before, or 0
+int http_wait_all(HttpPool* pool, HttpLoop* loop);     // marks all returned; number of successes not yet taken
+
+// A request stays in its loop until taken; NULL for unknown handles.
+// A finished request is HTTP_DONE with status and body, or HTTP_FAILED.
+HttpRequest* http_find(HttpLoop* loop, int handle);
+HttpRequest* http_take(HttpLoop* loop, int handle);
+void http_free_request(HttpRequest* request);
+
+// Streaming. The socket is only read while the script asks for more, one
+// read at a time, so a stream holds at most a read's worth of unconsumed
+// body plus the current line, however large the response. Handles are
+// > 0; lines and chunks are malloc'd, NULL at the end. Callers hold
+// async_lock, as for the asynchronous loop.
+int http_open_stream(HttpPool* pool, const char* method, const char* url, const char* body);
+bool http_stream_more(HttpPool* pool, int handle);
+char* http_stream_line(HttpPool* pool, int handle);
+char* http_stream_chunk(HttpPool* pool, int handle);
+bool http_close_stream(HttpPool* pool, int handle);
+
+#endif // DMO_HTTP_H
@@ -0,0 +1,203 @@
+/*
+ * DMO Limits Implementation
+ * Per-run budgets of steps, wall time, allocated bytes and output bytes
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_limits.h"
+#include "dmo_runtime.h"
+#include "dmo_stack.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+DMOLimits dmo_limits = {0, 0, 0, 0};
+
+void limits_from_env() {
+    const char* value = getenv("DMO_MAX_STEPS");
+    if (value && atoll(value) > 0) {
+        dmo_limits.steps = atoll(value);
+    }
+    value = getenv("DMO_MAX_SECONDS");
+    if (value && atof(value) > 0) {
+        dmo_limits.seconds = atof(value);
+    }
+    value = getenv("DMO_MAX_ALLOC");
+    if (value && atoll(value) > 0) {
+        dmo_limits.alloc = atoll(value);
+    }
+    value = getenv("DMO_MAX_OUTPUT");
+    if (value && atoll(value) > 0) {
+        dmo_limits.output = atoll(value);
+    }
+}
+
+DMOBudget* create_budget(const DMOLimits* limits) {
+    if (!limits->steps && !limits->seconds && !limits->alloc && !limits->output) {
+        return NULL;
+    }
+    
+    DMOBudget* budget = malloc(sizeof(DMOBudget));
+    budget->limits = *limits;
+    reset_budget(budget);
+    return budget;
+}
+
+void reset_budget(DMOBudget* budget) {
+    budget->start = now_seconds();
+    budget->steps = 0;
+    budget->alloc = 0;
+    budget->output = 0;
+    budget->exceeded = LIMIT_NONE;
+}
+
+void free_budget(DMOBudget* budget) {
+    free(budget);
+}
+
+// The first limit reached is the one reported; every thread that notices
+// unwinds its own calls
+static bool stop(InterpreterContext* ctx, DMOBudget* budget, int kind) {
+    int none = LIMIT_NONE;
+    __atomic_compare_exchange_n(&budget->exceeded, &none, kind, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    ctx->calls->stopped = true;
+    ctx->has_return = true;
+    return false;
+}
+
+bool take_steps(InterpreterContext* ctx) {
+    DMOCallStack* calls = ctx->calls;
+    DMOBudget* budget = ctx->runtime->budget;
+    if (!budget) {
+        calls->steps_left = LONG_MAX;
+        return true;
+    }
+    
+    int exceeded = __atomic_load_n(&budget->exceeded, __ATOMIC_ACQUIRE);
+    if (exceeded != LIMIT_NONE) {
+        return stop(ctx, budget, exceeded);
+    }
+    if (budget->limits.seconds && now_seconds() - budget->start > budget->limits.seconds) {
+        return stop(ctx, budget, LIMIT_TIME);
+    }
+    
+    long long batch = DMO_STEP_BATCH;
+    long long taken = __atomic_fetch_add(&budget->steps, batch, __ATOMIC_RELAXED);
+    if (budget->limits.steps) {
+        if (taken >= budget->limits.steps) {
+            return stop(ctx, budget, LIMIT_STEPS);
+        }
+        if (budget->limits.steps - taken < batch) {
+            batch = budget->limits.steps - taken;
+        }
+    }
+    
+    // This step is the first of the batch
+    calls->steps_left = batch - 1;
+    return true;
+}
+
+bool within_budget(InterpreterContext* ctx) {
+    DMOBudget* budget = ctx->runtime->budget;
+    if (!budget) {
+        return true;
+    }
+    int exceeded = __atomic_load_n(&budget->exceeded, __ATOMIC_ACQUIRE);
+    return exceeded == LIMIT_NONE || stop(ctx, budget, exceeded);
+}
+
+// Takes what the thread's credit is short of bytes, or a batch if that is
+// more. A refused allocation doesn't happen, so it isn't counted either.
+static bool take_alloc(InterpreterContext* ctx, size_t bytes) {
+    DMOCallStack* calls = ctx->calls;
+    DMOBudget* budget = ctx->runtime->budget;
+    if (!budget) {
+        calls->alloc_left = LLONG_MAX;
+        return true;
+    }
+    
+    long long needed = (long long)bytes - calls->alloc_left;
+    long long batch = needed > DMO_ALLOC_BATCH ? needed : DMO_ALLOC_BATCH;
+    long long taken = __atomic_fetch_add(&budget->alloc, batch, __ATOMIC_RELAXED);
+    long long limit = budget->limits.alloc;
+    if (limit && taken + needed > limit) {
+        __atomic_sub_fetch(&budget->alloc, batch, __ATOMIC_RELAXED);
+        return stop(ctx, budget, LIMIT_ALLOC);
+    }
+    if (limit && taken + batch > limit) {
+        __atomic_sub_fetch(&budget->alloc, taken + batch - limit, __ATOMIC_RELAXED);
+        batch = limit - taken;
+    }
+    
+    calls->alloc_left += batch - (long long)bytes;
+    return true;
+}
+
+bool charge_alloc(InterpreterContext* ctx, size_t bytes) {
+    DMOCallStack* calls = ctx->calls;
+    if ((long long)bytes <= calls->alloc_left) {
+        calls->alloc_left -= bytes;
+        return true;
+    }
+    return take_alloc(ctx, bytes);
+}
+
+// Printing costs far more than an atomic add, so output isn't batched
+bool charge_output(InterpreterContext* ctx, size_t bytes) {
+    DMOBudget* budget = ctx->runtime->budget;
+    if (!budget) {
+        return true;
+    }
+    long long total = __atomic_add_fetch(&budget->output, (long long)bytes, __ATOMIC_RELAXED);
+    if (budget->limits.output && total > budget->limits.output) {
+        return stop(ctx, budget, LIMIT_OUTPUT);
+    }
+    return true;
+}
+
+void return_unused(DMOBudget* budget, DMOCallStack* calls) {
+    if (budget && calls->steps_left > 0) {
+        __atomic_sub_fetch(&budget->steps, (long long)calls->steps_left, __ATOMIC_RELAXED);
+    }
+    if (budget && calls->alloc_left > 0) {
+        __atomic_sub_fetch(&budget->alloc, calls->alloc_left, __ATOMIC_RELAXED);
+    }
+    calls->steps_left = 0;
+    calls->alloc_left = 0;
+}
+
+bool report_budget(const DMOBudget* budget) {
+    if (!budget) {
+        return false;
+    }
+    
+    const DMOLimits* limits = &budget->limits;
+    double seconds = now_seconds() - budget->start;
+    long long steps = budget->steps;
+    if (limits->steps && steps > limits->steps) {
+        steps = limits->steps;
+    }
+    
+    switch (budget->exceeded) {
+        case LIMIT_STEPS:
+            fprintf(stderr, "Error: Run stopped: step limit of %lld reached\n", limits->steps);
+            break;
+        case LIMIT_TIME:
+            fprintf(stderr, "Error: Run stopped: time limit of %g s reached\n", limits->seconds);
+            break;
+        case LIMIT_ALLOC:
+            fprintf(stderr, "Error: Run stopped: allocation limit of %lld bytes reached\n", limits->alloc);
+            break;
+        case LIMIT_OUTPUT:
+            fprintf(stderr, "Error: Run stopped: output limit of %lld bytes reached\n", limits->output);
+            break;
+        default:
+            dmo_log(DMO_LOG_INFO, "Budget used: %lld steps, %.3f s, %lld bytes allocated, %lld bytes of output\n",
+                    steps, seconds, budget->alloc, budget->output);
+            return false;
+    }
+    fprintf(stderr, "Used: %lld steps, %.3f s, %lld bytes allocated, %lld bytes of output\n",
+            steps, seconds, budget->alloc, budget->output);
+    return true;
+}
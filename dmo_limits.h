@@ -0,0 +1,90 @@
+/*
+ * DMO Limits Header
+ * Per-run budgets of steps, wall time, allocated bytes and output bytes
+ */
+
+#ifndef DMO_LIMITS_H
+#define DMO_LIMITS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "interpreter.h"
+
+#define DMO_STEP_BATCH 4096           // steps a thread takes from the budget at a time
+#define DMO_ALLOC_BATCH (64 * 1024)   // bytes of allocation a thread takes at a time
+
+// What a run may use, 0 for no limit. A step is a loop iteration or a
+// function call. Allocated bytes are those of strings built by + or read
+// from files, arrays and map entries, counted as they are allocated and
+// not given back when freed, so they bound the memory a run holds as well
+// as the work of building it. Output is what is printed or written to
+// files.
+typedef struct {
+    long long steps;
+    double seconds;
+    long long alloc;
+    long long output;
+} DMOLimits;
+
+// Defaults for runtimes created from now on. Set from DMO_MAX_STEPS,
+// DMO_MAX_SECONDS, DMO_MAX_ALLOC, DMO_MAX_OUTPUT or the matching flags.
+extern DMOLimits dmo_limits;
+
+// The limit that stopped a run
+typedef enum {
+    LIMIT_NONE,
+    LIMIT_STEPS,
+    LIMIT_TIME,
+    LIMIT_ALLOC,
+    LIMIT_OUTPUT
+} LimitKind;
+
+// What one run has used, shared by every thread of the run: loop chunks
+// and spawned tasks run on copies of the runtime that point at the same
+// budget. Each thread takes steps and allocation a batch at a time and
+// counts them down on its own call stack, so loops only touch the shared
+// counters, and look at the clock, once per DMO_STEP_BATCH steps. Threads
+// other than the first may so end up to a batch short of a limit.
+typedef struct DMOBudget {
+    DMOLimits limits;
+    double start;
+    long long steps;      // handed out to threads
+    long long alloc;      // handed out to threads
+    long long output;
+    int exceeded;         // LimitKind of the first limit reached
+} DMOBudget;
+
+// Reads the DMO_MAX_* environment variables into dmo_limits
+void limits_from_env();
+
+// NULL when limits has none set, and then nothing is counted
+DMOBudget* create_budget(const DMOLimits* limits);
+void free_budget(DMOBudget* budget);
+
+// Starts counting again from zero, for the next input of a session.
+// Spawned tasks of earlier inputs still hold the budget, so it is reused.
+void reset_budget(DMOBudget* budget);
+
+// Called when a thread's batch of steps is used up: gives the thread its
+// next batch, or stops the thread and returns false once a limit is hit
+bool take_steps(InterpreterContext* ctx);
+
+// Stops the thread of ctx, returning false, when another thread of the
+// run has hit a limit
+bool within_budget(InterpreterContext* ctx);
+
+// Count bytes about to be allocated or just printed. False, with the
+// thread stopped, once a limit is hit; the allocation should then be
+// skipped.
+bool charge_alloc(InterpreterContext* ctx, size_t bytes);
+bool charge_output(InterpreterContext* ctx, size_t bytes);
+
+// Gives back what the thread of calls took from the budget and didn't
+// use, before the budget is reported
+void return_unused(DMOBudget* budget, DMOCallStack* calls);
+
+// Prints which limit stopped the run and what it had used, if one did.
+// Returns whether one did.
+bool report_budget(const DMOBudget* budget);
+
+#endif // DMO_LIMITS_H
@@ -0,0 +1,132 @@
+/*
+ * DMO Loop Analysis Implementation
+ * Recognizes counted for loops so the interpreter can run them on a native counter
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_loops.h"
+#include "dmo_builtins.h"
+#include <string.h>
+#include <stdbool.h>
+
+// A search of a loop body by one of the visitors below
+typedef struct {
+    const char* name;
+    bool found;
+} NameSearch;
+
+static bool is_name(ASTNode* node, const char* name) {
+    return node && node->type == AST_IDENTIFIER && strcmp(node->identifier.value, name) == 0;
+}
+
+static void find_use(ASTNode* node, void* data) {
+    NameSearch* search = data;
+    if ((node->type == AST_IDENTIFIER && strcmp(node->identifier.value, search->name) == 0) ||
+        (node->type == AST_VARIABLE_DECL && strcmp(node->var_decl.name, search->name) == 0)) {
+        search->found = true;
+    }
+}
+
+static void find_store(ASTNode* node, void* data) {
+    NameSearch* search = data;
+    if ((node->type == AST_ASSIGNMENT && is_name(node->assignment.target, search->name)) ||
+        (node->type == AST_VARIABLE_DECL && strcmp(node->var_decl.name, search->name) == 0)) {
+        search->found = true;
+    }
+}
+
+// Functions see their caller's variables, so a call of anything but a
+// builtin may read or assign any of them
+static void find_user_call(ASTNode* node, void* data) {
+    NameSearch* search = data;
+    if ((node->type == AST_FUNCTION_CALL && !builtin_table_find(core_builtins(), node->func_call.name)) ||
+        node->type == AST_SPAWN) {
+        search->found = true;
+    }
+}
+
+static bool body_has(ASTNode* body, void (*visit)(ASTNode* node, void* data), const char* name) {
+    NameSearch search = {name, false};
+    walk_ast(body, visit, &search);
+    return search.found;
+}
+
+// Numbers and variables the body doesn't assign, combined with + - *.
+// Division is left out since dividing by zero reports an error on every
+// evaluation.
+static bool is_invariant(ASTNode* node, ASTNode* body, const char* variable) {
+    switch (node->type) {
+        case AST_NUMBER:
+            return true;
+        case AST_IDENTIFIER:
+            return strcmp(node->identifier.value, variable) != 0 &&
+                   !body_has(body, find_store, node->identifier.value);
+        case AST_BINARY_OP:
+            return (node->binary_op.operator == TOKEN_PLUS || node->binary_op.operator == TOKEN_MINUS ||
+                    node->binary_op.operator == TOKEN_MULTIPLY) &&
+                   is_invariant(node->binary_op.left, body, variable) &&
+                   is_invariant(node->binary_op.right, body, variable);
+        case AST_UNARY_OP:
+            return node->unary_op.operator == TOKEN_MINUS &&
+                   is_invariant(node->unary_op.operand, body, variable);
+        default:
+            return false;
+    }
+}
+
+static int counted_loop_flags(ASTNode* node) {
+    ASTNode* init = node->for_loop.init;
+    ASTNode* condition = node->for_loop.condition;
+    ASTNode* increment = node->for_loop.increment;
+    if (!init || init->type != AST_VARIABLE_DECL || !condition || !increment) {
+        return 0;
+    }
+    
+    const char* variable = init->var_decl.name;
+    if (condition->type != AST_BINARY_OP || !is_name(condition->binary_op.left, variable)) {
+        return 0;
+    }
+    switch (condition->binary_op.operator) {
+        case TOKEN_LESS:
+        case TOKEN_LESS_EQUAL:
+        case TOKEN_GREATER:
+        case TOKEN_GREATER_EQUAL:
+            break;
+        default:
+            return 0;
+    }
+    
+    if (increment->type != AST_ASSIGNMENT || !is_name(increment->assignment.target, variable)) {
+        return 0;
+    }
+    ASTNode* step = increment->assignment.value;
+    if (step->type != AST_BINARY_OP ||
+        (step->binary_op.operator != TOKEN_PLUS && step->binary_op.operator != TOKEN_MINUS) ||
+        !is_name(step->binary_op.left, variable) || step->binary_op.right->type != AST_NUMBER) {
+        return 0;
+    }
+    
+    ASTNode* body = node->for_loop.body;
+    ASTNode* bound = condition->binary_op.right;
+    bool user_call = body_has(body, find_user_call, NULL);
+    int flags = COUNTED_LOOP;
+    if (!user_call && is_invariant(bound, body, variable)) {
+        flags |= COUNTED_BOUND_INVARIANT;
+    }
+    if (user_call || body_has(bound, find_user_call, NULL) ||
+        body_has(body, find_use, variable) || body_has(bound, find_use, variable)) {
+        flags |= COUNTED_OBSERVED;
+    }
+    return flags;
+}
+
+static void mark_loop(ASTNode* node, void* data) {
+    (void)data;
+    if (node->type == AST_FOR_LOOP && !node->for_loop.parallel) {
+        node->for_loop.counted = counted_loop_flags(node);
+    }
+}
+
+void analyze_loops(ASTNode* program) {
+    walk_ast(program, mark_loop, NULL);
+}
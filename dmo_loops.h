@@ -0,0 +1,22 @@
+/*
+ * DMO Loop Analysis Header
+ * Recognizes counted for loops so the interpreter can run them on a native counter
+ */
+
+#ifndef DMO_LOOPS_H
+#define DMO_LOOPS_H
+
+#include "ast.h"
+
+// Flags in for_loop.counted
+#define COUNTED_LOOP 1              // (int i = start; i < bound; i = i + step), or <=, >, >= and i - step
+#define COUNTED_BOUND_INVARIANT 2   // the bound can't change while the loop runs, so it is evaluated once
+#define COUNTED_OBSERVED 4          // the body may read or change i, so i is kept current every iteration
+
+// Sets for_loop.counted on every sequential for loop of program. Only the
+// shape is decided here; the interpreter still checks that i holds a
+// number and falls back to the ordinary loop when the body stores
+// anything else in it.
+void analyze_loops(ASTNode* program);
+
+#endif // DMO_LOOPS_H
@@ -0,0 +1,437 @@
+/*
+ * DMO Hash Map Implementation
+ * Open-addressing (Robin Hood) maps keyed by numbers or strings
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_map.h"
+#include "dmo_output.h"
+#include "dmo_limits.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAP_EMPTY 0
+#define MAP_TOMBSTONE 1
+#define MAP_MIN_CAPACITY 8
+#define MAP_MIGRATE_STEP 32
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hash_key(Value key) {
+    uint64_t hash;
+    
+    if (key.type == VALUE_STRING) {
+        hash = 0xcbf29ce484222325ULL;
+        for (const unsigned char* p = (const unsigned char*)key.string; *p; p++) {
+            hash = (hash ^ *p) * 0x100000001b3ULL;
+        }
+        hash = mix64(hash);
+    } else {
+        // -0 and 0 compare equal, so they must hash equal too
+        double number = key.number == 0 ? 0 : key.number;
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        hash = mix64(bits ^ 0x9e3779b97f4a7c15ULL);
+    }
+    
+    return hash <= MAP_TOMBSTONE ? hash + 2 : hash;
+}
+
+static bool keys_equal(Value a, Value b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    if (a.type == VALUE_STRING) {
+        return strcmp(a.string, b.string) == 0;
+    }
+    return a.number == b.number;
+}
+
+static bool valid_key(Value key) {
+    return key.type == VALUE_NUMBER || key.type == VALUE_STRING;
+}
+
+static void table_init(MapTable* table, size_t capacity) {
+    table->slots = calloc(capacity, sizeof(MapSlot));
+    table->capacity = capacity;
+    table->count = 0;
+}
+
+static void table_free(MapTable* table) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].hash > MAP_TOMBSTONE) {
+            free_value(table->slots[i].key);
+            free_value(table->slots[i].value);
+        }
+    }
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+static size_t probe_distance(const MapTable* table, uint64_t hash, size_t index) {
+    return (index - (size_t)hash) & (table->capacity - 1);
+}
+
+// Robin Hood lookup: an entry is never further from home than a richer one
+// sitting in its path, so the probe stops as soon as it meets one
+static MapSlot* table_find(const MapTable* table, Value key, uint64_t hash) {
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)hash & mask;
+    
+    for (size_t dist = 0; ; dist++) {
+        MapSlot* slot = &table->slots[index];
+        if (slot->hash == MAP_EMPTY || probe_distance(table, slot->hash, index) < dist) {
+            return NULL;
+        }
+        if (slot->hash == hash && keys_equal(slot->key, key)) {
+            return slot;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+// Robin Hood insert of a key known to be absent; takes ownership of key and value
+static void table_insert(MapTable* table, uint64_t hash, Value key, Value value) {
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)hash & mask;
+    MapSlot carry = {hash, key, value};
+    
+    for (size_t dist = 0; ; dist++) {
+        MapSlot* slot = &table->slots[index];
+        if (slot->hash == MAP_EMPTY) {
+            *slot = carry;
+            table->count++;
+            return;
+        }
+        
+        size_t existing = probe_distance(table, slot->hash, index);
+        if (existing < dist) {
+            MapSlot displaced = *slot;
+            *slot = carry;
+            carry = displaced;
+            dist = existing;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+// Backward-shift deletion keeps the table free of tombstones
+static void table_remove(MapTable* table, MapSlot* slot) {
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)(slot - table->slots);
+    
+    free_value(slot->key);
+    free_value(slot->value);
+    
+    for (;;) {
+        size_t next = (index + 1) & mask;
+        MapSlot* following = &table->slots[next];
+        if (following->hash == MAP_EMPTY || probe_distance(table, following->hash, next) == 0) {
+            break;
+        }
+        table->slots[index] = *following;
+        index = next;
+    }
+    
+    table->slots[index].hash = MAP_EMPTY;
+    table->count--;
+}
+
+// The old table only ever loses entries. Moved and deleted slots become
+// tombstones so probes for the entries behind them keep going.
+static MapSlot* old_find(const MapTable* old, Value key, uint64_t hash) {
+    size_t mask = old->capacity - 1;
+    size_t index = (size_t)hash & mask;
+    
+    for (size_t probes = 0; probes < old->capacity; probes++) {
+        MapSlot* slot = &old->slots[index];
+        if (slot->hash == MAP_EMPTY) {
+            return NULL;
+        }
+        if (slot->hash == hash && keys_equal(slot->key, key)) {
+            return slot;
+        }
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+static void migrate(DMOMap* map, size_t steps) {
+    while (map->old.slots && steps-- > 0) {
+        MapSlot* slot = &map->old.slots[map->migrate_pos];
+        if (slot->hash > MAP_TOMBSTONE) {
+            table_insert(&map->table, slot->hash, slot->key, slot->value);
+            slot->hash = MAP_TOMBSTONE;
+            map->old.count--;
+        }
+        
+        if (++map->migrate_pos == map->old.capacity) {
+            free(map->old.slots);
+            map->old.slots = NULL;
+            map->old.capacity = 0;
+            map->old.count = 0;
+        }
+    }
+}
+
+static void grow(DMOMap* map) {
+    // A resize still in flight has to land before the next one starts
+    if (map->old.slots) {
+        migrate(map, map->old.capacity);
+    }
+    
+    map->old = map->table;
+    map->migrate_pos = 0;
+    table_init(&map->table, map->old.capacity * 2);
+}
+
+DMOMap* map_create() {
+    DMOMap* map = malloc(sizeof(DMOMap));
+    map->refcount = 1;
+    table_init(&map->table, MAP_MIN_CAPACITY);
+    map->old.slots = NULL;
+    map->old.capacity = 0;
+    map->old.count = 0;
+    map->migrate_pos = 0;
+    return map;
+}
+
+// Atomic like array refcounts, maps can be shared with parallel code
+DMOMap* map_retain(DMOMap* map) {
+    __atomic_add_fetch(&map->refcount, 1, __ATOMIC_RELAXED);
+    return map;
+}
+
+void map_release(DMOMap* map) {
+    if (__atomic_sub_fetch(&map->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        table_free(&map->table);
+        if (map->old.slots) {
+            table_free(&map->old);
+        }
+        free(map);
+    }
+}
+
+size_t map_count(const DMOMap* map) {
+    return map->table.count + map->old.count;
+}
+
+static MapSlot* map_find(const DMOMap* map, Value key, uint64_t hash) {
+    MapSlot* slot = table_find(&map->table, key, hash);
+    if (!slot && map->old.slots) {
+        slot = old_find(&map->old, key, hash);
+    }
+    return slot;
+}
+
+bool map_get(DMOMap* map, Value key, Value* out_value) {
+    if (!valid_key(key)) {
+        return false;
+    }
+    
+    MapSlot* slot = map_find(map, key, hash_key(key));
+    if (!slot) {
+        return false;
+    }
+    *out_value = copy_value(slot->value);
+    return true;
+}
+
+void map_set(DMOMap* map, Value key, Value value) {
+    uint64_t hash = hash_key(key);
+    MapSlot* slot = map_find(map, key, hash);
+    if (slot) {
+        Value previous = slot->value;
+        slot->value = copy_value(value);
+        free_value(previous);
+        return;
+    }
+    
+    // Only inserts move entries along, so updating values leaves the slots
+    // an iteration cursor walks where they are
+    migrate(map, MAP_MIGRATE_STEP);
+    
+    // Keep the load factor under 4/5, counting entries still waiting to move
+    if ((map_count(map) + 1) * 5 > map->table.capacity * 4) {
+        grow(map);
+    }
+    table_insert(&map->table, hash, copy_value(key), copy_value(value));
+}
+
+bool map_delete(DMOMap* map, Value key) {
+    if (!valid_key(key)) {
+        return false;
+    }
+    
+    uint64_t hash = hash_key(key);
+    MapSlot* slot = table_find(&map->table, key, hash);
+    if (slot) {
+        table_remove(&map->table, slot);
+        return true;
+    }
+    
+    if (map->old.slots) {
+        slot = old_find(&map->old, key, hash);
+        if (slot) {
+            free_value(slot->key);
+            free_value(slot->value);
+            slot->hash = MAP_TOMBSTONE;
+            map->old.count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Cursors number the old table's slots first, then the current table's,
+// offset by one so that 0 can mean "start" and "done"
+MapSlot* map_slot_at(DMOMap* map, size_t cursor) {
+    if (cursor == 0) {
+        return NULL;
+    }
+    
+    size_t position = cursor - 1;
+    MapSlot* slot = NULL;
+    if (position < map->old.capacity) {
+        slot = &map->old.slots[position];
+    } else if (position - map->old.capacity < map->table.capacity) {
+        slot = &map->table.slots[position - map->old.capacity];
+    }
+    return slot && slot->hash > MAP_TOMBSTONE ? slot : NULL;
+}
+
+size_t map_next(const DMOMap* map, size_t cursor) {
+    size_t total = map->old.capacity + map->table.capacity;
+    
+    for (size_t position = cursor; position < total; position++) {
+        const MapSlot* slot = position < map->old.capacity
+            ? &map->old.slots[position]
+            : &map->table.slots[position - map->old.capacity];
+        if (slot->hash > MAP_TOMBSTONE) {
+            return position + 1;
+        }
+    }
+    return 0;
+}
+
+void print_map(const DMOMap* map, DMOOutput* out) {
+    bool first = true;
+    output_char(out, '{');
+    for (size_t cursor = map_next(map, 0); cursor; cursor = map_next(map, cursor)) {
+        MapSlot* slot = map_slot_at((DMOMap*)map, cursor);
+        if (!first) {
+            output_write(out, ", ", 2);
+        }
+        if (slot->key.type == VALUE_STRING) {
+            output_char(out, '"');
+            output_string(out, slot->key.string);
+            output_char(out, '"');
+        } else {
+            print_value(slot->key, out);
+        }
+        output_write(out, ": ", 2);
+        print_value(slot->value, out);
+        first = false;
+    }
+    output_char(out, '}');
+}
+
+// Builtins
+
+bool is_map_function(const char* name) {
+    return strncmp(name, "map.", 4) == 0;
+}
+
+static Value map_value(DMOMap* map) {
+    Value value;
+    value.type = VALUE_MAP;
+    value.map = map;
+    return value;
+}
+
+// What copy_value allocates for a key or value stored in a map
+static size_t value_bytes(Value value) {
+    return value.type == VALUE_STRING ? strlen(value.string) + 1 : 0;
+}
+
+Value call_map_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    const char* op = name + 4;
+    
+    if (strcmp(op, "new") == 0) {
+        return map_value(map_create());
+    }
+    
+    if (arg_count < 1) {
+        fprintf(stderr, "Error: %s() requires a map argument\n", name);
+        return create_void_value();
+    }
+    
+    Value target = execute_node(args[0], ctx);
+    if (target.type != VALUE_MAP) {
+        fprintf(stderr, "Error: %s() argument must be a map\n", name);
+        free_value(target);
+        return create_void_value();
+    }
+    
+    DMOMap* map = target.map;
+    Value result = create_void_value();
+    
+    if (strcmp(op, "len") == 0) {
+        result = create_number_value((double)map_count(map));
+    } else if (strcmp(op, "next") == 0 || strcmp(op, "key") == 0 || strcmp(op, "value") == 0) {
+        Value cursor = arg_count > 1 ? execute_node(args[1], ctx) : create_number_value(0);
+        if (cursor.type != VALUE_NUMBER || cursor.number < 0) {
+            fprintf(stderr, "Error: %s() cursor must be a number from map.next\n", name);
+        } else if (op[0] == 'n') {
+            result = create_number_value((double)map_next(map, (size_t)cursor.number));
+        } else {
+            MapSlot* slot = map_slot_at(map, (size_t)cursor.number);
+            if (!slot) {
+                fprintf(stderr, "Error: %s() cursor does not point at an entry\n", name);
+            } else {
+                result = copy_value(op[0] == 'k' ? slot->key : slot->value);
+            }
+        }
+        free_value(cursor);
+    } else if (strcmp(op, "get") == 0 || strcmp(op, "set") == 0 ||
+               strcmp(op, "has") == 0 || strcmp(op, "delete") == 0) {
+        Value key = arg_count > 1 ? execute_node(args[1], ctx) : create_void_value();
+        if (!valid_key(key)) {
+            fprintf(stderr, "Error: %s() key must be a number or a string\n", name);
+        } else if (strcmp(op, "get") == 0) {
+            if (!map_get(map, key, &result) && arg_count > 2) {
+                result = execute_node(args[2], ctx);
+            }
+        } else if (strcmp(op, "set") == 0) {
+            if (arg_count < 3) {
+                fprintf(stderr, "Error: %s() requires a key and a value\n", name);
+            } else {
+                Value value = execute_node(args[2], ctx);
+                if (charge_alloc(ctx, sizeof(MapSlot) + value_bytes(key) + value_bytes(value))) {
+                    map_set(map, key, value);
+                }
+                free_value(value);
+            }
+        } else if (strcmp(op, "has") == 0) {
+            result = create_number_value(map_find(map, key, hash_key(key)) ? 1 : 0);
+        } else {
+            result = create_number_value(map_delete(map, key) ? 1 : 0);
+        }
+        free_value(key);
+    } else {
+        fprintf(stderr, "Error: Unknown map function '%s'\n", name);
+    }
+    
+    free_value(target);
+    return result;
+}
@@ -0,0 +1,57 @@
+/*
+ * DMO Hash Map Header
+ * Open-addressing (Robin Hood) maps keyed by numbers or strings
+ */
+
+#ifndef DMO_MAP_H
+#define DMO_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "interpreter.h"
+
+// One slot of a table. hash 0 marks an empty slot and 1 a tombstone,
+// real hashes are remapped to stay clear of both
+typedef struct {
+    uint64_t hash;
+    Value key;
+    Value value;
+} MapSlot;
+
+typedef struct {
+    MapSlot* slots;
+    size_t capacity;     // power of two
+    size_t count;
+} MapTable;
+
+// Maps are shared by reference like arrays. Growing does not rehash in one
+// go: the previous table stays readable in `old` and every mutation moves a
+// few of its slots over until it is empty.
+struct DMOMap {
+    int refcount;
+    MapTable table;
+    MapTable old;
+    size_t migrate_pos;  // next slot of `old` to move
+};
+
+// Lifetime
+DMOMap* map_create();
+DMOMap* map_retain(DMOMap* map);
+void map_release(DMOMap* map);
+
+// Operations. Keys and values are copied in and out with copy_value
+size_t map_count(const DMOMap* map);
+bool map_get(DMOMap* map, Value key, Value* out_value);
+void map_set(DMOMap* map, Value key, Value value);
+bool map_delete(DMOMap* map, Value key);
+size_t map_next(const DMOMap* map, size_t cursor);
+MapSlot* map_slot_at(DMOMap* map, size_t cursor);
+void print_map(const DMOMap* map, DMOOutput* out);
+
+// Builtins: map.new, map.get, map.set, map.has, map.delete, map.len,
+// map.next, map.key, map.value
+bool is_map_function(const char* name);
+Value call_map_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+#endif // DMO_MAP_H
@@ -0,0 +1,189 @@
+/*
+ * DMO Memoization Implementation
+ * Bounded caches of the results of pure user functions, keyed on argument values
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_memo.h"
+#include "dmo_output.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMO_MIN_CAPACITY 64
+
+bool dmo_memoize = true;
+
+MemoCache* memo_create(int arg_count) {
+    MemoCache* cache = malloc(sizeof(MemoCache));
+    cache->capacity = MEMO_MIN_CAPACITY;
+    cache->slots = calloc(cache->capacity, sizeof(MemoEntry));
+    cache->count = 0;
+    cache->arg_count = arg_count;
+    cache->enabled = true;
+    cache->lookups = 0;
+    cache->hits = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+static void free_entries(MemoCache* cache) {
+    for (size_t i = 0; i < cache->capacity; i++) {
+        MemoEntry* entry = &cache->slots[i];
+        if (entry->hash) {
+            for (int a = 0; a < cache->arg_count; a++) {
+                free_value(entry->args[a]);
+            }
+            free(entry->args);
+            free_value(entry->result);
+        }
+    }
+}
+
+void memo_free(MemoCache* cache) {
+    free_entries(cache);
+    free(cache->slots);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+bool memo_cacheable(const Value* args, int arg_count) {
+    for (int i = 0; i < arg_count; i++) {
+        if (args[i].type != VALUE_NUMBER && args[i].type != VALUE_STRING) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a over the number bits and string bytes. Numbers are compared by
+// their bits too, so 0 and -0 are different keys.
+static uint64_t hash_args(const Value* args, int arg_count) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < arg_count; i++) {
+        const unsigned char* bytes;
+        size_t length;
+        if (args[i].type == VALUE_NUMBER) {
+            bytes = (const unsigned char*)&args[i].number;
+            length = sizeof(double);
+        } else {
+            bytes = (const unsigned char*)args[i].string;
+            length = strlen(args[i].string) + 1;
+        }
+        for (size_t b = 0; b < length; b++) {
+            hash ^= bytes[b];
+            hash *= 1099511628211ULL;
+        }
+        hash ^= (uint64_t)args[i].type;
+        hash *= 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+static bool same_args(const Value* a, const Value* b, int arg_count) {
+    for (int i = 0; i < arg_count; i++) {
+        if (a[i].type != b[i].type) {
+            return false;
+        }
+        if (a[i].type == VALUE_NUMBER ? memcmp(&a[i].number, &b[i].number, sizeof(double)) != 0
+                                      : strcmp(a[i].string, b[i].string) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static MemoEntry* find_slot(MemoEntry* slots, size_t capacity, uint64_t hash,
+                            const Value* args, int arg_count) {
+    size_t i = hash & (capacity - 1);
+    while (slots[i].hash && (slots[i].hash != hash || !same_args(slots[i].args, args, arg_count))) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &slots[i];
+}
+
+// After MEMO_PROBE_CALLS lookups a function that mostly misses stops
+// being cached, so functions that are pure but rarely see the same
+// arguments twice only pay for the probe
+static void judge_hit_rate(MemoCache* cache) {
+    if (cache->lookups == MEMO_PROBE_CALLS &&
+        cache->hits < (unsigned long)(MEMO_PROBE_CALLS * MEMO_MIN_HIT_RATE)) {
+        cache->enabled = false;
+        free_entries(cache);
+        memset(cache->slots, 0, sizeof(MemoEntry) * cache->capacity);
+        cache->count = 0;
+    }
+}
+
+bool memo_lookup(MemoCache* cache, const Value* args, Value* result) {
+    uint64_t hash = hash_args(args, cache->arg_count);
+
+    pthread_mutex_lock(&cache->lock);
+    MemoEntry* entry = find_slot(cache->slots, cache->capacity, hash, args, cache->arg_count);
+    bool hit = entry->hash != 0;
+    if (hit) {
+        *result = copy_value(entry->result);
+        cache->hits++;
+    }
+    cache->lookups++;
+    judge_hit_rate(cache);
+    pthread_mutex_unlock(&cache->lock);
+
+    return hit;
+}
+
+static void grow(MemoCache* cache) {
+    size_t capacity = cache->capacity * 2;
+    MemoEntry* slots = calloc(capacity, sizeof(MemoEntry));
+    for (size_t i = 0; i < cache->capacity; i++) {
+        MemoEntry* entry = &cache->slots[i];
+        if (entry->hash) {
+            *find_slot(slots, capacity, entry->hash, entry->args, cache->arg_count) = *entry;
+        }
+    }
+    free(cache->slots);
+    cache->slots = slots;
+    cache->capacity = capacity;
+}
+
+void memo_store(MemoCache* cache, const Value* args, Value result) {
+    if (result.type != VALUE_NUMBER && result.type != VALUE_STRING) {
+        return;
+    }
+
+    uint64_t hash = hash_args(args, cache->arg_count);
+
+    pthread_mutex_lock(&cache->lock);
+    if (!cache->enabled) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    if (cache->count == MEMO_MAX_ENTRIES) {
+        free_entries(cache);
+        memset(cache->slots, 0, sizeof(MemoEntry) * cache->capacity);
+        cache->count = 0;
+    } else if ((cache->count + 1) * 2 > cache->capacity) {
+        grow(cache);
+    }
+
+    // Another thread may have stored the same call meanwhile
+    MemoEntry* entry = find_slot(cache->slots, cache->capacity, hash, args, cache->arg_count);
+    if (!entry->hash) {
+        entry->hash = hash;
+        entry->args = malloc(sizeof(Value) * (cache->arg_count ? cache->arg_count : 1));
+        for (int i = 0; i < cache->arg_count; i++) {
+            entry->args[i] = copy_value(args[i]);
+        }
+        entry->result = copy_value(result);
+        cache->count++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void memo_log_profile(const char* name, const MemoCache* cache) {
+    if (cache->lookups) {
+        dmo_log(DMO_LOG_INFO, "Memo profile: %s: %lu calls, %lu hits (%.1f%%), %zu cached%s\n",
+                name, cache->lookups, cache->hits, 100.0 * cache->hits / cache->lookups,
+                cache->count, cache->enabled ? "" : ", disabled after a low hit rate");
+    }
+}
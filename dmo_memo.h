@@ -0,0 +1,61 @@
+/*
+ * DMO Memoization Header
+ * Bounded caches of the results of pure user functions, keyed on argument values
+ */
+
+#ifndef DMO_MEMO_H
+#define DMO_MEMO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "interpreter.h"
+
+#define MEMO_MAX_ENTRIES 65536   // a full cache is emptied and starts over
+#define MEMO_PROBE_CALLS 4096    // lookups before the hit rate is judged
+#define MEMO_MIN_HIT_RATE 0.125  // below this the function is no longer cached
+
+// Whether pure functions are memoized in runs started from now on. Set
+// from DMO_MEMO=0 or --no-memo.
+extern bool dmo_memoize;
+
+// One call's arguments, numbers and strings only, and what it returned.
+// hash 0 marks an empty slot.
+typedef struct {
+    uint64_t hash;
+    Value* args;
+    Value result;
+} MemoEntry;
+
+// Open addressing with linear probing, at most half full. Locked, since
+// parallel loops and spawned tasks call the same functions.
+typedef struct MemoCache {
+    MemoEntry* slots;
+    size_t capacity;     // power of two
+    size_t count;
+    int arg_count;
+    bool enabled;        // cleared when the hit rate stays too low
+    unsigned long lookups;
+    unsigned long hits;
+    pthread_mutex_t lock;
+} MemoCache;
+
+// Function prototypes
+MemoCache* memo_create(int arg_count);
+void memo_free(MemoCache* cache);
+
+// Arguments that are not all numbers and strings are never cached
+bool memo_cacheable(const Value* args, int arg_count);
+
+// On a hit, stores a copy of the cached result in *result
+bool memo_lookup(MemoCache* cache, const Value* args, Value* result);
+
+// Keeps copies of args and result; results other than numbers and
+// strings are not kept
+void memo_store(MemoCache* cache, const Value* args, Value result);
+
+// Logs the hit rate of a cache that has been used, at -v
+void memo_log_profile(const char* name, const MemoCache* cache);
+
+#endif // DMO_MEMO_H
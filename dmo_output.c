@@ -0,0 +1,166 @@
+/*
+ * DMO Output Implementation
+ * Buffered program output and verbosity-gated runtime diagnostics
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <math.h>
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+int dmo_verbosity = DMO_LOG_QUIET;
+
+void output_init(DMOOutput* out, FILE* stream) {
+    out->buffer = malloc(OUTPUT_BUFFER_SIZE);
+    out->used = 0;
+    out->capacity = OUTPUT_BUFFER_SIZE;
+    out->stream = stream;
+    out->written = 0;
+    
+    // Interactive sessions keep seeing each line as it is printed
+    out->line_buffered = stream && isatty(fileno(stream));
+}
+
+// Captured output keeps everything, so the buffer doubles as needed
+static void output_grow(DMOOutput* out, size_t needed) {
+    while (out->capacity < needed) {
+        out->capacity *= 2;
+    }
+    out->buffer = realloc(out->buffer, out->capacity);
+}
+
+const char* output_text(DMOOutput* out, size_t* length) {
+    if (out->used + 1 > out->capacity) {
+        output_grow(out, out->used + 1);
+    }
+    out->buffer[out->used] = '\0';
+    
+    if (length) {
+        *length = out->used;
+    }
+    return out->buffer;
+}
+
+void output_reset(DMOOutput* out) {
+    out->used = 0;
+}
+
+void output_free(DMOOutput* out) {
+    output_flush(out);
+    free(out->buffer);
+    out->buffer = NULL;
+}
+
+void output_flush(DMOOutput* out) {
+    if (!out->stream) {
+        return;
+    }
+    
+    if (out->used > 0) {
+        fwrite(out->buffer, 1, out->used, out->stream);
+        out->used = 0;
+    }
+    fflush(out->stream);
+}
+
+void output_write(DMOOutput* out, const char* data, size_t length) {
+    out->written += length;
+    if (out->used + length > out->capacity) {
+        if (!out->stream) {
+            output_grow(out, out->used + length);
+            memcpy(out->buffer + out->used, data, length);
+            out->used += length;
+            return;
+        }
+        
+        output_flush(out);
+        
+        // Large blocks skip the buffer
+        if (length >= OUTPUT_BUFFER_SIZE) {
+            fwrite(data, 1, length, out->stream);
+            return;
+        }
+    }
+    
+    memcpy(out->buffer + out->used, data, length);
+    out->used += length;
+    
+    if (out->line_buffered && memchr(data, '\n', length)) {
+        output_flush(out);
+    }
+}
+
+void output_string(DMOOutput* out, const char* text) {
+    output_write(out, text, strlen(text));
+}
+
+void output_char(DMOOutput* out, char c) {
+    out->written++;
+    if (out->used == out->capacity) {
+        if (out->stream) {
+            output_flush(out);
+        } else {
+            output_grow(out, out->used + 1);
+        }
+    }
+    out->buffer[out->used++] = c;
+    
+    if (c == '\n' && out->line_buffered) {
+        output_flush(out);
+    }
+}
+
+// Most printed numbers are integral, and for those "%.6g" is just the
+// digits as long as there are at most six of them
+int format_number(double number, char* buffer) {
+    if (number > -1e6 && number < 1e6 && number == (double)(int)number) {
+        int value = (int)number;
+        char digits[8];
+        int count = 0;
+        int length = 0;
+        
+        if (value < 0 || (value == 0 && signbit(number))) {
+            buffer[length++] = '-';
+            value = -value;
+        }
+        do {
+            digits[count++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (count > 0) {
+            buffer[length++] = digits[--count];
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+    
+    return snprintf(buffer, NUMBER_TEXT_SIZE, "%.6g", number);
+}
+
+void output_number(DMOOutput* out, double number) {
+    char text[NUMBER_TEXT_SIZE];
+    int length = format_number(number, text);
+    output_write(out, text, (size_t)length);
+}
+
+void dmo_log(int level, const char* format, ...) {
+    if (level > dmo_verbosity) {
+        return;
+    }
+    
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
@@ -0,0 +1,54 @@
+/*
+ * DMO Output Header
+ * Buffered program output and verbosity-gated runtime diagnostics
+ */
+
+#ifndef DMO_OUTPUT_H
+#define DMO_OUTPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Diagnostic levels, selected with -v / -vv or DMO_VERBOSE
+#define DMO_LOG_QUIET 0    // errors only
+#define DMO_LOG_INFO 1     // phase and module banners
+#define DMO_LOG_DEBUG 2    // per-call chatter such as graphics element creation
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define NUMBER_TEXT_SIZE 32
+
+// Process-wide, set once at startup
+extern int dmo_verbosity;
+
+// Program output of one runtime. Everything a script prints goes through
+// the buffer, which is flushed when full, when the runtime ends and before
+// it waits for input or hands the terminal to another process. On a
+// terminal it is also flushed at every newline. Without a stream the
+// output is captured: the buffer grows instead and is never flushed.
+typedef struct {
+    char* buffer;
+    size_t used;
+    size_t capacity;
+    FILE* stream;
+    bool line_buffered;
+    size_t written;      // bytes written since output_init, flushed or not
+} DMOOutput;
+
+void output_init(DMOOutput* out, FILE* stream);
+void output_free(DMOOutput* out);
+const char* output_text(DMOOutput* out, size_t* length);
+void output_reset(DMOOutput* out);
+void output_write(DMOOutput* out, const char* data, size_t length);
+void output_string(DMOOutput* out, const char* text);
+void output_char(DMOOutput* out, char c);
+void output_number(DMOOutput* out, double number);
+void output_flush(DMOOutput* out);
+
+// Formats like printf("%.6g") and returns the length
+int format_number(double number, char* buffer);
+
+// Runtime diagnostics go to stderr when level <= dmo_verbosity
+void dmo_log(int level, const char* format, ...);
+
+#endif // DMO_OUTPUT_H
@@ -0,0 +1,421 @@
+/*
+ * DMO Parallel Execution Implementation
+ * parallel for loops and spawn/join tasks on the work-stealing scheduler
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_parallel.h"
+#include "dmo_output.h"
+#include "dmo_stack.h"
+#include "dmo_limits.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Iteration space of a parallel for: start + k * step for k in [0, count)
+typedef struct {
+    const char* variable;
+    double start;
+    double step;
+    long count;
+} ParallelRange;
+
+// A contiguous run of iterations, executed in its own context
+typedef struct {
+    ASTNode* loop;
+    ParallelRange* range;
+    InterpreterContext* parent;
+    long first;
+    long last;
+    DMORuntime runtime;     // parent's runtime with a private output buffer
+    double* partials;       // final value of each reduction variable
+    bool returned;
+} ParallelChunk;
+
+// Threads start on the first parallel construct a runtime meets, and the
+// copies made for chunks and tasks are taken after this, so they share them
+static void ensure_parallel_state(DMORuntime* runtime) {
+    if (runtime->scheduler) {
+        return;
+    }
+    
+    runtime->scheduler = create_scheduler(runtime->jobs > 0 ? runtime->jobs : scheduler_default_workers());
+    runtime->tasks = malloc(sizeof(struct SpawnTable));
+    runtime->tasks->slots = NULL;
+    runtime->tasks->count = 0;
+    runtime->tasks->capacity = 0;
+    pthread_mutex_init(&runtime->tasks->lock, NULL);
+}
+
+// Work that runs elsewhere prints into a private buffer; the owner appends
+// it in program order once the work has finished
+static void fork_runtime(DMORuntime* copy, DMORuntime* runtime) {
+    // Copies share the original's graphics, HTTP pool, files and
+    // generators, so those can't be set up lazily inside a copy
+    runtime_graphics(runtime);
+    runtime_http(runtime);
+    runtime_files(runtime);
+    runtime_generators(runtime);
+    *copy = *runtime;
+    output_init(&copy->output, NULL);
+    
+    // The module registry is copied too, not shared. Modules loaded
+    // before the fork stay usable, but a copy may not load more: they
+    // would be registered in the copy alone and lost with it.
+    copy->forked = true;
+}
+
+static void merge_runtime_output(DMORuntime* runtime, DMORuntime* copy) {
+    size_t length = 0;
+    const char* text = output_text(&copy->output, &length);
+    output_write(&runtime->output, text, length);
+    output_free(&copy->output);
+}
+
+static bool is_loop_variable(ASTNode* node, const char* name) {
+    return node && node->type == AST_IDENTIFIER && strcmp(node->identifier.value, name) == 0;
+}
+
+// Only counted loops can be split up front:
+//   (int i = start; i < end; i = i + step) with step > 0, or i <= end
+static bool parallel_range(ASTNode* node, InterpreterContext* ctx, ParallelRange* range) {
+    ASTNode* init = node->for_loop.init;
+    ASTNode* condition = node->for_loop.condition;
+    ASTNode* increment = node->for_loop.increment;
+    
+    if (!init || init->type != AST_VARIABLE_DECL || !condition || !increment ||
+        condition->type != AST_BINARY_OP ||
+        (condition->binary_op.operator != TOKEN_LESS && condition->binary_op.operator != TOKEN_LESS_EQUAL) ||
+        !is_loop_variable(condition->binary_op.left, init->var_decl.name) ||
+        increment->type != AST_ASSIGNMENT ||
+        !is_loop_variable(increment->assignment.target, init->var_decl.name) ||
+        increment->assignment.value->type != AST_BINARY_OP ||
+        increment->assignment.value->binary_op.operator != TOKEN_PLUS ||
+        !is_loop_variable(increment->assignment.value->binary_op.left, init->var_decl.name)) {
+        fprintf(stderr, "Error: parallel for needs the form (int i = start; i < end; i = i + step)\n");
+        return false;
+    }
+    
+    Value start = init->var_decl.initializer ? execute_node(init->var_decl.initializer, ctx)
+                                             : create_number_value(0);
+    Value end = execute_node(condition->binary_op.right, ctx);
+    Value step = execute_node(increment->assignment.value->binary_op.right, ctx);
+    
+    bool valid = start.type == VALUE_NUMBER && end.type == VALUE_NUMBER &&
+                 step.type == VALUE_NUMBER && step.number > 0;
+    if (!valid) {
+        fprintf(stderr, "Error: parallel for bounds must be numbers and the step positive\n");
+    } else {
+        range->variable = init->var_decl.name;
+        range->start = start.number;
+        range->step = step.number;
+        
+        double span = (end.number - start.number) / step.number;
+        if (condition->binary_op.operator == TOKEN_LESS) {
+            range->count = span > 0 ? (long)ceil(span) : 0;
+        } else {
+            range->count = span >= 0 ? (long)floor(span) + 1 : 0;
+        }
+    }
+    
+    free_value(start);
+    free_value(end);
+    free_value(step);
+    return valid;
+}
+
+static double reduction_identity(const char* operator) {
+    if (strcmp(operator, "*") == 0) {
+        return 1;
+    }
+    if (strcmp(operator, "min") == 0) {
+        return INFINITY;
+    }
+    if (strcmp(operator, "max") == 0) {
+        return -INFINITY;
+    }
+    return 0;
+}
+
+static double reduction_combine(const char* operator, double a, double b) {
+    if (strcmp(operator, "*") == 0) {
+        return a * b;
+    }
+    if (strcmp(operator, "min") == 0) {
+        return b < a ? b : a;
+    }
+    if (strcmp(operator, "max") == 0) {
+        return b > a ? b : a;
+    }
+    return a + b;
+}
+
+static void run_parallel_chunk(void* arg, int worker) {
+    ParallelChunk* chunk = arg;
+    ASTNode* clause = chunk->loop->for_loop.parallel;
+    
+    InterpreterContext* ctx = create_interpreter_context();
+    ctx->parent = chunk->parent;
+    ctx->global_funcs = visible_functions(chunk->parent);
+    ctx->runtime = &chunk->runtime;
+    ctx->worker = worker;
+    ctx->calls = create_call_stack();
+    
+    // Reduction variables are private to the chunk and start at the identity
+    for (int i = 0; i < clause->parallel.reduction_count; i++) {
+        ASTNode* reduction = clause->parallel.reductions[i];
+        Value identity = create_number_value(reduction_identity(reduction->reduction.operator));
+        set_variable(ctx, reduction->reduction.name, "int", identity);
+    }
+    
+    for (long k = chunk->first; k < chunk->last; k++) {
+        Value index = create_number_value(chunk->range->start + k * chunk->range->step);
+        set_variable(ctx, chunk->range->variable, "int", index);
+        
+        Value result = execute_node(chunk->loop->for_loop.body, ctx);
+        free_value(result);
+        
+        if (ctx->has_return || !within_budget(ctx)) {
+            // Also set when a call went past the depth limit or a limit of
+            // the run was hit, which is reported elsewhere
+            chunk->returned = !ctx->calls->stopped;
+            break;
+        }
+    }
+    
+    for (int i = 0; i < clause->parallel.reduction_count; i++) {
+        Variable* var = get_variable(ctx, clause->parallel.reductions[i]->reduction.name);
+        chunk->partials[i] = var->value.type == VALUE_NUMBER ? var->value.number : NAN;
+    }
+    
+    free_call_stack(ctx->calls);
+    free_interpreter_context(ctx);
+}
+
+// Iterations are split into contiguous chunks, a few per worker, and run
+// on the scheduler while this thread helps. Afterwards, in chunk order,
+// the output of each chunk is appended and the reductions are combined,
+// so a run prints the same as the sequential loop would.
+Value execute_parallel_for(ASTNode* node, InterpreterContext* ctx) {
+    ASTNode* clause = node->for_loop.parallel;
+    ParallelRange range;
+    if (!parallel_range(node, ctx, &range) || range.count == 0) {
+        return create_void_value();
+    }
+    
+    // Reduction targets are written here, by the thread that owns them
+    int reduction_count = clause->parallel.reduction_count;
+    Variable** targets = malloc(sizeof(Variable*) * (reduction_count ? reduction_count : 1));
+    for (int i = 0; i < reduction_count; i++) {
+        const char* name = clause->parallel.reductions[i]->reduction.name;
+        targets[i] = get_variable(ctx, name);
+        if (!targets[i] || targets[i]->value.type != VALUE_NUMBER) {
+            fprintf(stderr, "Error: Reduction variable '%s' must be a declared number\n", name);
+            free(targets);
+            return create_void_value();
+        }
+    }
+    
+    ensure_parallel_state(ctx->runtime);
+    DMOScheduler* sched = ctx->runtime->scheduler;
+    
+    long chunk_count = (long)sched->worker_count * PARALLEL_CHUNKS_PER_WORKER;
+    if (chunk_count > range.count) {
+        chunk_count = range.count;
+    }
+    
+    ParallelChunk* chunks = malloc(sizeof(ParallelChunk) * chunk_count);
+    DMOTaskGroup group = {0};
+    for (long c = 0; c < chunk_count; c++) {
+        ParallelChunk* chunk = &chunks[c];
+        chunk->loop = node;
+        chunk->range = &range;
+        chunk->parent = ctx;
+        chunk->first = range.count * c / chunk_count;
+        chunk->last = range.count * (c + 1) / chunk_count;
+        chunk->partials = malloc(sizeof(double) * (reduction_count ? reduction_count : 1));
+        chunk->returned = false;
+        fork_runtime(&chunk->runtime, ctx->runtime);
+    }
+    
+    // Pushed last to first: this worker pops from the tail and starts with
+    // chunk 0, thieves take the far end of the range
+    for (long c = chunk_count - 1; c >= 0; c--) {
+        scheduler_submit_group(sched, ctx->worker, &group, run_parallel_chunk, &chunks[c]);
+    }
+    scheduler_join(sched, ctx->worker, &group);
+    
+    bool returned = false;
+    for (long c = 0; c < chunk_count; c++) {
+        merge_runtime_output(ctx->runtime, &chunks[c].runtime);
+        for (int i = 0; i < reduction_count; i++) {
+            const char* operator = clause->parallel.reductions[i]->reduction.operator;
+            targets[i]->value.number = reduction_combine(operator, targets[i]->value.number,
+                                                         chunks[c].partials[i]);
+        }
+        returned = returned || chunks[c].returned;
+        free(chunks[c].partials);
+    }
+    
+    if (returned) {
+        fprintf(stderr, "Error: return is not allowed inside a parallel for\n");
+    }
+    within_budget(ctx);
+    
+    free(chunks);
+    free(targets);
+    return create_void_value();
+}
+
+static void run_spawn_task(void* arg, int worker) {
+    SpawnTask* task = arg;
+    
+    // The task's function is the first frame of a call stack of its own
+    DMOCallStack* calls = create_call_stack();
+    InterpreterContext* func_ctx = push_frame(calls);
+    func_ctx->global_funcs = task->functions;
+    func_ctx->runtime = &task->runtime;
+    func_ctx->worker = worker;
+    func_ctx->function = task->func;
+    
+    // Bind parameters
+    for (int i = 0; i < task->arg_count; i++) {
+        ASTNode* param = task->func->parameters[i];
+        set_variable(func_ctx, param->var_decl.name, param->var_decl.type, task->args[i]);
+    }
+    
+    task->result = run_function_frame(func_ctx);
+    pop_frame(calls);
+    free_call_stack(calls);
+}
+
+Value execute_spawn(ASTNode* node, InterpreterContext* ctx) {
+    ASTNode* call = node->spawn.call;
+    Function* func = get_function(ctx, call->func_call.name);
+    if (!func) {
+        fprintf(stderr, "Error: spawn needs a user-defined function, '%s' is not one\n", call->func_call.name);
+        return create_void_value();
+    }
+    if (func->generator) {
+        fprintf(stderr, "Error: spawn can't start generator function '%s'\n", call->func_call.name);
+        return create_void_value();
+    }
+    
+    ensure_parallel_state(ctx->runtime);
+    
+    SpawnTask* task = malloc(sizeof(SpawnTask));
+    task->func = func;
+    task->functions = visible_functions(ctx);
+    task->arg_count = func->param_count < call->func_call.arg_count ? func->param_count
+                                                                    : call->func_call.arg_count;
+    task->args = malloc(sizeof(Value) * (task->arg_count ? task->arg_count : 1));
+    for (int i = 0; i < task->arg_count; i++) {
+        task->args[i] = execute_node(call->func_call.arguments[i], ctx);
+    }
+    task->done.pending = 0;
+    task->result = create_void_value();
+    fork_runtime(&task->runtime, ctx->runtime);
+    
+    struct SpawnTable* table = ctx->runtime->tasks;
+    pthread_mutex_lock(&table->lock);
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 16;
+        table->slots = realloc(table->slots, sizeof(SpawnTask*) * table->capacity);
+    }
+    table->slots[table->count++] = task;
+    int handle = table->count;
+    pthread_mutex_unlock(&table->lock);
+    
+    scheduler_submit_group(ctx->runtime->scheduler, ctx->worker, &task->done, run_spawn_task, task);
+    return create_number_value(handle);
+}
+
+static void free_spawn_task(SpawnTask* task) {
+    for (int i = 0; i < task->arg_count; i++) {
+        free_value(task->args[i]);
+    }
+    free(task->args);
+    free(task);
+}
+
+// Waits for the task, appends what it printed and hands over its result
+static Value join_task(SpawnTask* task, InterpreterContext* ctx) {
+    scheduler_join(ctx->runtime->scheduler, ctx->worker, &task->done);
+    merge_runtime_output(ctx->runtime, &task->runtime);
+    within_budget(ctx);
+    
+    Value result = task->result;
+    free_spawn_task(task);
+    return result;
+}
+
+bool is_parallel_function(const char* name) {
+    return strcmp(name, "join") == 0;
+}
+
+Value call_parallel_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    (void)name; // join is the only one
+    
+    if (arg_count != 1) {
+        fprintf(stderr, "Error: join requires a task handle\n");
+        return create_void_value();
+    }
+    
+    Value handle = execute_node(args[0], ctx);
+    struct SpawnTable* table = ctx->runtime->tasks;
+    SpawnTask* task = NULL;
+    
+    // Taking the slot makes a second join of the same handle an error
+    if (table && handle.type == VALUE_NUMBER) {
+        int slot = (int)handle.number - 1;
+        pthread_mutex_lock(&table->lock);
+        if (slot >= 0 && slot < table->count && handle.number == slot + 1) {
+            task = table->slots[slot];
+            table->slots[slot] = NULL;
+        }
+        pthread_mutex_unlock(&table->lock);
+    }
+    free_value(handle);
+    
+    if (!task) {
+        fprintf(stderr, "Error: join of an unknown or already joined task\n");
+        return create_void_value();
+    }
+    return join_task(task, ctx);
+}
+
+// Tasks that were never joined are waited for when the program ends; their
+// output is appended in spawn order and their results dropped
+void finish_spawned_tasks(DMORuntime* runtime) {
+    if (!runtime->scheduler) {
+        return;
+    }
+    
+    scheduler_wait(runtime->scheduler);
+    
+    struct SpawnTable* table = runtime->tasks;
+    for (int i = 0; i < table->count; i++) {
+        SpawnTask* task = table->slots[i];
+        if (task) {
+            merge_runtime_output(runtime, &task->runtime);
+            free_value(task->result);
+            free_spawn_task(task);
+        }
+    }
+    table->count = 0;
+}
+
+void free_parallel_state(DMORuntime* runtime) {
+    if (!runtime->scheduler) {
+        return;
+    }
+    
+    finish_spawned_tasks(runtime);
+    free_scheduler(runtime->scheduler);
+    pthread_mutex_destroy(&runtime->tasks->lock);
+    free(runtime->tasks->slots);
+    free(runtime->tasks);
+    runtime->scheduler = NULL;
+    runtime->tasks = NULL;
+}
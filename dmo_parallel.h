@@ -0,0 +1,47 @@
+/*
+ * DMO Parallel Execution Header
+ * parallel for loops and spawn/join tasks on the work-stealing scheduler
+ */
+
+#ifndef DMO_PARALLEL_H
+#define DMO_PARALLEL_H
+
+#include <pthread.h>
+#include "interpreter.h"
+#include "dmo_runtime.h"
+
+// Loop chunks per worker. More chunks balance uneven iterations better,
+// fewer keep the per-chunk context setup cheap.
+#define PARALLEL_CHUNKS_PER_WORKER 4
+
+// One spawned call. Arguments are evaluated by the spawner, so the task
+// never reads the spawner's variables while they may be changing.
+typedef struct {
+    Function* func;
+    Function* functions;    // what the spawner could call
+    Value* args;
+    int arg_count;
+    DMORuntime runtime;     // spawner's runtime with a private output buffer
+    DMOTaskGroup done;
+    Value result;
+} SpawnTask;
+
+// Handles given out by spawn, valid until joined. Handle n is slot n - 1.
+struct SpawnTable {
+    SpawnTask** slots;
+    int count;
+    int capacity;
+    pthread_mutex_t lock;
+};
+
+// Function prototypes
+Value execute_parallel_for(ASTNode* node, InterpreterContext* ctx);
+Value execute_spawn(ASTNode* node, InterpreterContext* ctx);
+void finish_spawned_tasks(DMORuntime* runtime);
+void free_parallel_state(DMORuntime* runtime);
+
+// Builtin: join(handle) waits for a task and returns its result
+bool is_parallel_function(const char* name);
+Value call_parallel_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+#endif // DMO_PARALLEL_H
@@ -0,0 +1,696 @@
+/*
+ * DMO REPL Implementation
+ * An interactive session, and re-running a script each time it is saved
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_repl.h"
+#include "lexer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "dmo_runtime.h"
+#include "dmo_source.h"
+#include "dmo_cache.h"
+#include "dmo_types.h"
+#include "dmo_loops.h"
+#include "dmo_memo.h"
+#include "dmo_stack.h"
+#include "dmo_parallel.h"
+#include "dmo_output.h"
+#include "dmo_limits.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define REPL_LINE_SIZE 4096
+#define WATCH_INTERVAL_MS 100
+
+// Where a scan of source text stands. Brackets inside string literals and
+// comments don't count.
+typedef struct {
+    int depth;      // open ( [ {
+    char quote;     // quote of the literal being scanned, 0 outside literals
+    bool comment;   // inside a // comment
+    char last;      // last character of code seen, other than blanks
+    size_t end;     // offset just after it
+} TextScan;
+
+// Moves scan past the character at text[i]; returns how many characters
+// that took
+static size_t scan_char(TextScan* scan, const char* text, size_t i, size_t length) {
+    char c = text[i];
+    if (scan->comment) {
+        scan->comment = c != '\n';
+        return 1;
+    }
+    if (scan->quote) {
+        if (c == '\\' && i + 1 < length) {
+            return 2;
+        }
+        if (c == scan->quote) {
+            scan->quote = 0;
+            scan->last = c;
+            scan->end = i + 1;
+        }
+        return 1;
+    }
+    
+    if (c == '/' && i + 1 < length && text[i + 1] == '/') {
+        scan->comment = true;
+        return 2;
+    }
+    if (c == '"' || c == '\'') {
+        scan->quote = c;
+    } else if (c == '(' || c == '[' || c == '{') {
+        scan->depth++;
+    } else if ((c == ')' || c == ']' || c == '}') && scan->depth > 0) {
+        scan->depth--;
+    }
+    if (!isspace((unsigned char)c)) {
+        scan->last = c;
+        scan->end = i + 1;
+    }
+    return 1;
+}
+
+// Skips blanks and comments from i
+static size_t skip_blank(const char* text, size_t i, size_t length) {
+    while (i < length) {
+        if (text[i] == '/' && i + 1 < length && text[i + 1] == '/') {
+            while (i < length && text[i] != '\n') {
+                i++;
+            }
+        } else if (isspace((unsigned char)text[i])) {
+            i++;
+        } else {
+            break;
+        }
+    }
+    return i;
+}
+
+static bool starts_word(const char* text, size_t i, size_t length, const char* word) {
+    size_t n = strlen(word);
+    return i + n <= length && memcmp(text + i, word, n) == 0 &&
+           (i + n == length || !(isalnum((unsigned char)text[i + n]) || text[i + n] == '_'));
+}
+
+// Length of the top-level item text starts with: a statement up to its
+// ';', or a block or function definition up to its '}', together with
+// the else parts that follow
+static size_t item_length(const char* text, size_t length) {
+    TextScan scan = {0, 0, false, 0, 0};
+    size_t i = 0;
+    while (i < length) {
+        char c = text[i];
+        bool code = !scan.comment && !scan.quote;
+        i += scan_char(&scan, text, i, length);
+        if (!code || scan.depth > 0 || (c != ';' && c != '}')) {
+            continue;
+        }
+        
+        size_t next = skip_blank(text, i, length);
+        if (c == '}' && next < length && text[next] == ';') {
+            return next + 1;    // map m = {...};
+        }
+        if (!starts_word(text, next, length, "else")) {
+            return i;
+        }
+        i = next;
+    }
+    return length;
+}
+
+// Names of functions that were defined again. Functions calling them may
+// have memoized results of the old definitions.
+typedef struct {
+    const char** names;
+    int count;
+    int capacity;
+} NameList;
+
+static bool list_has(const NameList* list, const char* name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->names[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void list_add(NameList* list, const char* name) {
+    if (list_has(list, name)) {
+        return;
+    }
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 8;
+        list->names = realloc(list->names, sizeof(char*) * list->capacity);
+    }
+    list->names[list->count++] = name;
+}
+
+static void add_definitions(NameList* list, ASTNode* program) {
+    for (int i = 0; i < program->program.statement_count; i++) {
+        if (program->program.statements[i]->type == AST_FUNCTION_DEF) {
+            list_add(list, program->program.statements[i]->func_def.name);
+        }
+    }
+}
+
+typedef struct {
+    const NameList* names;
+    bool found;
+} CallSearch;
+
+static void find_call(ASTNode* node, void* data) {
+    CallSearch* search = data;
+    if (node->type == AST_FUNCTION_CALL && list_has(search->names, node->func_call.name)) {
+        search->found = true;
+    }
+}
+
+// Drops the memoized results and purity of a function calling any of
+// changed, directly or through other functions, so they are worked out
+// again on its next call. Returns whether it did; the function's name is
+// then in changed too.
+static bool forget_if_calls(const char* name, ASTNode* body, int* pure, MemoCache** memo, NameList* changed) {
+    if (list_has(changed, name)) {
+        return false;
+    }
+    CallSearch search = {changed, false};
+    walk_ast(body, find_call, &search);
+    if (!search.found) {
+        return false;
+    }
+    
+    if (*memo) {
+        memo_free(*memo);
+        *memo = NULL;
+    }
+    *pure = -1;
+    list_add(changed, name);
+    return true;
+}
+
+static bool is_expression(ASTNode* node) {
+    switch (node->type) {
+        case AST_FUNCTION_CALL:
+        case AST_BINARY_OP:
+        case AST_UNARY_OP:
+        case AST_IDENTIFIER:
+        case AST_NUMBER:
+        case AST_STRING:
+        case AST_ARRAY_ACCESS:
+        case AST_MEMBER_ACCESS:
+        case AST_EXPRESSION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+typedef struct {
+    InterpreterContext* ctx;
+    ASTNode** inputs;     // every input run so far; functions point into them
+    int input_count;
+    int input_capacity;
+} ReplSession;
+
+// Parses and runs one complete input. No type check is done: later
+// inputs may store any type in the variables earlier ones declared, so
+// types are never settled.
+static void run_input(ReplSession* repl, const char* text, size_t length) {
+    TokenList* tokens = tokenize_buffer(text, length);
+    if (!tokens) {
+        return;
+    }
+    ASTNode* program = parse(tokens);
+    free_token_list(tokens);
+    if (!program) {
+        return;
+    }
+    analyze_loops(program);
+    
+    if (repl->input_count == repl->input_capacity) {
+        repl->input_capacity = repl->input_capacity ? repl->input_capacity * 2 : 16;
+        repl->inputs = realloc(repl->inputs, sizeof(ASTNode*) * repl->input_capacity);
+    }
+    repl->inputs[repl->input_count++] = program;
+    
+    // Limits apply to each input on its own
+    InterpreterContext* ctx = repl->ctx;
+    DMORuntime* runtime = ctx->runtime;
+    if (runtime->budget) {
+        reset_budget(runtime->budget);
+    }
+    
+    DMOOutput* out = &runtime->output;
+    for (int i = 0; i < program->program.statement_count; i++) {
+        ASTNode* statement = program->program.statements[i];
+        Value value = execute_node(statement, ctx);
+        if (is_expression(statement) && value.type != VALUE_VOID) {
+            print_value(value, out);
+            output_char(out, '\n');
+        }
+        free_value(value);
+        
+        // A top-level return, a call past the depth limit or a limit hit
+        // ends only this input
+        if (ctx->has_return) {
+            ctx->has_return = false;
+            free_value(ctx->return_value);
+            ctx->return_value = create_void_value();
+            break;
+        }
+    }
+    ctx->calls->stopped = false;
+    output_flush(out);
+    return_unused(runtime->budget, ctx->calls);
+    report_budget(runtime->budget);
+    
+    NameList changed = {NULL, 0, 0};
+    add_definitions(&changed, program);
+    bool again = changed.count > 0;
+    while (again) {
+        again = false;
+        for (Function* func = ctx->functions; func; func = func->next) {
+            again |= forget_if_calls(func->name, func->body, &func->pure, &func->memo, &changed);
+        }
+    }
+    free(changed.names);
+}
+
+int run_repl() {
+    DMORuntime* runtime = create_runtime(stdout);
+    ReplSession repl = {create_program_context(runtime), NULL, 0, 0};
+    bool interactive = isatty(fileno(stdin));
+    
+    char line[REPL_LINE_SIZE];
+    char* input = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    TextScan scan = {0, 0, false, 0, 0};
+    
+    for (;;) {
+        if (interactive && (length == 0 || input[length - 1] == '\n')) {
+            fputs(length ? "...> " : "dmo> ", stdout);
+            fflush(stdout);
+        }
+        if (!fgets(line, sizeof(line), stdin)) {
+            break;
+        }
+        if (length == 0 && strncmp(line, ":quit", 5) == 0) {
+            break;
+        }
+        
+        size_t line_length = strlen(line);
+        if (length + line_length + 2 > capacity) {
+            capacity = (length + line_length + 2) * 2;
+            input = realloc(input, capacity);
+        }
+        size_t start = length;
+        memcpy(input + length, line, line_length);
+        length += line_length;
+        for (size_t i = start; i < length; ) {
+            i += scan_char(&scan, input, i, length);
+        }
+        
+        // Wait for the rest of a long line, or of an open block or literal
+        if (input[length - 1] != '\n' && !feof(stdin)) {
+            continue;
+        }
+        if (scan.depth > 0 || scan.quote) {
+            continue;
+        }
+        
+        if (scan.last) {
+            // Right after the expression, which may be followed by a comment
+            if (scan.last != ';' && scan.last != '}') {
+                memmove(input + scan.end + 1, input + scan.end, length - scan.end);
+                input[scan.end] = ';';
+                length++;
+            }
+            run_input(&repl, input, length);
+        }
+        length = 0;
+        memset(&scan, 0, sizeof(scan));
+    }
+    
+    if (length > 0 && scan.last) {
+        run_input(&repl, input, length);
+    }
+    if (interactive) {
+        fputc('\n', stdout);
+    }
+    
+    int status = finish_program_context(repl.ctx);
+    for (int i = 0; i < repl.input_count; i++) {
+        free_ast(repl.inputs[i]);
+    }
+    free(repl.inputs);
+    free(input);
+    free_runtime(runtime);
+    return status;
+}
+
+// One top-level item of the watched file
+typedef struct {
+    char* text;
+    size_t length;
+    uint64_t hash;
+    int line;              // of the item's first character in the file
+    ASTNode* program;      // the item parsed on its own
+    int pure;              // memo state of the function the item defines,
+    MemoCache* memo;       // kept from one run to the next
+} WatchItem;
+
+typedef struct {
+    WatchItem* items;
+    int count;
+} WatchSession;
+
+// Leaves out blanks and comments between items, so editing those
+// changes no item
+static WatchItem* split_items(const char* text, size_t length, int* count) {
+    int capacity = 64;
+    WatchItem* items = malloc(sizeof(WatchItem) * capacity);
+    *count = 0;
+    
+    int line = 1;
+    size_t counted = 0;
+    size_t start = skip_blank(text, 0, length);
+    while (start < length) {
+        size_t end = start + item_length(text + start, length - start);
+        for (; counted < start; counted++) {
+            line += text[counted] == '\n';
+        }
+        
+        if (*count == capacity) {
+            capacity *= 2;
+            items = realloc(items, sizeof(WatchItem) * capacity);
+        }
+        WatchItem* item = &items[(*count)++];
+        item->length = end - start;
+        item->text = malloc(item->length + 1);
+        memcpy(item->text, text + start, item->length);
+        item->text[item->length] = '\0';
+        item->hash = dmoc_hash(item->text, item->length);
+        item->line = line;
+        item->program = NULL;
+        item->pure = -1;
+        item->memo = NULL;
+        
+        start = skip_blank(text, end, length);
+    }
+    return items;
+}
+
+static void free_item(WatchItem* item) {
+    if (item->program) {
+        free_ast(item->program);
+    }
+    if (item->memo) {
+        memo_free(item->memo);
+    }
+    free(item->text);
+}
+
+// The definition when the item is one function definition
+static ASTNode* item_function(const WatchItem* item) {
+    ASTNode* program = item->program;
+    if (program->program.statement_count == 1 && program->program.statements[0]->type == AST_FUNCTION_DEF) {
+        return program->program.statements[0];
+    }
+    return NULL;
+}
+
+// Lexes and parses one item on its own, numbering lines as in the file
+static ASTNode* parse_item(WatchItem* item) {
+    TokenList* tokens = tokenize_buffer(item->text, item->length);
+    if (!tokens) {
+        return NULL;
+    }
+    for (int i = 0; i < tokens->count; i++) {
+        tokens->tokens[i].line += item->line - 1;
+    }
+    ASTNode* program = parse(tokens);
+    free_token_list(tokens);
+    if (program) {
+        analyze_loops(program);
+    }
+    return program;
+}
+
+static void shift_line(ASTNode* node, void* data) {
+    if (node->line > 0) {
+        node->line += *(int*)data;
+    }
+}
+
+static bool same_text(const WatchItem* a, const WatchItem* b) {
+    return a->hash == b->hash && a->length == b->length && memcmp(a->text, b->text, a->length) == 0;
+}
+
+// The unused old item with the same text as item, or -1. Edits mostly
+// keep the items after them at the same offset, so that is tried first.
+static int find_unchanged(const WatchSession* session, const WatchItem* item, int guess, const bool* reused) {
+    if (guess >= 0 && guess < session->count && !reused[guess] && same_text(&session->items[guess], item)) {
+        return guess;
+    }
+    for (int i = 0; i < session->count; i++) {
+        if (!reused[i] && same_text(&session->items[i], item)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Replaces the session's items with those of text, parsing only the
+// items whose text changed. When one of them doesn't parse the session
+// is left as it was and this returns false.
+static bool reload(WatchSession* session, const char* text, size_t length, int* parsed) {
+    int count;
+    WatchItem* items = split_items(text, length, &count);
+    bool* reused = calloc(session->count + 1, sizeof(bool));
+    int* origin = malloc(sizeof(int) * (count + 1));
+    
+    bool ok = true;
+    int offset = 0;
+    *parsed = 0;
+    for (int i = 0; i < count; i++) {
+        origin[i] = find_unchanged(session, &items[i], i + offset, reused);
+        if (origin[i] >= 0) {
+            reused[origin[i]] = true;
+            offset = origin[i] - i;
+            continue;
+        }
+        items[i].program = parse_item(&items[i]);
+        ok &= items[i].program != NULL;
+        (*parsed)++;
+    }
+    
+    if (!ok) {
+        for (int i = 0; i < count; i++) {
+            free_item(&items[i]);
+        }
+        free(items);
+        free(reused);
+        free(origin);
+        return false;
+    }
+    
+    // Unchanged items move over with their parsed form and memo state
+    NameList changed = {NULL, 0, 0};
+    for (int i = 0; i < count; i++) {
+        if (origin[i] < 0) {
+            add_definitions(&changed, items[i].program);
+            continue;
+        }
+        
+        WatchItem* old = &session->items[origin[i]];
+        items[i].program = old->program;
+        items[i].pure = old->pure;
+        items[i].memo = old->memo;
+        old->program = NULL;
+        old->memo = NULL;
+        if (items[i].line != old->line) {
+            int delta = items[i].line - old->line;
+            walk_ast(items[i].program, shift_line, &delta);
+        }
+    }
+    for (int i = 0; i < session->count; i++) {
+        if (!reused[i]) {
+            add_definitions(&changed, session->items[i].program);
+        }
+    }
+    
+    bool again = changed.count > 0;
+    while (again) {
+        again = false;
+        for (int i = 0; i < count; i++) {
+            ASTNode* def = origin[i] >= 0 ? item_function(&items[i]) : NULL;
+            if (def) {
+                again |= forget_if_calls(def->func_def.name, def->func_def.body,
+                                         &items[i].pure, &items[i].memo, &changed);
+            }
+        }
+    }
+    free(changed.names);
+    
+    for (int i = 0; i < session->count; i++) {
+        free_item(&session->items[i]);
+    }
+    free(session->items);
+    session->items = items;
+    session->count = count;
+    free(reused);
+    free(origin);
+    
+    // Types depend on every store in the program, so they are always
+    // worked out for the whole of it
+    int statement_count = 0;
+    for (int i = 0; i < count; i++) {
+        statement_count += items[i].program->program.statement_count;
+    }
+    ASTNode** statements = malloc(sizeof(ASTNode*) * (statement_count + 1));
+    statement_count = 0;
+    for (int i = 0; i < count; i++) {
+        ASTNode* program = items[i].program;
+        memcpy(statements + statement_count, program->program.statements,
+               sizeof(ASTNode*) * program->program.statement_count);
+        statement_count += program->program.statement_count;
+    }
+    ASTNode* whole = create_program_node(statements, statement_count);
+    check_types(whole);
+    free(statements);
+    free(whole);
+    return true;
+}
+
+// Runs the items as interpret_with_runtime runs a program, handing each
+// function defined by an item of its own the memo state kept for it
+static int run_items(WatchSession* session, DMORuntime* runtime) {
+    InterpreterContext* ctx = create_program_context(runtime);
+    Function** defined = calloc(session->count + 1, sizeof(Function*));
+    
+    for (int i = 0; i < session->count && !ctx->has_return; i++) {
+        WatchItem* item = &session->items[i];
+        ASTNode* program = item->program;
+        for (int s = 0; s < program->program.statement_count && !ctx->has_return; s++) {
+            free_value(execute_node(program->program.statements[s], ctx));
+        }
+        if (item_function(item)) {
+            // execute_function_def put it first
+            defined[i] = ctx->functions;
+            defined[i]->pure = item->pure;
+            defined[i]->memo = item->memo;
+            item->memo = NULL;
+        }
+    }
+    call_main(ctx);
+    
+    // Tasks may still be calling the functions
+    finish_spawned_tasks(runtime);
+    for (int i = 0; i < session->count; i++) {
+        if (defined[i]) {
+            WatchItem* item = &session->items[i];
+            item->pure = defined[i]->pure;
+            item->memo = defined[i]->memo;
+            defined[i]->memo = NULL;
+            if (item->memo) {
+                memo_log_profile(defined[i]->name, item->memo);
+            }
+        }
+    }
+    free(defined);
+    
+    return finish_program_context(ctx);
+}
+
+typedef struct {
+    long long seconds;
+    long nanoseconds;
+    long long size;
+} FileStamp;
+
+static bool file_stamp(const char* path, FileStamp* stamp) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+    stamp->seconds = (long long)st.st_mtime;
+#ifdef _WIN32
+    stamp->nanoseconds = 0;
+#else
+    stamp->nanoseconds = st.st_mtim.tv_nsec;
+#endif
+    stamp->size = (long long)st.st_size;
+    return true;
+}
+
+static void wait_for_change() {
+#ifdef _WIN32
+    Sleep(WATCH_INTERVAL_MS);
+#else
+    struct timespec interval = {0, WATCH_INTERVAL_MS * 1000000L};
+    nanosleep(&interval, NULL);
+#endif
+}
+
+static bool same_stamp(const FileStamp* a, const FileStamp* b) {
+    return a->seconds == b->seconds && a->nanoseconds == b->nanoseconds && a->size == b->size;
+}
+
+int run_watch(const char* source_file) {
+    FileStamp stamp;
+    if (!file_stamp(source_file, &stamp)) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", source_file);
+        return 1;
+    }
+    
+    WatchSession session = {NULL, 0};
+    DMORuntime* runtime = create_runtime(stdout);
+    for (bool first = true; ; first = false) {
+        if (!first) {
+            FileStamp now;
+            if (!file_stamp(source_file, &now) || same_stamp(&now, &stamp)) {
+                wait_for_change();
+                continue;
+            }
+            stamp = now;
+        }
+        
+        // Editors may save by replacing the file; it is tried again on
+        // the next change
+        SourceBuffer source;
+        if (!load_source(source_file, &source)) {
+            continue;
+        }
+        
+        double start = now_seconds();
+        int parsed;
+        bool ok = reload(&session, source.data, source.length, &parsed);
+        release_source(&source);
+        double built = now_seconds();
+        
+        if (ok) {
+            int status = run_items(&session, runtime);
+            double ran = now_seconds();
+            fprintf(stderr, "[watch] %s: %d of %d items parsed, ready in %.2f ms, ran in %.2f ms%s\n",
+                    source_file, parsed, session.count, (built - start) * 1e3, (ran - built) * 1e3,
+                    status ? ", failed" : "");
+        } else {
+            fprintf(stderr, "[watch] %s: not run, fix the errors above and save again\n", source_file);
+        }
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ * DMO REPL Header
+ * An interactive session, and re-running a script each time it is saved
+ */
+
+#ifndef DMO_REPL_H
+#define DMO_REPL_H
+
+// Runs statements from stdin as soon as each is complete, all in one
+// context, so variables, functions and loaded modules carry over from one
+// input to the next. The value of an expression statement is printed. A
+// missing ';' after a one-line expression is added. Returns 0 at the end
+// of input or on :quit.
+int run_repl();
+
+// Runs source_file, then again each time it changes, until interrupted.
+// The file is split into top-level items (statements, function
+// definitions, if/else chains), and only items whose text changed are
+// lexed and parsed again. Functions whose text and callees are unchanged
+// keep their memoized results between runs.
+int run_watch(const char* source_file);
+
+#endif // DMO_REPL_H
@@ -0,0 +1,140 @@
+/*
+ * DMO Runtime Implementation
+ * Per-instance state for one interpreter, so several can share a process
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_runtime.h"
+#include "dmo_parallel.h"
+#include "dmo_builtins.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+DMORuntime* create_runtime(FILE* output_stream) {
+    DMORuntime* runtime = malloc(sizeof(DMORuntime));
+    output_init(&runtime->output, output_stream);
+    init_module_system(&runtime->modules);
+    runtime->graphics = NULL;
+    runtime->globals = NULL;
+    runtime->http = NULL;
+    runtime->files = NULL;
+    runtime->generators = NULL;
+    runtime->extensions = NULL;
+    runtime->limits = dmo_limits;
+    runtime->budget = NULL;
+    runtime->scheduler = NULL;
+    runtime->tasks = NULL;
+    runtime->jobs = 0;
+    runtime->forked = false;
+    return runtime;
+}
+
+// Graphics, the HTTP pool, the file and generator tables are set up by
+// the first call that needs them, so scripts that use none of them don't pay at startup
+DMOGraphicsContext* runtime_graphics(DMORuntime* runtime) {
+    if (!runtime->graphics) {
+        runtime->graphics = init_dmo_graphics();
+    }
+    return runtime->graphics;
+}
+
+HttpPool* runtime_http(DMORuntime* runtime) {
+    if (!runtime->http) {
+        runtime->http = create_http_pool();
+    }
+    return runtime->http;
+}
+
+DMOFileTable* runtime_files(DMORuntime* runtime) {
+    if (!runtime->files) {
+        runtime->files = create_file_table();
+    }
+    return runtime->files;
+}
+
+DMOGeneratorTable* runtime_generators(DMORuntime* runtime) {
+    if (!runtime->generators) {
+        runtime->generators = create_generator_table();
+    }
+    return runtime->generators;
+}
+
+static void free_runtime_globals(DMORuntime* runtime) {
+    Variable* var = runtime->globals;
+    while (var) {
+        Variable* next = var->next;
+        free(var->name);
+        free(var->type);
+        free_value(var->value);
+        free(var);
+        var = next;
+    }
+    runtime->globals = NULL;
+}
+
+void free_runtime(DMORuntime* runtime) {
+    free_parallel_state(runtime);
+    free_runtime_globals(runtime);
+    if (runtime->http) {
+        free_http_pool(runtime->http);
+    }
+    free_file_table(runtime->files);
+    free_generator_table(runtime->generators);
+    cleanup_dmo_graphics(runtime->graphics);
+    
+    // Extension functions go before the libraries holding them are closed
+    free_builtin_table(runtime->extensions);
+    cleanup_module_system(&runtime->modules);
+    output_free(&runtime->output);
+    free(runtime);
+}
+
+// Brings the runtime back to a clean state for the next run. Loaded modules
+// stay loaded, which is what makes a reused runtime cheaper than a new one.
+void reset_runtime(DMORuntime* runtime) {
+    free_runtime_globals(runtime);
+    if (runtime->http) {
+        http_cancel_all(runtime->http);
+    }
+    if (runtime->files) {
+        close_all_files(runtime->files);
+    }
+    output_reset(&runtime->output);
+    
+    if (runtime->graphics && (runtime->graphics->window_created || runtime->graphics->element_count > 0)) {
+        cleanup_dmo_graphics(runtime->graphics);
+        runtime->graphics = NULL;
+    }
+}
+
+void set_runtime_global(DMORuntime* runtime, const char* name, const char* type, Value value) {
+    Variable* var = runtime->globals;
+    
+    // Check if variable already exists
+    while (var) {
+        if (strcmp(var->name, name) == 0) {
+            free_value(var->value);
+            var->value = copy_value(value);
+            return;
+        }
+        var = var->next;
+    }
+    
+    var = malloc(sizeof(Variable));
+    var->name = strdup(name);
+    var->type = strdup(type);
+    var->value = copy_value(value);
+    var->next = runtime->globals;
+    runtime->globals = var;
+}
+
+double now_seconds() {
+#ifdef _WIN32
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
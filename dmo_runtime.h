@@ -0,0 +1,56 @@
+/*
+ * DMO Runtime Header
+ * Per-instance state for one interpreter, so several can share a process
+ */
+
+#ifndef DMO_RUNTIME_H
+#define DMO_RUNTIME_H
+
+#include <stdio.h>
+#include "interpreter.h"
+#include "dmo_graphs.h"
+#include "modules.h"
+#include "dmo_output.h"
+#include "dmo_sched.h"
+#include "dmo_http.h"
+#include "dmo_limits.h"
+#include "dmo_file.h"
+#include "dmo_generator.h"
+
+// Everything a running script can change outside its own variables lives
+// here. Each InterpreterContext of a run points at the same runtime, and
+// runtimes share nothing, so they may run on different threads.
+struct DMORuntime {
+    DMOGraphicsContext* graphics;   // NULL until first used, see runtime_graphics
+    ModuleSystem modules;
+    DMOOutput output;
+    Variable* globals;   // defined in every program run on this runtime
+    HttpPool* http;      // keep-alive connections of the request module, NULL until first used
+    DMOFileTable* files; // files opened by the file module, NULL until the first is opened
+    DMOGeneratorTable* generators;   // made by calls of generator functions, NULL until the first
+    struct BuiltinTable* extensions;   // functions of loaded extensions, NULL until one registers
+    DMOLimits limits;    // of each run, dmo_limits when the runtime is created
+    DMOBudget* budget;   // what the current run has used, NULL when limits has none
+    
+    // Created on the first parallel for or spawn. Loop chunks and tasks run
+    // on copies of this struct that share everything except the output.
+    DMOScheduler* scheduler;
+    struct SpawnTable* tasks;
+    int jobs;            // workers of that scheduler, 0 for scheduler_default_workers()
+    bool forked;         // such a copy, which can't load modules, see fork_runtime
+};
+
+// Function prototypes. A NULL output stream captures output in memory
+DMORuntime* create_runtime(FILE* output_stream);
+void free_runtime(DMORuntime* runtime);
+void reset_runtime(DMORuntime* runtime);
+DMOGraphicsContext* runtime_graphics(DMORuntime* runtime);
+HttpPool* runtime_http(DMORuntime* runtime);
+DMOFileTable* runtime_files(DMORuntime* runtime);
+DMOGeneratorTable* runtime_generators(DMORuntime* runtime);
+void set_runtime_global(DMORuntime* runtime, const char* name, const char* type, Value value);
+
+// Monotonic wall clock in seconds, for benchmarks and timings
+double now_seconds();
+
+#endif // DMO_RUNTIME_H
@@ -0,0 +1,261 @@
+/*
+ * DMO Scheduler Implementation
+ * Work-stealing thread pool shared by batch runs and parallel scripts
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_sched.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define DEQUE_INITIAL_CAPACITY 64
+
+// Counters are updated with the GCC/Clang atomic builtins, so the hot
+// path of taking and finishing a task never touches the pool lock
+#define ATOMIC_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define ATOMIC_ADD(ptr, n) __atomic_add_fetch(ptr, n, __ATOMIC_ACQ_REL)
+#define ATOMIC_SUB(ptr, n) __atomic_sub_fetch(ptr, n, __ATOMIC_ACQ_REL)
+
+typedef struct {
+    DMOScheduler* sched;
+    int worker;
+} WorkerStart;
+
+static void deque_init(DMODeque* deque) {
+    deque->capacity = DEQUE_INITIAL_CAPACITY;
+    deque->tasks = malloc(sizeof(DMOTask) * deque->capacity);
+    deque->head = 0;
+    deque->count = 0;
+    pthread_mutex_init(&deque->lock, NULL);
+}
+
+static void deque_free(DMODeque* deque) {
+    free(deque->tasks);
+    pthread_mutex_destroy(&deque->lock);
+}
+
+static void deque_push(DMODeque* deque, DMOTask task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        // Unwrap the ring into a buffer twice the size
+        DMOTask* tasks = malloc(sizeof(DMOTask) * deque->capacity * 2);
+        for (size_t i = 0; i < deque->count; i++) {
+            tasks[i] = deque->tasks[(deque->head + i) & (deque->capacity - 1)];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->capacity *= 2;
+    }
+    deque->tasks[(deque->head + deque->count) & (deque->capacity - 1)] = task;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static bool deque_pop_tail(DMODeque* deque, DMOTask* task) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        deque->count--;
+        *task = deque->tasks[(deque->head + deque->count) & (deque->capacity - 1)];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool deque_steal_head(DMODeque* deque, DMOTask* task) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) & (deque->capacity - 1);
+        deque->count--;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void wake_all(DMOScheduler* sched) {
+    pthread_mutex_lock(&sched->lock);
+    pthread_cond_broadcast(&sched->changed);
+    pthread_mutex_unlock(&sched->lock);
+}
+
+bool scheduler_run_one(DMOScheduler* sched, int worker) {
+    if (ATOMIC_LOAD(&sched->queued) == 0) {
+        return false;
+    }
+    
+    DMOTask task;
+    bool found = deque_pop_tail(&sched->deques[worker], &task);
+    
+    // Steal round the ring, starting at the next worker so thieves spread out
+    for (int i = 1; !found && i < sched->worker_count; i++) {
+        int victim = (worker + i) % sched->worker_count;
+        if (deque_steal_head(&sched->deques[victim], &task)) {
+            ATOMIC_ADD(&sched->steals, 1);
+            found = true;
+        }
+    }
+    
+    if (!found) {
+        return false;
+    }
+    
+    ATOMIC_SUB(&sched->queued, 1);
+    task.run(task.arg, worker);
+    
+    bool group_done = task.group && ATOMIC_SUB(&task.group->pending, 1) == 0;
+    if (ATOMIC_SUB(&sched->unfinished, 1) == 0 || group_done) {
+        wake_all(sched);
+    }
+    return true;
+}
+
+static void* worker_main(void* arg) {
+    WorkerStart* start = arg;
+    DMOScheduler* sched = start->sched;
+    int worker = start->worker;
+    free(start);
+    
+    for (;;) {
+        if (scheduler_run_one(sched, worker)) {
+            continue;
+        }
+        
+        // Nothing to run anywhere: sleep until a submit or shutdown
+        pthread_mutex_lock(&sched->lock);
+        while (!sched->stopping && ATOMIC_LOAD(&sched->queued) == 0) {
+            pthread_cond_wait(&sched->changed, &sched->lock);
+        }
+        bool stopping = sched->stopping;
+        pthread_mutex_unlock(&sched->lock);
+        
+        if (stopping) {
+            return NULL;
+        }
+    }
+}
+
+DMOScheduler* create_scheduler(int worker_count) {
+    if (worker_count < 1) {
+        worker_count = 1;
+    }
+    
+    DMOScheduler* sched = malloc(sizeof(DMOScheduler));
+    sched->worker_count = worker_count;
+    sched->deques = malloc(sizeof(DMODeque) * worker_count);
+    sched->threads = malloc(sizeof(pthread_t) * worker_count);
+    sched->queued = 0;
+    sched->unfinished = 0;
+    sched->steals = 0;
+    sched->stopping = false;
+    pthread_mutex_init(&sched->lock, NULL);
+    pthread_cond_init(&sched->changed, NULL);
+    
+    for (int i = 0; i < worker_count; i++) {
+        deque_init(&sched->deques[i]);
+    }
+    
+    for (int i = 1; i < worker_count; i++) {
+        WorkerStart* start = malloc(sizeof(WorkerStart));
+        start->sched = sched;
+        start->worker = i;
+        pthread_create(&sched->threads[i], NULL, worker_main, start);
+    }
+    
+    return sched;
+}
+
+void free_scheduler(DMOScheduler* sched) {
+    pthread_mutex_lock(&sched->lock);
+    sched->stopping = true;
+    pthread_cond_broadcast(&sched->changed);
+    pthread_mutex_unlock(&sched->lock);
+    
+    for (int i = 1; i < sched->worker_count; i++) {
+        pthread_join(sched->threads[i], NULL);
+    }
+    for (int i = 0; i < sched->worker_count; i++) {
+        deque_free(&sched->deques[i]);
+    }
+    
+    pthread_mutex_destroy(&sched->lock);
+    pthread_cond_destroy(&sched->changed);
+    free(sched->deques);
+    free(sched->threads);
+    free(sched);
+}
+
+int scheduler_default_workers() {
+    const char* jobs = getenv("DMO_JOBS");
+    if (jobs && atoi(jobs) > 0) {
+        return atoi(jobs);
+    }
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+void scheduler_submit(DMOScheduler* sched, int worker, DMOTaskFunction run, void* arg) {
+    scheduler_submit_group(sched, worker, NULL, run, arg);
+}
+
+void scheduler_submit_group(DMOScheduler* sched, int worker, DMOTaskGroup* group,
+                            DMOTaskFunction run, void* arg) {
+    DMOTask task = {run, arg, group};
+    
+    // Count first, so a thief that takes the task at once can't drive the
+    // counters below zero
+    if (group) {
+        ATOMIC_ADD(&group->pending, 1);
+    }
+    ATOMIC_ADD(&sched->unfinished, 1);
+    ATOMIC_ADD(&sched->queued, 1);
+    deque_push(&sched->deques[worker % sched->worker_count], task);
+    wake_all(sched);
+}
+
+void scheduler_wait(DMOScheduler* sched) {
+    while (ATOMIC_LOAD(&sched->unfinished) > 0) {
+        if (scheduler_run_one(sched, 0)) {
+            continue;
+        }
+        
+        // The remaining tasks are running on other workers
+        pthread_mutex_lock(&sched->lock);
+        while (ATOMIC_LOAD(&sched->unfinished) > 0 && ATOMIC_LOAD(&sched->queued) == 0) {
+            pthread_cond_wait(&sched->changed, &sched->lock);
+        }
+        pthread_mutex_unlock(&sched->lock);
+    }
+}
+
+void scheduler_join(DMOScheduler* sched, int worker, DMOTaskGroup* group) {
+    while (ATOMIC_LOAD(&group->pending) > 0) {
+        // Run anything, not just the group's own tasks: the group may be
+        // waiting on work that was stolen and then split further
+        if (scheduler_run_one(sched, worker)) {
+            continue;
+        }
+        
+        pthread_mutex_lock(&sched->lock);
+        while (ATOMIC_LOAD(&group->pending) > 0 && ATOMIC_LOAD(&sched->queued) == 0) {
+            pthread_cond_wait(&sched->changed, &sched->lock);
+        }
+        pthread_mutex_unlock(&sched->lock);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * DMO Scheduler Header
+ * Work-stealing thread pool shared by batch runs and parallel scripts
+ */
+
+#ifndef DMO_SCHED_H
+#define DMO_SCHED_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// A task receives its argument and the index of the worker running it
+typedef void (*DMOTaskFunction)(void* arg, int worker);
+
+// Completion counter for related tasks, such as the chunks of one loop
+typedef struct {
+    unsigned long pending;
+} DMOTaskGroup;
+
+typedef struct {
+    DMOTaskFunction run;
+    void* arg;
+    DMOTaskGroup* group;    // may be NULL
+} DMOTask;
+
+// Per-worker double-ended queue. The owner pushes and pops at the tail
+// (newest first, which keeps its caches warm); idle workers steal from
+// the head, taking the oldest and usually largest pieces of work.
+typedef struct {
+    DMOTask* tasks;
+    size_t head;
+    size_t count;
+    size_t capacity;    // power of two, the ring wraps
+    pthread_mutex_t lock;
+} DMODeque;
+
+// Worker 0 is the thread that calls scheduler_wait; the pool starts the
+// other worker_count - 1 threads. Only one thread may act as worker 0.
+typedef struct {
+    int worker_count;
+    DMODeque* deques;
+    pthread_t* threads;
+    unsigned long queued;       // tasks sitting in deques
+    unsigned long unfinished;   // submitted and not yet completed
+    unsigned long steals;
+    bool stopping;
+    pthread_mutex_t lock;       // only for sleeping and waking
+    pthread_cond_t changed;
+} DMOScheduler;
+
+// Function prototypes
+DMOScheduler* create_scheduler(int worker_count);
+void free_scheduler(DMOScheduler* sched);
+int scheduler_default_workers();
+
+// Queue a task on a worker's deque. Tasks submitted from inside a task
+// should pass their own worker index.
+void scheduler_submit(DMOScheduler* sched, int worker, DMOTaskFunction run, void* arg);
+void scheduler_submit_group(DMOScheduler* sched, int worker, DMOTaskGroup* group,
+                            DMOTaskFunction run, void* arg);
+
+// Runs one task as the given worker, its own newest first, otherwise one
+// stolen from another deque. Returns false when there was nothing to run.
+bool scheduler_run_one(DMOScheduler* sched, int worker);
+
+// Worker 0 helps until every submitted task has completed
+void scheduler_wait(DMOScheduler* sched);
+
+// Any worker, from inside a task too, helps until the group has completed
+void scheduler_join(DMOScheduler* sched, int worker, DMOTaskGroup* group);
+
+#endif // DMO_SCHED_H
@@ -0,0 +1,135 @@
+/*
+ * DMO Source Loading Implementation
+ * Reads scripts and turns them into programs through the cache, lexer and parser
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_source.h"
+#include "lexer.h"
+#include "parser.h"
+#include "dmo_cache.h"
+#include "dmo_types.h"
+#include "dmo_loops.h"
+#include "dmo_output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+char* read_file(const char* filename, size_t* length) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+        return NULL;
+    }
+    
+    // Get file size
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    // Allocate buffer and read file
+    char* buffer = malloc(size + 1);
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fclose(file);
+        return NULL;
+    }
+    
+    size_t read = fread(buffer, 1, size, file);
+    buffer[read] = '\0';
+    fclose(file);
+    
+    *length = read;
+    return buffer;
+}
+
+bool load_source(const char* filename, SourceBuffer* source) {
+    source->data = NULL;
+    source->length = 0;
+    source->mapped = false;
+
+#ifndef _WIN32
+    // Map the file read-only instead of copying it; fall back to reading
+    // for empty files and anything mmap refuses
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            source->data = map;
+            source->length = st.st_size;
+            source->mapped = true;
+        }
+    }
+    close(fd);
+    
+    if (source->mapped) {
+        return true;
+    }
+#endif
+
+    source->data = read_file(filename, &source->length);
+    return source->data != NULL;
+}
+
+void release_source(SourceBuffer* source) {
+#ifndef _WIN32
+    if (source->mapped) {
+        munmap(source->data, source->length);
+        return;
+    }
+#endif
+    free(source->data);
+}
+
+ASTNode* build_program(const char* source_file, const SourceBuffer* source) {
+    // Unchanged scripts load their precompiled form and skip lexing and parsing
+    TokenList* tokens = NULL;
+    ASTNode* ast = load_cached_program(source_file, source->data, source->length);
+    
+    if (ast) {
+        dmo_log(DMO_LOG_INFO, "Phase 1-2: Loaded precompiled program\n");
+    } else {
+        // Lexical analysis
+        dmo_log(DMO_LOG_INFO, "Phase 1: Lexical Analysis...\n");
+        tokens = tokenize_buffer(source->data, source->length);
+        if (!tokens) {
+            fprintf(stderr, "Lexical analysis failed\n");
+            return NULL;
+        }
+        
+        dmo_log(DMO_LOG_INFO, "Tokens generated: %d\n", tokens->count);
+        
+        // Parsing
+        dmo_log(DMO_LOG_INFO, "Phase 2: Parsing...\n");
+        ast = parse(tokens);
+        if (!ast) {
+            fprintf(stderr, "Parsing failed\n");
+            free_token_list(tokens);
+            return NULL;
+        }
+        
+        dmo_log(DMO_LOG_INFO, "AST generated successfully\n");
+        save_cached_program(source_file, source->data, source->length, ast);
+    }
+    
+    // Static types and loop shapes aren't part of the cached form; working
+    // them out is cheap
+    int type_errors = check_types(ast);
+    analyze_loops(ast);
+    dmo_log(DMO_LOG_INFO, "Type check: %d error%s\n", type_errors, type_errors == 1 ? "" : "s");
+    
+    // The AST owns copies of everything it needs from the source
+    free_token_list(tokens);
+    return ast;
+}
@@ -0,0 +1,30 @@
+/*
+ * DMO Source Loading Header
+ * Reads scripts and turns them into programs through the cache, lexer and parser
+ */
+
+#ifndef DMO_SOURCE_H
+#define DMO_SOURCE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "ast.h"
+
+// Source text for one run. Tokens are views into it, so it must stay
+// alive until the AST has been built.
+typedef struct {
+    char* data;
+    size_t length;
+    bool mapped;
+} SourceBuffer;
+
+// Function prototypes
+char* read_file(const char* filename, size_t* length);
+bool load_source(const char* filename, SourceBuffer* source);
+void release_source(SourceBuffer* source);
+
+// Loads the precompiled form when it is current, otherwise lexes, parses
+// and caches it. Returns NULL after reporting the error on stderr.
+ASTNode* build_program(const char* source_file, const SourceBuffer* source);
+
+#endif // DMO_SOURCE_H
@@ -0,0 +1,114 @@
+/*
+ * DMO Call Stack Implementation
+ * Reusable frames for user function calls, a depth limit and C stack segments
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_stack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+int dmo_max_depth = DMO_DEFAULT_MAX_DEPTH;
+
+DMOCallStack* create_call_stack() {
+    // Only the distance from segment_base is used, never what it points at
+    char here;
+    DMOCallStack* stack = malloc(sizeof(DMOCallStack));
+    stack->frames = NULL;
+    stack->depth = 0;
+    stack->capacity = 0;
+    stack->max_depth = dmo_max_depth;
+    stack->stopped = false;
+    stack->steps_left = 0;
+    stack->alloc_left = 0;
+    stack->segment_base = &here;
+    stack->segment_size = DMO_ENTRY_STACK;
+    return stack;
+}
+
+void free_call_stack(DMOCallStack* stack) {
+    for (int i = 0; i < stack->capacity && stack->frames[i]; i++) {
+        free_interpreter_context(stack->frames[i]);
+    }
+    free(stack->frames);
+    free(stack);
+}
+
+InterpreterContext* push_frame(DMOCallStack* stack) {
+    if (stack->depth >= stack->max_depth) {
+        return NULL;
+    }
+    
+    if (stack->depth == stack->capacity) {
+        int capacity = stack->capacity ? stack->capacity * 2 : 64;
+        stack->frames = realloc(stack->frames, sizeof(InterpreterContext*) * capacity);
+        for (int i = stack->capacity; i < capacity; i++) {
+            stack->frames[i] = NULL;
+        }
+        stack->capacity = capacity;
+    }
+    
+    if (!stack->frames[stack->depth]) {
+        stack->frames[stack->depth] = create_interpreter_context();
+    }
+    
+    InterpreterContext* frame = stack->frames[stack->depth++];
+    frame->calls = stack;
+    return frame;
+}
+
+void pop_frame(DMOCallStack* stack) {
+    reset_interpreter_context(stack->frames[--stack->depth]);
+}
+
+// A call continued on a new segment
+typedef struct {
+    DMOCallStack* stack;
+    DMOFrameFunction function;
+    InterpreterContext* frame;
+    Value result;
+} StackSegment;
+
+static void* segment_main(void* arg) {
+    StackSegment* segment = arg;
+    char here;
+    segment->stack->segment_base = &here;
+    segment->stack->segment_size = DMO_STACK_SEGMENT;
+    segment->result = segment->function(segment->frame);
+    return NULL;
+}
+
+Value run_on_stack(DMOCallStack* stack, DMOFrameFunction function, InterpreterContext* frame) {
+    char here;
+    intptr_t used = (intptr_t)stack->segment_base - (intptr_t)&here;
+    if (used < 0) {
+        used = -used;
+    }
+    if ((size_t)used + DMO_STACK_RESERVE < stack->segment_size) {
+        return function(frame);
+    }
+    
+    // The calling thread only waits, so the frames and the scheduler
+    // worker index move over to the new thread unchanged
+    char* base = stack->segment_base;
+    size_t size = stack->segment_size;
+    StackSegment segment = {stack, function, frame, create_void_value()};
+    
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, DMO_STACK_SEGMENT);
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, segment_main, &segment) != 0) {
+        fprintf(stderr, "Error: Out of memory for the call stack at depth %d\n", stack->depth);
+        stack->stopped = true;
+    } else {
+        pthread_join(thread, NULL);
+    }
+    pthread_attr_destroy(&attr);
+    
+    stack->segment_base = base;
+    stack->segment_size = size;
+    return segment.result;
+}
@@ -0,0 +1,57 @@
+/*
+ * DMO Call Stack Header
+ * Reusable frames for user function calls, a depth limit and C stack segments
+ */
+
+#ifndef DMO_STACK_H
+#define DMO_STACK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "interpreter.h"
+
+#define DMO_DEFAULT_MAX_DEPTH 100000
+#define DMO_ENTRY_STACK (256 * 1024)           // C stack a run may use of the thread that starts it
+#define DMO_STACK_SEGMENT (64 * 1024 * 1024)   // C stack of each further segment
+#define DMO_STACK_RESERVE (64 * 1024)          // kept free below the deepest call, for builtins
+
+// Deepest nesting of user function calls allowed in runs started from now
+// on. Set from DMO_MAX_DEPTH or --max-depth.
+extern int dmo_max_depth;
+
+// The calls of one thread of execution: a run, a parallel loop chunk or a
+// spawned task. frames[i] is the context of the call at depth i; contexts
+// stay allocated and are reused by later calls at the same depth.
+//
+// The evaluator itself recurses in C, about 300-600 bytes per call. Once
+// the C stack in use comes within DMO_STACK_RESERVE of the segment size,
+// the next call continues on a new thread with a DMO_STACK_SEGMENT stack
+// while this one waits, so the depth is bounded by max_depth and memory
+// rather than by the stack of the thread that started the run.
+struct DMOCallStack {
+    InterpreterContext** frames;
+    int depth;
+    int capacity;
+    int max_depth;
+    bool stopped;           // a call went past max_depth or a limit was hit, the run is unwinding
+    long steps_left;        // of the batch taken from the run's budget, see dmo_limits.h
+    long long alloc_left;   // bytes of allocation taken from the run's budget and not yet used
+    char* segment_base;     // where the current C stack segment starts
+    size_t segment_size;
+};
+
+// Function prototypes. create_call_stack takes the caller's C stack as
+// the first segment.
+DMOCallStack* create_call_stack();
+void free_call_stack(DMOCallStack* stack);
+
+// NULL when the stack is already max_depth deep
+InterpreterContext* push_frame(DMOCallStack* stack);
+void pop_frame(DMOCallStack* stack);
+
+// Calls function(frame) on the current segment, or on a new one when the
+// current one is nearly used up
+typedef Value (*DMOFrameFunction)(InterpreterContext* frame);
+Value run_on_stack(DMOCallStack* stack, DMOFrameFunction function, InterpreterContext* frame);
+
+#endif // DMO_STACK_H
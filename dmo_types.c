@@ -0,0 +1,686 @@
+/*
+ * DMO Type Checker Implementation
+ * Infers the static types of expressions and reports type errors before execution
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_types.h"
+#include "dmo_builtins.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+// All declarations of one name in the program
+typedef struct {
+    const char* name;
+    StaticType declared;    // TYPE_UNKNOWN when they disagree or aren't int, string or char
+    bool stable;            // every store to the name is known to be of the declared type
+} TypedName;
+
+// Open addressing from names to array indexes. Large scripts have
+// thousands of names and call sites, so they aren't searched one by one.
+typedef struct {
+    const char** keys;
+    int* values;
+    int capacity;           // power of two, at most half full
+    int count;
+} NameIndex;
+
+typedef struct {
+    TypedName* names;
+    int name_count;
+    int name_capacity;
+    NameIndex name_index;
+    ASTNode** functions;    // every function definition, for checking call sites
+    StaticType* returns;    // what each of them is known to return
+    bool* generators;       // which of them yield, so that a call gives a handle
+    int* next_definition;   // the previous definition of the same name, or -1
+    int function_count;
+    int function_capacity;
+    NameIndex function_index;   // the last definition of each name
+    int function;           // index of the definition being checked, -1 outside
+    bool typed_calls;       // calls of user functions surely reach their definition
+    const char** scope;     // names whose declaration has surely run at the current node
+    int scope_count;
+    int scope_capacity;
+    int scope_base;         // where the scope of the current function starts
+    bool changed;           // a name lost its type during this pass
+    bool report;            // only the last pass reports errors
+    int errors;
+} TypeChecker;
+
+static StaticType declared_type(const char* type) {
+    if (strcmp(type, "int") == 0) {
+        return TYPE_NUMBER;
+    }
+    if (strcmp(type, "string") == 0 || strcmp(type, "char") == 0) {
+        return TYPE_STRING;
+    }
+    return TYPE_UNKNOWN;
+}
+
+static const char* operator_text(TokenType operator) {
+    switch (operator) {
+        case TOKEN_PLUS: return "+";
+        case TOKEN_MINUS: return "-";
+        case TOKEN_MULTIPLY: return "*";
+        case TOKEN_DIVIDE: return "/";
+        case TOKEN_MODULO: return "%";
+        case TOKEN_EQUAL: return "==";
+        case TOKEN_NOT_EQUAL: return "!=";
+        case TOKEN_LESS: return "<";
+        case TOKEN_GREATER: return ">";
+        case TOKEN_LESS_EQUAL: return "<=";
+        case TOKEN_GREATER_EQUAL: return ">=";
+        default: return token_type_to_string(operator);
+    }
+}
+
+static void type_error(TypeChecker* checker, ASTNode* node, const char* format, ...) {
+    if (!checker->report) {
+        return;
+    }
+    
+    fprintf(stderr, "Type error at line %d, column %d: ", node->line, node->column);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    checker->errors++;
+}
+
+static uint64_t hash_text(const char* text) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (; *text; text++) {
+        hash ^= (unsigned char)*text;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// The slot holding key, or the empty slot where it would go
+static int index_slot(const NameIndex* index, const char* key) {
+    int mask = index->capacity - 1;
+    int i = (int)(hash_text(key) & mask);
+    while (index->keys[i] && strcmp(index->keys[i], key) != 0) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int index_get(const NameIndex* index, const char* key) {
+    if (index->capacity == 0) {
+        return -1;
+    }
+    int slot = index_slot(index, key);
+    return index->keys[slot] ? index->values[slot] : -1;
+}
+
+static void index_put(NameIndex* index, const char* key, int value) {
+    if ((index->count + 1) * 2 > index->capacity) {
+        NameIndex old = *index;
+        index->capacity = old.capacity ? old.capacity * 2 : 64;
+        index->keys = calloc(index->capacity, sizeof(const char*));
+        index->values = malloc(sizeof(int) * index->capacity);
+        for (int i = 0; i < old.capacity; i++) {
+            if (old.keys[i]) {
+                int slot = index_slot(index, old.keys[i]);
+                index->keys[slot] = old.keys[i];
+                index->values[slot] = old.values[i];
+            }
+        }
+        free(old.keys);
+        free(old.values);
+    }
+    
+    int slot = index_slot(index, key);
+    if (!index->keys[slot]) {
+        index->keys[slot] = key;
+        index->count++;
+    }
+    index->values[slot] = value;
+}
+
+static void free_index(NameIndex* index) {
+    free(index->keys);
+    free(index->values);
+}
+
+static TypedName* find_name(TypeChecker* checker, const char* name) {
+    int i = index_get(&checker->name_index, name);
+    return i >= 0 ? &checker->names[i] : NULL;
+}
+
+static void declare_name(TypeChecker* checker, const char* name, const char* type) {
+    StaticType static_type = declared_type(type);
+    TypedName* entry = find_name(checker, name);
+    if (entry) {
+        if (entry->declared != static_type) {
+            entry->declared = TYPE_UNKNOWN;
+            entry->stable = false;
+        }
+        return;
+    }
+    
+    if (checker->name_count == checker->name_capacity) {
+        checker->name_capacity = checker->name_capacity ? checker->name_capacity * 2 : 32;
+        checker->names = realloc(checker->names, sizeof(TypedName) * checker->name_capacity);
+    }
+    index_put(&checker->name_index, name, checker->name_count);
+    entry = &checker->names[checker->name_count++];
+    entry->name = name;
+    entry->declared = static_type;
+    entry->stable = static_type != TYPE_UNKNOWN;
+}
+
+static void lose_type(TypeChecker* checker, TypedName* entry) {
+    if (entry && entry->stable) {
+        entry->stable = false;
+        checker->changed = true;
+    }
+}
+
+// Finds every declaration and function definition
+static void collect(TypeChecker* checker, ASTNode* node) {
+    if (!node) {
+        return;
+    }
+    
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->program.statement_count; i++) {
+                collect(checker, node->program.statements[i]);
+            }
+            break;
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statement_count; i++) {
+                collect(checker, node->block.statements[i]);
+            }
+            break;
+        case AST_FUNCTION_DEF:
+            if (checker->function_count == checker->function_capacity) {
+                checker->function_capacity = checker->function_capacity ? checker->function_capacity * 2 : 16;
+                checker->functions = realloc(checker->functions, sizeof(ASTNode*) * checker->function_capacity);
+                checker->returns = realloc(checker->returns, sizeof(StaticType) * checker->function_capacity);
+                checker->generators = realloc(checker->generators, sizeof(bool) * checker->function_capacity);
+                checker->next_definition = realloc(checker->next_definition, sizeof(int) * checker->function_capacity);
+            }
+            checker->returns[checker->function_count] = TYPE_UNKNOWN;
+            checker->generators[checker->function_count] = contains_yield(node->func_def.body);
+            checker->next_definition[checker->function_count] =
+                index_get(&checker->function_index, node->func_def.name);
+            index_put(&checker->function_index, node->func_def.name, checker->function_count);
+            checker->functions[checker->function_count++] = node;
+            for (int i = 0; i < node->func_def.param_count; i++) {
+                collect(checker, node->func_def.parameters[i]);
+            }
+            collect(checker, node->func_def.body);
+            break;
+        case AST_VARIABLE_DECL:
+            declare_name(checker, node->var_decl.name, node->var_decl.type);
+            break;
+        case AST_USE_STATEMENT: {
+            // Extension functions take precedence over user functions
+            const char* module = node->use_stmt.module_name;
+            if (strcmp(module, "stdlib") != 0 && strcmp(module, "dmo_graphs") != 0 &&
+                strcmp(module, "request") != 0 && strcmp(module, "math") != 0 &&
+                strcmp(module, "file") != 0) {
+                checker->typed_calls = false;
+            }
+            break;
+        }
+        case AST_IF_STATEMENT:
+            collect(checker, node->if_stmt.then_stmt);
+            collect(checker, node->if_stmt.else_stmt);
+            break;
+        case AST_WHILE_LOOP:
+            collect(checker, node->while_loop.body);
+            break;
+        case AST_FOR_LOOP:
+            collect(checker, node->for_loop.init);
+            collect(checker, node->for_loop.body);
+            break;
+        default:
+            break;
+    }
+}
+
+static void enter_scope(TypeChecker* checker, const char* name) {
+    if (checker->scope_count == checker->scope_capacity) {
+        checker->scope_capacity = checker->scope_capacity ? checker->scope_capacity * 2 : 32;
+        checker->scope = realloc(checker->scope, sizeof(const char*) * checker->scope_capacity);
+    }
+    checker->scope[checker->scope_count++] = name;
+}
+
+static bool in_scope(TypeChecker* checker, const char* name) {
+    for (int i = checker->scope_count - 1; i >= checker->scope_base; i--) {
+        if (strcmp(checker->scope[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A value of the given static type is stored into a variable called name
+static void check_store(TypeChecker* checker, ASTNode* node, const char* name, StaticType type) {
+    TypedName* entry = find_name(checker, name);
+    if (!entry || entry->declared == TYPE_UNKNOWN || entry->declared == type) {
+        return;
+    }
+    
+    if (type != TYPE_UNKNOWN) {
+        type_error(checker, node, "cannot assign a %s to '%s', which is declared %s",
+                   static_type_name(type), name, entry->declared == TYPE_NUMBER ? "int" : "string");
+    }
+    lose_type(checker, entry);
+}
+
+// Parameters take the types of the arguments of every call site
+static void check_call(TypeChecker* checker, ASTNode* call, const StaticType* arg_types) {
+    for (int f = index_get(&checker->function_index, call->func_call.name); f >= 0;
+         f = checker->next_definition[f]) {
+        ASTNode* def = checker->functions[f];
+        for (int i = 0; i < def->func_def.param_count; i++) {
+            ASTNode* param = def->func_def.parameters[i];
+            StaticType expected = declared_type(param->var_decl.type);
+            StaticType type = i < call->func_call.arg_count ? arg_types[i] : TYPE_UNKNOWN;
+            if (expected != TYPE_UNKNOWN && type != TYPE_UNKNOWN && type != expected) {
+                type_error(checker, call, "argument %d of '%s' is a %s, but '%s' is declared %s",
+                           i + 1, call->func_call.name, static_type_name(type),
+                           param->var_decl.name, param->var_decl.type);
+            }
+            if (type != expected) {
+                lose_type(checker, find_name(checker, param->var_decl.name));
+            }
+        }
+    }
+}
+
+static int find_function(TypeChecker* checker, ASTNode* def) {
+    for (int f = index_get(&checker->function_index, def->func_def.name); f >= 0;
+         f = checker->next_definition[f]) {
+        if (checker->functions[f] == def) {
+            return f;
+        }
+    }
+    return -1;
+}
+
+// What a call returns when every definition of its name returns the
+// same type
+static StaticType call_type(TypeChecker* checker, ASTNode* call) {
+    const char* name = call->func_call.name;
+    if (!checker->typed_calls || builtin_table_find(core_builtins(), name)) {
+        return TYPE_UNKNOWN;
+    }
+    
+    StaticType type = TYPE_UNKNOWN;
+    for (int f = index_get(&checker->function_index, name); f >= 0; f = checker->next_definition[f]) {
+        if (checker->returns[f] == TYPE_UNKNOWN ||
+            (type != TYPE_UNKNOWN && type != checker->returns[f])) {
+            return TYPE_UNKNOWN;
+        }
+        type = checker->returns[f];
+    }
+    return type;
+}
+
+static void lose_return_type(TypeChecker* checker, int function) {
+    if (checker->returns[function] != TYPE_UNKNOWN) {
+        checker->returns[function] = TYPE_UNKNOWN;
+        checker->changed = true;
+    }
+}
+
+// A body that can end without a return statement gives void
+static bool always_returns(ASTNode* node) {
+    if (!node) {
+        return false;
+    }
+    
+    switch (node->type) {
+        case AST_RETURN_STATEMENT:
+            return node->return_stmt.value != NULL;
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statement_count; i++) {
+                if (always_returns(node->block.statements[i])) {
+                    return true;
+                }
+            }
+            return false;
+        case AST_IF_STATEMENT:
+            return always_returns(node->if_stmt.then_stmt) && always_returns(node->if_stmt.else_stmt);
+        default:
+            return false;
+    }
+}
+
+// Whether an expression or statement may call something other than a
+// builtin
+static bool has_user_call(ASTNode* node) {
+    if (!node) {
+        return false;
+    }
+    
+    switch (node->type) {
+        case AST_FUNCTION_CALL:
+            if (!builtin_table_find(core_builtins(), node->func_call.name)) {
+                return true;
+            }
+            for (int i = 0; i < node->func_call.arg_count; i++) {
+                if (has_user_call(node->func_call.arguments[i])) {
+                    return true;
+                }
+            }
+            return false;
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statement_count; i++) {
+                if (has_user_call(node->block.statements[i])) {
+                    return true;
+                }
+            }
+            return false;
+        case AST_VARIABLE_DECL:
+            return has_user_call(node->var_decl.initializer);
+        case AST_ASSIGNMENT:
+            return has_user_call(node->assignment.target) || has_user_call(node->assignment.value);
+        case AST_IF_STATEMENT:
+            return has_user_call(node->if_stmt.condition) || has_user_call(node->if_stmt.then_stmt) ||
+                   has_user_call(node->if_stmt.else_stmt);
+        case AST_WHILE_LOOP:
+            return has_user_call(node->while_loop.condition) || has_user_call(node->while_loop.body);
+        case AST_FOR_LOOP:
+            return has_user_call(node->for_loop.init) || has_user_call(node->for_loop.condition) ||
+                   has_user_call(node->for_loop.increment) || has_user_call(node->for_loop.body);
+        case AST_RETURN_STATEMENT:
+            return has_user_call(node->return_stmt.value);
+        case AST_YIELD:
+            return has_user_call(node->yield_stmt.value);
+        case AST_BINARY_OP:
+            return has_user_call(node->binary_op.left) || has_user_call(node->binary_op.right);
+        case AST_UNARY_OP:
+            return has_user_call(node->unary_op.operand);
+        case AST_ARRAY_ACCESS:
+            return has_user_call(node->array_access.array) || has_user_call(node->array_access.index);
+        case AST_SPAWN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static StaticType infer(TypeChecker* checker, ASTNode* node);
+
+static StaticType infer_binary_op(TypeChecker* checker, ASTNode* node) {
+    StaticType left = infer(checker, node->binary_op.left);
+    StaticType right = infer(checker, node->binary_op.right);
+    TokenType operator = node->binary_op.operator;
+    
+    if (operator == TOKEN_AND || operator == TOKEN_OR) {
+        return TYPE_NUMBER;
+    }
+    if (left == TYPE_UNKNOWN || right == TYPE_UNKNOWN) {
+        return TYPE_UNKNOWN;
+    }
+    if (left != right) {
+        type_error(checker, node, "cannot apply '%s' to a %s and a %s",
+                   operator_text(operator), static_type_name(left), static_type_name(right));
+        return TYPE_UNKNOWN;
+    }
+    if (left == TYPE_NUMBER) {
+        return TYPE_NUMBER;
+    }
+    
+    // Strings only concatenate and compare for equality; other operators
+    // report an error at run time and give ""
+    if (operator == TOKEN_EQUAL || operator == TOKEN_NOT_EQUAL) {
+        return TYPE_NUMBER;
+    }
+    if (operator != TOKEN_PLUS) {
+        type_error(checker, node, "cannot apply '%s' to strings", operator_text(operator));
+    }
+    return TYPE_STRING;
+}
+
+static StaticType infer(TypeChecker* checker, ASTNode* node) {
+    if (!node) {
+        return TYPE_UNKNOWN;
+    }
+    
+    StaticType type = TYPE_UNKNOWN;
+    int scope_mark = checker->scope_count;
+    
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->program.statement_count; i++) {
+                infer(checker, node->program.statements[i]);
+            }
+            break;
+        
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statement_count; i++) {
+                infer(checker, node->block.statements[i]);
+            }
+            checker->scope_count = scope_mark;
+            break;
+        
+        case AST_FUNCTION_DEF: {
+            // A body sees its caller's variables, never those around the definition
+            int base = checker->scope_base;
+            int function = checker->function;
+            checker->scope_base = checker->scope_count;
+            checker->function = find_function(checker, node);
+            for (int i = 0; i < node->func_def.param_count; i++) {
+                enter_scope(checker, node->func_def.parameters[i]->var_decl.name);
+            }
+            infer(checker, node->func_def.body);
+            if (!checker->generators[checker->function] && !always_returns(node->func_def.body)) {
+                lose_return_type(checker, checker->function);
+            }
+            checker->scope_count = scope_mark;
+            checker->scope_base = base;
+            checker->function = function;
+            break;
+        }
+        
+        case AST_VARIABLE_DECL: {
+            StaticType expected = declared_type(node->var_decl.type);
+            StaticType value = expected;
+            if (node->var_decl.initializer) {
+                value = infer(checker, node->var_decl.initializer);
+            }
+            if (expected != TYPE_UNKNOWN && value != TYPE_UNKNOWN && value != expected) {
+                type_error(checker, node, "'%s' is declared %s but initialized with a %s",
+                           node->var_decl.name, node->var_decl.type, static_type_name(value));
+            }
+            if (value != expected) {
+                lose_type(checker, find_name(checker, node->var_decl.name));
+            }
+            enter_scope(checker, node->var_decl.name);
+            break;
+        }
+        
+        case AST_ASSIGNMENT:
+            type = infer(checker, node->assignment.value);
+            if (node->assignment.target->type == AST_IDENTIFIER) {
+                check_store(checker, node, node->assignment.target->identifier.value, type);
+            } else {
+                infer(checker, node->assignment.target);
+            }
+            break;
+        
+        case AST_FUNCTION_CALL: {
+            StaticType* arg_types = malloc(sizeof(StaticType) * (node->func_call.arg_count + 1));
+            for (int i = 0; i < node->func_call.arg_count; i++) {
+                arg_types[i] = infer(checker, node->func_call.arguments[i]);
+            }
+            check_call(checker, node, arg_types);
+            free(arg_types);
+            type = call_type(checker, node);
+            break;
+        }
+        
+        case AST_IF_STATEMENT:
+            infer(checker, node->if_stmt.condition);
+            infer(checker, node->if_stmt.then_stmt);
+            checker->scope_count = scope_mark;
+            infer(checker, node->if_stmt.else_stmt);
+            checker->scope_count = scope_mark;
+            break;
+        
+        case AST_WHILE_LOOP:
+            infer(checker, node->while_loop.condition);
+            infer(checker, node->while_loop.body);
+            checker->scope_count = scope_mark;
+            break;
+        
+        case AST_FOR_LOOP: {
+            ASTNode* init = node->for_loop.init;
+            infer(checker, init);
+            if (node->for_loop.parallel) {
+                // Chunks set the loop variable and the private copies of
+                // reduction variables to numbers
+                ASTNode* clause = node->for_loop.parallel;
+                if (init && init->type == AST_VARIABLE_DECL) {
+                    check_store(checker, init, init->var_decl.name, TYPE_NUMBER);
+                }
+                for (int i = 0; i < clause->parallel.reduction_count; i++) {
+                    ASTNode* reduction = clause->parallel.reductions[i];
+                    check_store(checker, reduction, reduction->reduction.name, TYPE_NUMBER);
+                }
+            }
+            infer(checker, node->for_loop.condition);
+            infer(checker, node->for_loop.body);
+            checker->scope_count = scope_mark + (init && init->type == AST_VARIABLE_DECL ? 1 : 0);
+            infer(checker, node->for_loop.increment);
+            checker->scope_count = scope_mark;
+            break;
+        }
+        
+        case AST_RETURN_STATEMENT: {
+            StaticType value = infer(checker, node->return_stmt.value);
+            
+            // A generator's return only ends it; the value goes nowhere
+            if (checker->function >= 0 && !checker->generators[checker->function]) {
+                ASTNode* def = checker->functions[checker->function];
+                StaticType expected = declared_type(def->func_def.return_type);
+                if (expected != TYPE_UNKNOWN && value != TYPE_UNKNOWN && value != expected) {
+                    type_error(checker, node, "'%s' is declared %s but returns a %s",
+                               def->func_def.name, def->func_def.return_type, static_type_name(value));
+                }
+                if (value != checker->returns[checker->function]) {
+                    lose_return_type(checker, checker->function);
+                }
+            }
+            break;
+        }
+        
+        case AST_BINARY_OP:
+            type = infer_binary_op(checker, node);
+            break;
+        
+        case AST_UNARY_OP: {
+            StaticType operand = infer(checker, node->unary_op.operand);
+            if (node->unary_op.operator == TOKEN_NOT) {
+                type = TYPE_NUMBER;
+            } else if (operand == TYPE_STRING) {
+                type_error(checker, node, "cannot negate a string");
+            } else {
+                type = operand;
+            }
+            break;
+        }
+        
+        case AST_IDENTIFIER: {
+            TypedName* entry = find_name(checker, node->identifier.value);
+            if (entry && entry->stable && in_scope(checker, node->identifier.value)) {
+                type = entry->declared;
+            }
+            break;
+        }
+        
+        case AST_NUMBER:
+            type = TYPE_NUMBER;
+            break;
+        
+        case AST_STRING:
+            type = TYPE_STRING;
+            break;
+        
+        case AST_ARRAY_ACCESS:
+            infer(checker, node->array_access.array);
+            infer(checker, node->array_access.index);
+            break;
+        
+        case AST_SPAWN:
+            infer(checker, node->spawn.call);
+            break;
+        
+        case AST_YIELD:
+            infer(checker, node->yield_stmt.value);
+            break;
+        
+        default:
+            break;
+    }
+    
+    node->static_type = type;
+    return type;
+}
+
+int check_types(ASTNode* program) {
+    TypeChecker checker;
+    memset(&checker, 0, sizeof(checker));
+    checker.function = -1;
+    checker.typed_calls = true;
+    collect(&checker, program);
+    
+    // Functions defined at the top level are all defined before main
+    // runs. Calls made while the top level still runs may come before the
+    // definition and give void, so then no call is typed.
+    for (int i = 0; i < program->program.statement_count; i++) {
+        ASTNode* statement = program->program.statements[i];
+        if (statement->type == AST_FUNCTION_DEF) {
+            int function = find_function(&checker, statement);
+            checker.returns[function] = checker.generators[function]
+                ? TYPE_NUMBER : declared_type(statement->func_def.return_type);
+        } else if (has_user_call(statement)) {
+            checker.typed_calls = false;
+        }
+    }
+    
+    // main is called without arguments
+    for (int f = 0; f < checker.function_count; f++) {
+        ASTNode* def = checker.functions[f];
+        if (strcmp(def->func_def.name, "main") == 0) {
+            for (int i = 0; i < def->func_def.param_count; i++) {
+                lose_type(&checker, find_name(&checker, def->func_def.parameters[i]->var_decl.name));
+            }
+        }
+    }
+    
+    // Names only ever lose their type, so this settles after at most one
+    // pass per name; the last pass changes nothing and reports the errors
+    do {
+        checker.changed = false;
+        infer(&checker, program);
+    } while (checker.changed);
+    
+    checker.report = true;
+    infer(&checker, program);
+    
+    free(checker.names);
+    free_index(&checker.name_index);
+    free(checker.functions);
+    free(checker.returns);
+    free(checker.generators);
+    free(checker.next_definition);
+    free_index(&checker.function_index);
+    free(checker.scope);
+    return checker.errors;
+}
@@ -0,0 +1,24 @@
+/*
+ * DMO Type Checker Header
+ * Infers the static types of expressions and reports type errors before execution
+ */
+
+#ifndef DMO_TYPES_H
+#define DMO_TYPES_H
+
+#include "ast.h"
+
+// Sets static_type on every expression of program and reports type
+// errors on stderr. Returns the number of errors; the program still runs
+// as before when there are some.
+//
+// An expression is TYPE_NUMBER or TYPE_STRING only when every run is
+// guaranteed to produce that type, so the interpreter can evaluate it
+// without checking value tags. A variable is typed where its declaration
+// or parameter is sure to have run, and only when every store to that
+// name anywhere in the program is known to have the declared type:
+// functions see their caller's variables, so a store may land in any
+// variable of the name.
+int check_types(ASTNode* program);
+
+#endif // DMO_TYPES_H
@@ -0,0 +1,409 @@
+/*
+ * DMO Vector Math Implementation
+ * Element-wise math kernels over double buffers, SSE2 where available
+ *
+ * The polynomials and reduction constants are the ones of fdlibm's
+ * __kernel_sin, __kernel_cos and __ieee754_exp.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "dmo_vecmath.h"
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Without optimization every intermediate goes through memory and the
+// polynomials below end up slower than libm's own routines, so unoptimized
+// builds call libm for each element instead
+#ifdef __OPTIMIZE__
+#define VEC_POLYNOMIAL 1
+#else
+#define VEC_POLYNOMIAL 0
+#endif
+
+// Adding and subtracting 1.5 * 2^52 rounds a double to the nearest integer
+#define ROUND_MAGIC 6755399441055744.0
+
+// pi/2 in three parts: the first two have 33 significant bits, so their
+// products with a quadrant number below 2^19 are exact
+static const double invpio2 = 6.36619772367581382433e-01;
+static const double pio2_1 = 1.57079632673412561417e+00;
+static const double pio2_2 = 6.07710050630396597660e-11;
+static const double pio2_2t = 2.02226624879595063154e-21;
+
+static const double S1 = -1.66666666666666324348e-01;
+static const double S2 = 8.33333333332248946124e-03;
+static const double S3 = -1.98412698298579493134e-04;
+static const double S4 = 2.75573137070700676789e-06;
+static const double S5 = -2.50507602534068634195e-08;
+static const double S6 = 1.58969099521155010221e-10;
+
+static const double C1 = 4.16666666666666019037e-02;
+static const double C2 = -1.38888888888741095749e-03;
+static const double C3 = 2.48015872894767294178e-05;
+static const double C4 = -2.75573143513906633035e-07;
+static const double C5 = 2.08757232129817482790e-09;
+static const double C6 = -1.13596475577881948265e-11;
+
+static const double invln2 = 1.44269504088896338700e+00;
+static const double ln2hi = 6.93147180369123816490e-01;
+static const double ln2lo = 1.90821492927058770002e-10;
+static const double P1 = 1.66666666666666019037e-01;
+static const double P2 = -2.77777777770155933842e-03;
+static const double P3 = 6.61375632143793436117e-05;
+static const double P4 = -1.65339022054652515390e-06;
+static const double P5 = 4.13813679705723846039e-08;
+
+// Scalar versions. The SSE2 code below performs the same operations in the
+// same order, two elements at a time.
+
+// x = k * pi/2 + (hi + lo) with |hi + lo| <= pi/4 (about)
+static int reduce_pio2(double x, double* hi, double* lo) {
+    double k = (x * invpio2 + ROUND_MAGIC) - ROUND_MAGIC;
+    double t = x - k * pio2_1;
+    double w = k * pio2_2;
+    double r = t - w;
+    double tail = ((t - r) - w) - k * pio2_2t;
+    *hi = r + tail;
+    *lo = (r - *hi) + tail;
+    return (int)k;
+}
+
+static double kernel_sin(double x, double y) {
+    double z = x * x;
+    double v = z * x;
+    double r = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+    return x - ((z * (0.5 * y - v * r) - y) - v * S1);
+}
+
+static double kernel_cos(double x, double y) {
+    double z = x * x;
+    double r = z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+    double hz = 0.5 * z;
+    double w = 1.0 - hz;
+    return w + (((1.0 - w) - hz) + (z * r - x * y));
+}
+
+// sin(x + quadrant * pi/2) from the reduced argument
+static double sin_quadrant(double hi, double lo, int quadrant) {
+    double value = (quadrant & 1) ? kernel_cos(hi, lo) : kernel_sin(hi, lo);
+    return (quadrant & 2) ? -value : value;
+}
+
+static double scalar_sin(double x) {
+    if (!VEC_POLYNOMIAL || !(fabs(x) < VEC_TRIG_MAX)) {
+        return sin(x);
+    }
+    double hi, lo;
+    int k = reduce_pio2(x, &hi, &lo);
+    return sin_quadrant(hi, lo, k);
+}
+
+static double scalar_cos(double x) {
+    if (!VEC_POLYNOMIAL || !(fabs(x) < VEC_TRIG_MAX)) {
+        return cos(x);
+    }
+    double hi, lo;
+    int k = reduce_pio2(x, &hi, &lo);
+    return sin_quadrant(hi, lo, k + 1);
+}
+
+static double scalar_tan(double x) {
+    if (!VEC_POLYNOMIAL || !(fabs(x) < VEC_TRIG_MAX)) {
+        return tan(x);
+    }
+    double hi, lo;
+    int k = reduce_pio2(x, &hi, &lo);
+    double s = kernel_sin(hi, lo);
+    double c = kernel_cos(hi, lo);
+    return (k & 1) ? -c / s : s / c;
+}
+
+static double scalar_exp(double x) {
+    if (!VEC_POLYNOMIAL || !(fabs(x) <= VEC_EXP_MAX)) {
+        return exp(x);
+    }
+    double k = (x * invln2 + ROUND_MAGIC) - ROUND_MAGIC;
+    double hi = x - k * ln2hi;
+    double lo = k * ln2lo;
+    double r = hi - lo;
+    double rr = r * r;
+    double c = r - rr * (P1 + rr * (P2 + rr * (P3 + rr * (P4 + rr * P5))));
+    double y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+    
+    uint64_t bits = (uint64_t)((int64_t)k + 1023) << 52;
+    double scale;
+    memcpy(&scale, &bits, sizeof(double));
+    return y * scale;
+}
+
+static double scalar_sigmoid(double x) {
+    return 1.0 / (1.0 + scalar_exp(-x));
+}
+
+#if defined(__SSE2__) && VEC_POLYNOMIAL
+// Each 32 bit integer of the low half widened to a 64 bit lane
+static __m128i widen_epi32(__m128i v) {
+    return _mm_unpacklo_epi32(v, _mm_srai_epi32(v, 31));
+}
+
+// All ones in the double lanes whose 32 bit quadrant has the given bit set
+static __m128d bit_mask(__m128i quadrant, int bit) {
+    __m128i b = _mm_set1_epi32(bit);
+    __m128i set = _mm_cmpeq_epi32(_mm_and_si128(quadrant, b), b);
+    return _mm_castsi128_pd(_mm_unpacklo_epi32(set, set));
+}
+
+static __m128d select_pd(__m128d mask, __m128d a, __m128d b) {
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+static __m128i reduce_pio2_pd(__m128d x, __m128d* hi, __m128d* lo) {
+    const __m128d magic = _mm_set1_pd(ROUND_MAGIC);
+    __m128d k = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(invpio2)), magic), magic);
+    __m128d t = _mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(pio2_1)));
+    __m128d w = _mm_mul_pd(k, _mm_set1_pd(pio2_2));
+    __m128d r = _mm_sub_pd(t, w);
+    __m128d tail = _mm_sub_pd(_mm_sub_pd(_mm_sub_pd(t, r), w), _mm_mul_pd(k, _mm_set1_pd(pio2_2t)));
+    *hi = _mm_add_pd(r, tail);
+    *lo = _mm_add_pd(_mm_sub_pd(r, *hi), tail);
+    return _mm_cvtpd_epi32(k);
+}
+
+static __m128d kernel_sin_pd(__m128d x, __m128d y) {
+    __m128d z = _mm_mul_pd(x, x);
+    __m128d v = _mm_mul_pd(z, x);
+    __m128d r = _mm_add_pd(_mm_set1_pd(S5), _mm_mul_pd(z, _mm_set1_pd(S6)));
+    r = _mm_add_pd(_mm_set1_pd(S4), _mm_mul_pd(z, r));
+    r = _mm_add_pd(_mm_set1_pd(S3), _mm_mul_pd(z, r));
+    r = _mm_add_pd(_mm_set1_pd(S2), _mm_mul_pd(z, r));
+    __m128d inner = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(0.5), y), _mm_mul_pd(v, r));
+    inner = _mm_sub_pd(_mm_mul_pd(z, inner), y);
+    inner = _mm_sub_pd(inner, _mm_mul_pd(v, _mm_set1_pd(S1)));
+    return _mm_sub_pd(x, inner);
+}
+
+static __m128d kernel_cos_pd(__m128d x, __m128d y) {
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d z = _mm_mul_pd(x, x);
+    __m128d r = _mm_add_pd(_mm_set1_pd(C5), _mm_mul_pd(z, _mm_set1_pd(C6)));
+    r = _mm_add_pd(_mm_set1_pd(C4), _mm_mul_pd(z, r));
+    r = _mm_add_pd(_mm_set1_pd(C3), _mm_mul_pd(z, r));
+    r = _mm_add_pd(_mm_set1_pd(C2), _mm_mul_pd(z, r));
+    r = _mm_add_pd(_mm_set1_pd(C1), _mm_mul_pd(z, r));
+    r = _mm_mul_pd(z, r);
+    __m128d hz = _mm_mul_pd(_mm_set1_pd(0.5), z);
+    __m128d w = _mm_sub_pd(one, hz);
+    __m128d tail = _mm_sub_pd(_mm_sub_pd(one, w), hz);
+    tail = _mm_add_pd(tail, _mm_sub_pd(_mm_mul_pd(z, r), _mm_mul_pd(x, y)));
+    return _mm_add_pd(w, tail);
+}
+
+static __m128d sin_quadrant_pd(__m128d hi, __m128d lo, __m128i quadrant) {
+    __m128d s = kernel_sin_pd(hi, lo);
+    __m128d c = kernel_cos_pd(hi, lo);
+    __m128d value = select_pd(bit_mask(quadrant, 1), c, s);
+    __m128d sign = _mm_and_pd(bit_mask(quadrant, 2), _mm_set1_pd(-0.0));
+    return _mm_xor_pd(value, sign);
+}
+
+// Both lanes below the limit, which also rules out NaN
+static int trig_in_range(__m128d x) {
+    __m128d magnitude = _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+    return _mm_movemask_pd(_mm_cmplt_pd(magnitude, _mm_set1_pd(VEC_TRIG_MAX))) == 3;
+}
+
+static __m128d sin_pd(__m128d x, int shift) {
+    __m128d hi, lo;
+    __m128i quadrant = reduce_pio2_pd(x, &hi, &lo);
+    quadrant = _mm_add_epi32(quadrant, _mm_set1_epi32(shift));
+    return sin_quadrant_pd(hi, lo, quadrant);
+}
+
+static __m128d tan_pd(__m128d x) {
+    __m128d hi, lo;
+    __m128i quadrant = reduce_pio2_pd(x, &hi, &lo);
+    __m128d s = kernel_sin_pd(hi, lo);
+    __m128d c = kernel_cos_pd(hi, lo);
+    __m128d odd = bit_mask(quadrant, 1);
+    __m128d quotient = _mm_div_pd(select_pd(odd, c, s), select_pd(odd, s, c));
+    return _mm_xor_pd(quotient, _mm_and_pd(odd, _mm_set1_pd(-0.0)));
+}
+
+static int exp_in_range(__m128d x) {
+    __m128d magnitude = _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+    return _mm_movemask_pd(_mm_cmple_pd(magnitude, _mm_set1_pd(VEC_EXP_MAX))) == 3;
+}
+
+static __m128d exp_pd(__m128d x) {
+    const __m128d magic = _mm_set1_pd(ROUND_MAGIC);
+    __m128d k = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(invln2)), magic), magic);
+    __m128d hi = _mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(ln2hi)));
+    __m128d lo = _mm_mul_pd(k, _mm_set1_pd(ln2lo));
+    __m128d r = _mm_sub_pd(hi, lo);
+    __m128d rr = _mm_mul_pd(r, r);
+    __m128d p = _mm_add_pd(_mm_set1_pd(P4), _mm_mul_pd(rr, _mm_set1_pd(P5)));
+    p = _mm_add_pd(_mm_set1_pd(P3), _mm_mul_pd(rr, p));
+    p = _mm_add_pd(_mm_set1_pd(P2), _mm_mul_pd(rr, p));
+    p = _mm_add_pd(_mm_set1_pd(P1), _mm_mul_pd(rr, p));
+    __m128d c = _mm_sub_pd(r, _mm_mul_pd(rr, p));
+    __m128d q = _mm_div_pd(_mm_mul_pd(r, c), _mm_sub_pd(_mm_set1_pd(2.0), c));
+    __m128d y = _mm_sub_pd(_mm_set1_pd(1.0), _mm_sub_pd(_mm_sub_pd(lo, q), hi));
+    
+    __m128i exponent = widen_epi32(_mm_add_epi32(_mm_cvtpd_epi32(k), _mm_set1_epi32(1023)));
+    __m128d scale = _mm_castsi128_pd(_mm_slli_epi64(exponent, 52));
+    return _mm_mul_pd(y, scale);
+}
+#endif
+
+void vec_sin(const double* in, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__) && VEC_POLYNOMIAL
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(in + i);
+        if (trig_in_range(x)) {
+            _mm_storeu_pd(out + i, sin_pd(x, 0));
+        } else {
+            out[i] = scalar_sin(in[i]);
+            out[i + 1] = scalar_sin(in[i + 1]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = scalar_sin(in[i]);
+    }
+}
+
+void vec_cos(const double* in, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__) && VEC_POLYNOMIAL
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(in + i);
+        if (trig_in_range(x)) {
+            _mm_storeu_pd(out + i, sin_pd(x, 1));
+        } else {
+            out[i] = scalar_cos(in[i]);
+            out[i + 1] = scalar_cos(in[i + 1]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = scalar_cos(in[i]);
+    }
+}
+
+void vec_tan(const double* in, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__) && VEC_POLYNOMIAL
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(in + i);
+        if (trig_in_range(x)) {
+            _mm_storeu_pd(out + i, tan_pd(x));
+        } else {
+            out[i] = scalar_tan(in[i]);
+            out[i + 1] = scalar_tan(in[i + 1]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = scalar_tan(in[i]);
+    }
+}
+
+void vec_exp(const double* in, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__) && VEC_POLYNOMIAL
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(in + i);
+        if (exp_in_range(x)) {
+            _mm_storeu_pd(out + i, exp_pd(x));
+        } else {
+            out[i] = scalar_exp(in[i]);
+            out[i + 1] = scalar_exp(in[i + 1]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = scalar_exp(in[i]);
+    }
+}
+
+void vec_sigmoid(const double* in, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__) && VEC_POLYNOMIAL
+    const __m128d one = _mm_set1_pd(1.0);
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_xor_pd(_mm_loadu_pd(in + i), _mm_set1_pd(-0.0));
+        if (exp_in_range(x)) {
+            _mm_storeu_pd(out + i, _mm_div_pd(one, _mm_add_pd(one, exp_pd(x))));
+        } else {
+            out[i] = scalar_sigmoid(in[i]);
+            out[i + 1] = scalar_sigmoid(in[i + 1]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = scalar_sigmoid(in[i]);
+    }
+}
+
+size_t vec_sqrt(const double* in, double* out, size_t n) {
+    size_t negative = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128d zero = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(in + i);
+        __m128d valid = _mm_cmpge_pd(x, zero);
+        int mask = _mm_movemask_pd(_mm_cmplt_pd(x, zero));
+        negative += (mask & 1) + (mask >> 1);
+        _mm_storeu_pd(out + i, _mm_and_pd(valid, _mm_sqrt_pd(_mm_and_pd(valid, x))));
+    }
+#endif
+    for (; i < n; i++) {
+        if (in[i] < 0) {
+            negative++;
+        }
+        out[i] = in[i] >= 0 ? sqrt(in[i]) : 0;
+    }
+    return negative;
+}
+
+void vec_pow(const double* in, double exponent, double* out, size_t n) {
+    if (exponent == 0.5) {
+        // pow(-x, 0.5) is NaN rather than the scalar sqrt's 0
+        for (size_t i = 0; i < n; i++) {
+            out[i] = in[i] >= 0 ? sqrt(in[i]) : NAN;
+        }
+        return;
+    }
+    
+    size_t i = 0;
+    if (exponent == 1.0 || exponent == 2.0 || exponent == 3.0) {
+#ifdef __SSE2__
+        for (; i + 2 <= n; i += 2) {
+            __m128d x = _mm_loadu_pd(in + i);
+            __m128d y = x;
+            if (exponent >= 2.0) {
+                y = _mm_mul_pd(y, x);
+            }
+            if (exponent == 3.0) {
+                y = _mm_mul_pd(y, x);
+            }
+            _mm_storeu_pd(out + i, y);
+        }
+#endif
+        for (; i < n; i++) {
+            double x = in[i];
+            out[i] = exponent == 1.0 ? x : (exponent == 2.0 ? x * x : x * x * x);
+        }
+        return;
+    }
+    
+    for (; i < n; i++) {
+        out[i] = pow(in[i], exponent);
+    }
+}
@@ -1,65 +1,55 @@
 /*
  * Example Diamond Extension
  * Custom string manipulation functions
+ *
+ * Build:  gcc -shared -fPIC -I. example_extension.c -o stringutils.so
+ * Use:    use stringutils;  then  reverse("abc"), uppercase("abc")
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "../interpreter.h"
+#include <ctype.h>
+#include "dmo_extension.h"
+#include "dmo_output.h"
 
-Value string_reverse(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count != 1) {
-        fprintf(stderr, "Error: reverse requires string\n");
-        return create_string_value("");
-    }
-    
-    Value input = execute_node(args[0], ctx);
-    int len = strlen(input.string);
+// Arguments are evaluated and checked against "s(s)" before the call
+Value string_reverse(const Value* args, int arg_count, InterpreterContext* ctx) {
+    const char* input = args[0].string;
+    int len = strlen(input);
     char* reversed = malloc(len + 1);
     
     for (int i = 0; i < len; i++) {
-        reversed[i] = input.string[len - 1 - i];
+        reversed[i] = input[len - 1 - i];
     }
     reversed[len] = '\0';
     
-    printf("🔄 Reversed string: %s -> %s\n", input.string, reversed);
-    
     Value result = create_string_value(reversed);
     free(reversed);
-    free_value(input);
     
     return result;
 }
 
-Value string_uppercase(ASTNode** args, int arg_count, InterpreterContext* ctx) {
-    if (arg_count != 1) {
-        fprintf(stderr, "Error: uppercase requires string\n");
-        return create_string_value("");
-    }
-    
-    Value input = execute_node(args[0], ctx);
-    int len = strlen(input.string);
+Value string_uppercase(const Value* args, int arg_count, InterpreterContext* ctx) {
+    const char* input = args[0].string;
+    int len = strlen(input);
     char* upper = malloc(len + 1);
     
     for (int i = 0; i < len; i++) {
-        upper[i] = toupper(input.string[i]);
+        upper[i] = toupper((unsigned char)input[i]);
     }
     upper[len] = '\0';
     
-    printf("📤 Uppercase: %s -> %s\n", input.string, upper);
-    
     Value result = create_string_value(upper);
     free(upper);
-    free_value(input);
     
     return result;
 }
 
-// Extension initialization
+// Extension initialization, found by name when a script says `use stringutils;`
 void init_stringutils_extension(InterpreterContext* ctx) {
-    printf("String Utils Extension loaded\n");
+    dmo_log(DMO_LOG_INFO, "String Utils Extension loaded\n");
     
-    register_function("reverse", string_reverse, ctx);
-    register_function("uppercase", string_uppercase, ctx);
-}
\ No newline at end of file
+    register_value_function("reverse", "s(s)", string_reverse, ctx);
+    register_value_function("uppercase", "s(s)", string_uppercase, ctx);
+}
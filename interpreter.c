@@ -8,6 +8,17 @@
 #include "stdlib_funcs.h"
 #include "dmo_graphs.h"
 #include "modules.h"
+#include "dmo_array.h"
+#include "dmo_map.h"
+#include "dmo_output.h"
+#include "dmo_runtime.h"
+#include "dmo_parallel.h"
+#include "dmo_builtins.h"
+#include "dmo_stack.h"
+#include "dmo_memo.h"
+#include "dmo_loops.h"
+#include "dmo_limits.h"
+#include "dmo_generator.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,12 +32,17 @@ InterpreterContext* create_interpreter_context() {
     ctx->global_funcs = NULL;
     ctx->has_return = false;
     ctx->return_value = create_void_value();
+    ctx->runtime = NULL;
+    ctx->parent = NULL;
+    ctx->worker = 0;
+    ctx->calls = NULL;
+    ctx->function = NULL;
+    ctx->tail_call = false;
+    ctx->generator = NULL;
     return ctx;
 }
 
-void free_interpreter_context(InterpreterContext* ctx) {
-    // Free variables
-    Variable* var = ctx->variables;
+static void free_variables(Variable* var) {
     while (var) {
         Variable* next = var->next;
         free(var->name);
@@ -35,21 +51,45 @@ void free_interpreter_context(InterpreterContext* ctx) {
         free(var);
         var = next;
     }
-    
-    // Free functions
-    Function* func = ctx->functions;
+}
+
+static void free_functions(Function* func) {
     while (func) {
         Function* next = func->next;
         free(func->name);
         free(func->return_type);
+        if (func->memo) {
+            memo_free(func->memo);
+        }
         free(func);
         func = next;
     }
-    
+}
+
+void free_interpreter_context(InterpreterContext* ctx) {
+    free_variables(ctx->variables);
+    free_functions(ctx->functions);
     free_value(ctx->return_value);
     free(ctx);
 }
 
+// Empties a call frame for the next call at its depth; the runtime, the
+// worker and the call stack are set again by whoever pushes it
+void reset_interpreter_context(InterpreterContext* ctx) {
+    free_variables(ctx->variables);
+    free_functions(ctx->functions);
+    free_value(ctx->return_value);
+    ctx->variables = NULL;
+    ctx->functions = NULL;
+    ctx->global_vars = NULL;
+    ctx->global_funcs = NULL;
+    ctx->has_return = false;
+    ctx->return_value = create_void_value();
+    ctx->function = NULL;
+    ctx->tail_call = false;
+    ctx->generator = NULL;
+}
+
 Value create_number_value(double num) {
     Value value;
     value.type = VALUE_NUMBER;
@@ -73,6 +113,10 @@ Value create_void_value() {
 void free_value(Value value) {
     if (value.type == VALUE_STRING && value.string) {
         free(value.string);
+    } else if (value.type == VALUE_ARRAY) {
+        array_release(value.array);
+    } else if (value.type == VALUE_MAP) {
+        map_release(value.map);
     }
 }
 
@@ -80,23 +124,67 @@ Value copy_value(Value value) {
     if (value.type == VALUE_STRING) {
         return create_string_value(value.string);
     }
+    if (value.type == VALUE_ARRAY) {
+        array_retain(value.array);
+    } else if (value.type == VALUE_MAP) {
+        map_retain(value.map);
+    }
     return value;
 }
 
-void print_value(Value value) {
+void print_value(Value value, DMOOutput* out) {
     switch (value.type) {
         case VALUE_NUMBER:
-            printf("%.6g", value.number);
+            output_number(out, value.number);
             break;
         case VALUE_STRING:
-            printf("%s", value.string);
+            output_string(out, value.string);
             break;
         case VALUE_VOID:
-            printf("void");
+            output_string(out, "void");
+            break;
+        case VALUE_ARRAY:
+            print_array(value.array, out);
+            break;
+        case VALUE_MAP:
+            print_map(value.map, out);
             break;
     }
 }
 
+// Single truthiness rule shared by conditions and logical operators:
+// non-zero numbers and non-empty strings, arrays and maps are true, void is false
+bool is_truthy(Value value) {
+    if (value.type == VALUE_NUMBER) {
+        return value.number != 0;
+    }
+    if (value.type == VALUE_STRING) {
+        return value.string[0] != '\0';
+    }
+    if (value.type == VALUE_ARRAY) {
+        return value.array->length > 0;
+    }
+    if (value.type == VALUE_MAP) {
+        return map_count(value.map) > 0;
+    }
+    return false;
+}
+
+static double evaluate_number(ASTNode* node, InterpreterContext* ctx, bool* is_void);
+
+bool execute_condition(ASTNode* node, InterpreterContext* ctx) {
+    if (node->static_type == TYPE_NUMBER) {
+        bool is_void = false;
+        double number = evaluate_number(node, ctx, &is_void);
+        return number != 0 && !is_void;
+    }
+    
+    Value condition = execute_node(node, ctx);
+    bool is_true = is_truthy(condition);
+    free_value(condition);
+    return is_true;
+}
+
 void set_variable(InterpreterContext* ctx, const char* name, const char* type, Value value) {
     Variable* var = ctx->variables;
     
@@ -137,9 +225,30 @@ Variable* get_variable(InterpreterContext* ctx, const char* name) {
         var = var->next;
     }
     
+    // A parallel loop body also sees the variables around the loop
+    if (ctx->parent) {
+        return get_variable(ctx->parent, name);
+    }
+    
     return NULL;
 }
 
+// True when the variable belongs to this context rather than to the
+// scope around a parallel loop
+static bool owns_variable(InterpreterContext* ctx, Variable* target) {
+    for (Variable* var = ctx->variables; var; var = var->next) {
+        if (var == target) {
+            return true;
+        }
+    }
+    for (Variable* var = ctx->global_vars; var; var = var->next) {
+        if (var == target) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void set_function(InterpreterContext* ctx, Function* func) {
     func->next = ctx->functions;
     ctx->functions = func;
@@ -166,7 +275,103 @@ Function* get_function(InterpreterContext* ctx, const char* name) {
     return NULL;
 }
 
+// The function list a call made from ctx should see. Function bodies have
+// no functions of their own, so they pass on what their caller saw; that
+// is what lets a function call itself or other functions.
+Function* visible_functions(InterpreterContext* ctx) {
+    while (ctx) {
+        if (ctx->functions) {
+            return ctx->functions;
+        }
+        if (ctx->global_funcs) {
+            return ctx->global_funcs;
+        }
+        ctx = ctx->parent;
+    }
+    return NULL;
+}
+
 int interpret(ASTNode* ast, const char* source_file) {
+    DMORuntime* runtime = create_runtime(stdout);
+    int status = interpret_with_runtime(ast, source_file, runtime);
+    free_runtime(runtime);
+    return status;
+}
+
+InterpreterContext* create_program_context(DMORuntime* runtime) {
+    InterpreterContext* ctx = create_interpreter_context();
+    ctx->runtime = runtime;
+    ctx->calls = create_call_stack();
+    runtime->budget = create_budget(&runtime->limits);
+    
+    // Initialize built-in functions
+    init_stdlib_functions(ctx);
+    
+    // Values supplied by an embedding host are ordinary globals
+    for (Variable* var = runtime->globals; var; var = var->next) {
+        set_variable(ctx, var->name, var->type, var->value);
+    }
+    
+    return ctx;
+}
+
+void call_main(InterpreterContext* ctx) {
+    Function* main_func = get_function(ctx, "main");
+    if (!main_func) {
+        return;
+    }
+    
+    // Create a function call node for main, zeroed like a parsed one so
+    // its position and evaluation hints read as unset
+    ASTNode* main_call = create_ast_node(AST_FUNCTION_CALL, 0, 0);
+    main_call->func_call.name = strdup("main");
+    
+    // Call main function
+    Value main_result = execute_function_call(main_call, ctx);
+    
+    if (main_result.type == VALUE_NUMBER) {
+        dmo_log(DMO_LOG_INFO, "Program returned: %.6g\n", main_result.number);
+    }
+    
+    // Clean up
+    free_ast(main_call);
+    free_value(main_result);
+}
+
+int finish_program_context(InterpreterContext* ctx) {
+    // Tasks nobody joined still need the program's functions, so they
+    // finish before the context goes away
+    DMORuntime* runtime = ctx->runtime;
+    finish_spawned_tasks(runtime);
+    
+    // Generators left suspended run the program's functions too
+    if (runtime->generators) {
+        close_all_generators(runtime->generators);
+    }
+    
+    for (Function* func = ctx->functions; func; func = func->next) {
+        if (func->memo) {
+            memo_log_profile(func->name, func->memo);
+        }
+    }
+    
+    // Steps and bytes the main thread took but didn't use aren't reported
+    DMOBudget* budget = runtime->budget;
+    return_unused(budget, ctx->calls);
+    
+    bool stopped = ctx->calls->stopped;
+    free_call_stack(ctx->calls);
+    free_interpreter_context(ctx);
+    output_flush(&runtime->output);
+    
+    // A limit may also have been hit by a task the program never joined
+    stopped = report_budget(budget) || stopped;
+    free_budget(budget);
+    runtime->budget = NULL;
+    return stopped ? 1 : 0;
+}
+
+int interpret_with_runtime(ASTNode* ast, const char* source_file, DMORuntime* runtime) {
     (void)source_file; // Suppress unused parameter warning
     
     if (!ast) {
@@ -174,49 +379,22 @@ int interpret(ASTNode* ast, const char* source_file) {
         return 1;
     }
     
-    InterpreterContext* ctx = create_interpreter_context();
-    
-    // Initialize built-in functions and graphics system
-    init_stdlib_functions(ctx);
-    init_dmo_graphics();
+    InterpreterContext* ctx = create_program_context(runtime);
     
-    printf("Executing DMO program...\n");
+    dmo_log(DMO_LOG_INFO, "Executing DMO program...\n");
     
     // First, execute the AST to define all functions and variables
     Value result = execute_node(ast, ctx);
     
     // Now automatically call the main function if it exists
-    Function* main_func = get_function(ctx, "main");
-    if (main_func) {
-        // Create a function call node for main
-        ASTNode* main_call = malloc(sizeof(ASTNode));
-        main_call->type = AST_FUNCTION_CALL;
-        main_call->func_call.name = strdup("main");
-        main_call->func_call.arguments = NULL;
-        main_call->func_call.arg_count = 0;
-        
-        // Call main function
-        Value main_result = execute_function_call(main_call, ctx);
-        
-        if (main_result.type == VALUE_NUMBER) {
-            printf("Program returned: %.6g\n", main_result.number);
-        }
-        
-        // Clean up
-        free(main_call->func_call.name);
-        free(main_call);
-        free_value(main_result);
-    }
+    call_main(ctx);
     
     if (result.type == VALUE_NUMBER) {
-        printf("Program setup returned: %.6g\n", result.number);
+        dmo_log(DMO_LOG_INFO, "Program setup returned: %.6g\n", result.number);
     }
-    
     free_value(result);
-    cleanup_dmo_graphics();
-    free_interpreter_context(ctx);
     
-    return 0;
+    return finish_program_context(ctx);
 }
 
 Value execute_node(ASTNode* node, InterpreterContext* ctx) {
@@ -261,6 +439,12 @@ Value execute_node(ASTNode* node, InterpreterContext* ctx) {
             return create_string_value(node->string.value);
         case AST_MEMBER_ACCESS:
             return execute_member_access(node, ctx);
+        case AST_ARRAY_ACCESS:
+            return execute_array_access(node, ctx);
+        case AST_SPAWN:
+            return execute_spawn(node, ctx);
+        case AST_YIELD:
+            return execute_yield(node, ctx);
         default:
             fprintf(stderr, "Error: Unknown AST node type: %d\n", node->type);
             return create_void_value();
@@ -282,6 +466,185 @@ Value execute_program(ASTNode* node, InterpreterContext* ctx) {
     return result;
 }
 
+// The names declared at a point of a function body, and whether it uses
+// any other
+typedef struct {
+    const char** names;
+    int count;
+    int capacity;
+    bool closed;
+} NameScope;
+
+static bool scope_has(const NameScope* scope, const char* name) {
+    for (int i = 0; i < scope->count; i++) {
+        if (strcmp(scope->names[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void scope_add(NameScope* scope, const char* name) {
+    if (scope->count == scope->capacity) {
+        scope->capacity = scope->capacity ? scope->capacity * 2 : 8;
+        scope->names = realloc(scope->names, sizeof(char*) * scope->capacity);
+    }
+    scope->names[scope->count++] = name;
+}
+
+static void check_use(ASTNode* node, void* data) {
+    NameScope* scope = data;
+    if (node->type == AST_IDENTIFIER && !scope_has(scope, node->identifier.value)) {
+        scope->closed = false;
+    } else if (node->type == AST_REDUCTION && !scope_has(scope, node->reduction.name)) {
+        scope->closed = false;
+    } else if (node->type == AST_FUNCTION_DEF) {
+        // Nested functions are looked up through the frame
+        scope->closed = false;
+    }
+}
+
+// Checks the uses below node against the names whose declaration has
+// surely run by then, in the order statements run, the way the type
+// checker scopes names. A declaration only covers what follows it in its
+// own block: after `if (c) { int x = 1; }` a use of x may still find the
+// caller's x. Expressions declare nothing, so below statements the names
+// are only looked up.
+static void check_scoped_uses(ASTNode* node, NameScope* scope) {
+    if (!node || !scope->closed) {
+        return;
+    }
+    
+    int mark = scope->count;
+    switch (node->type) {
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statement_count; i++) {
+                check_scoped_uses(node->block.statements[i], scope);
+            }
+            scope->count = mark;
+            break;
+        case AST_VARIABLE_DECL:
+            walk_ast(node->var_decl.initializer, check_use, scope);
+            scope_add(scope, node->var_decl.name);
+            break;
+        case AST_IF_STATEMENT:
+            walk_ast(node->if_stmt.condition, check_use, scope);
+            check_scoped_uses(node->if_stmt.then_stmt, scope);
+            scope->count = mark;
+            check_scoped_uses(node->if_stmt.else_stmt, scope);
+            scope->count = mark;
+            break;
+        case AST_WHILE_LOOP:
+            walk_ast(node->while_loop.condition, check_use, scope);
+            check_scoped_uses(node->while_loop.body, scope);
+            scope->count = mark;
+            break;
+        case AST_FOR_LOOP: {
+            check_scoped_uses(node->for_loop.init, scope);
+            walk_ast(node->for_loop.parallel, check_use, scope);
+            walk_ast(node->for_loop.condition, check_use, scope);
+            int after_init = scope->count;
+            check_scoped_uses(node->for_loop.body, scope);
+            scope->count = after_init;
+            walk_ast(node->for_loop.increment, check_use, scope);
+            scope->count = mark;
+            break;
+        }
+        default:
+            walk_ast(node, check_use, scope);
+            break;
+    }
+}
+
+// A function's body sees its caller's variables too. When every name it
+// uses is a parameter or was surely declared by the body before the use,
+// nothing of the caller is reachable from it, which is what allows tail
+// calls to it and memoizing it.
+static bool function_is_closed(ASTNode* def) {
+    NameScope scope = {NULL, 0, 0, true};
+    for (int i = 0; i < def->func_def.param_count; i++) {
+        scope_add(&scope, def->func_def.parameters[i]->var_decl.name);
+    }
+    
+    check_scoped_uses(def->func_def.body, &scope);
+    
+    free(scope.names);
+    return scope.closed;
+}
+
+// Builtins that only compute a value from their arguments
+static const char* pure_builtins[] = {"sin", "cos", "tan", "sigmoid", "sqrt", "pow", NULL};
+
+static bool is_pure_builtin(const char* name) {
+    for (int i = 0; pure_builtins[i]; i++) {
+        if (strcmp(pure_builtins[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+typedef struct {
+    InterpreterContext* ctx;
+    NameScope visited;    // functions checked so far, or being checked
+    bool pure;
+} PurityCheck;
+
+static bool check_function_purity(Function* func, PurityCheck* check);
+
+static void check_purity(ASTNode* node, void* data) {
+    PurityCheck* check = data;
+    if (!check->pure) {
+        return;
+    }
+    
+    switch (node->type) {
+        case AST_FUNCTION_CALL: {
+            const char* name = node->func_call.name;
+            if (find_builtin(check->ctx->runtime, name) || is_dmo_graphics_function(name)) {
+                check->pure = is_pure_builtin(name);
+            } else {
+                Function* callee = get_function(check->ctx, name);
+                check->pure = callee && check_function_purity(callee, check);
+            }
+            break;
+        }
+        case AST_SPAWN:
+        case AST_YIELD:
+        case AST_PARALLEL:
+        case AST_USE_STATEMENT:
+        case AST_MEMBER_ACCESS:
+            check->pure = false;
+            break;
+        default:
+            break;
+    }
+}
+
+static bool check_function_purity(Function* func, PurityCheck* check) {
+    if (scope_has(&check->visited, func->name)) {
+        return true;
+    }
+    if (!func->closed) {
+        return false;
+    }
+    
+    scope_add(&check->visited, func->name);
+    walk_ast(func->body, check_purity, check);
+    return check->pure;
+}
+
+// A function is pure when neither it nor anything it calls can read or
+// change state outside its own frame, print, or touch the graphics,
+// network or system: a closed body that calls only pure builtins and
+// other pure functions. Its result then depends on its arguments alone.
+static bool function_is_pure(Function* func, InterpreterContext* ctx) {
+    PurityCheck check = {ctx, {NULL, 0, 0, true}, true};
+    bool pure = check_function_purity(func, &check);
+    free(check.visited.names);
+    return pure;
+}
+
 Value execute_function_def(ASTNode* node, InterpreterContext* ctx) {
     Function* func = malloc(sizeof(Function));
     func->name = strdup(node->func_def.name);
@@ -289,6 +652,10 @@ Value execute_function_def(ASTNode* node, InterpreterContext* ctx) {
     func->parameters = node->func_def.parameters;
     func->param_count = node->func_def.param_count;
     func->body = node->func_def.body;
+    func->closed = function_is_closed(node);
+    func->generator = contains_yield(node->func_def.body);
+    func->pure = -1;
+    func->memo = NULL;
     
     set_function(ctx, func);
     
@@ -308,6 +675,17 @@ Value execute_variable_decl(ASTNode* node, InterpreterContext* ctx) {
             value = create_string_value("");
         } else if (strcmp(node->var_decl.type, "char") == 0) {
             value = create_string_value("");
+        } else if (strcmp(node->var_decl.type, "array") == 0) {
+            DMOArray* empty = array_create(ARRAY_F64, 0);
+            if (empty) {
+                value.type = VALUE_ARRAY;
+                value.array = empty;
+            }
+        } else if (strcmp(node->var_decl.type, "map") == 0) {
+            Value empty;
+            empty.type = VALUE_MAP;
+            empty.map = map_create();
+            value = empty;
         }
     }
     
@@ -321,30 +699,183 @@ Value execute_assignment(ASTNode* node, InterpreterContext* ctx) {
     
     if (node->assignment.target->type == AST_IDENTIFIER) {
         Variable* var = get_variable(ctx, node->assignment.target->identifier.value);
-        if (var) {
+        if (var && ctx->parent && !owns_variable(ctx, var)) {
+            // Other iterations may be running on other threads
+            fprintf(stderr, "Error: Cannot assign to shared variable '%s' in a parallel loop; use reduce(...)\n",
+                    node->assignment.target->identifier.value);
+        } else if (var) {
             free_value(var->value);
             var->value = copy_value(value);
         } else {
             fprintf(stderr, "Error: Undefined variable '%s'\n", node->assignment.target->identifier.value);
         }
+    } else if (node->assignment.target->type == AST_ARRAY_ACCESS) {
+        Value array = execute_node(node->assignment.target->array_access.array, ctx);
+        Value index = execute_node(node->assignment.target->array_access.index, ctx);
+        size_t slot;
+        
+        if (array.type != VALUE_ARRAY) {
+            fprintf(stderr, "Error: Indexed assignment target is not an array\n");
+        } else if (value.type != VALUE_NUMBER) {
+            fprintf(stderr, "Error: Array elements must be numbers\n");
+        } else if (array_check_index(array.array, index, &slot)) {
+            array_set(array.array, slot, value.number);
+        }
+        
+        free_value(array);
+        free_value(index);
     }
     
     return value;
 }
 
-Value execute_function_call(ASTNode* node, InterpreterContext* ctx) {
-    // Check for built-in functions first
-    Value result = call_builtin_function(node->func_call.name, node->func_call.arguments, 
-                                       node->func_call.arg_count, ctx);
+// Loop back-edges and calls are the steps a run's budget counts. Most
+// only count down the thread's batch; see take_steps.
+static bool count_step(InterpreterContext* ctx) {
+    return ctx->calls->steps_left-- > 0 || take_steps(ctx);
+}
+
+// Takes a step and the next frame of ctx's calls for a call of name. Once
+// the depth limit or a limit of the run is hit every caller returns at
+// once, and this returns NULL.
+static InterpreterContext* push_call(const char* name, InterpreterContext* ctx) {
+    DMOCallStack* calls = ctx->calls;
+    if (!count_step(ctx)) {
+        return NULL;
+    }
+    InterpreterContext* frame = calls->stopped ? NULL : push_frame(calls);
+    if (!frame) {
+        if (!calls->stopped) {
+            fprintf(stderr, "Error: Maximum call depth of %d exceeded calling '%s'\n",
+                    calls->max_depth, name);
+            calls->stopped = true;
+        }
+        ctx->has_return = true;
+    }
+    return frame;
+}
+
+// A frame for a call of func from ctx, NULL when push_call gave none
+static InterpreterContext* enter_function(Function* func, const char* name, InterpreterContext* ctx) {
+    InterpreterContext* func_ctx = push_call(name, ctx);
+    if (!func_ctx) {
+        return NULL;
+    }
+    
+    func_ctx->global_vars = ctx->variables;
+    func_ctx->global_funcs = visible_functions(ctx);
+    func_ctx->runtime = ctx->runtime;
+    func_ctx->worker = ctx->worker;
+    func_ctx->function = func;
+    return func_ctx;
+}
+
+// Runs the function of a frame made by enter_function and pops it
+static Value leave_function(InterpreterContext* func_ctx, InterpreterContext* ctx) {
+    DMOCallStack* calls = ctx->calls;
+    Value return_val = calls->stopped ? create_void_value()
+                                      : run_on_stack(calls, run_function_frame, func_ctx);
+    pop_frame(calls);
     
-    // Check if builtin function was actually called (not just returned void by default)
-    // For successful builtin calls that return void, we still want to return that result
-    if (result.type != VALUE_VOID || 
-        strcmp(node->func_call.name, "show.txt") == 0 ||
-        strcmp(node->func_call.name, "scanf") == 0 ||
-        strcmp(node->func_call.name, "fget") == 0 ||
-        is_dmo_graphics_function(node->func_call.name)) {
-        return result;
+    if (calls->stopped) {
+        ctx->has_return = true;
+    }
+    return return_val;
+}
+
+static Value run_frame_body(InterpreterContext* frame) {
+    return execute_node(frame->function->body, frame);
+}
+
+// Runs the body of a frame that outlives single calls, a generator's (see
+// dmo_generator.h), as a call from ctx: on ctx's thread and C stack, as a
+// step and one level of the depth limit. The frame pushed for that is left
+// empty.
+Value resume_frame(InterpreterContext* frame, InterpreterContext* ctx) {
+    DMOCallStack* calls = ctx->calls;
+    if (!push_call(frame->function->name, ctx)) {
+        return create_void_value();
+    }
+    
+    frame->runtime = ctx->runtime;
+    frame->worker = ctx->worker;
+    frame->calls = calls;
+    Value result = run_on_stack(calls, run_frame_body, frame);
+    pop_frame(calls);
+    
+    if (calls->stopped) {
+        ctx->has_return = true;
+    }
+    return result;
+}
+
+static pthread_mutex_t purity_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Purity is decided on the first call, when every function of the
+// program has been defined
+static bool memoized(Function* func, InterpreterContext* ctx) {
+    int pure = __atomic_load_n(&func->pure, __ATOMIC_ACQUIRE);
+    if (pure < 0) {
+        pthread_mutex_lock(&purity_lock);
+        if (func->pure < 0) {
+            bool is_pure = dmo_memoize && function_is_pure(func, ctx);
+            func->memo = is_pure ? memo_create(func->param_count) : NULL;
+            __atomic_store_n(&func->pure, is_pure ? 1 : 0, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&purity_lock);
+        pure = func->pure;
+    }
+    return pure && func->memo->enabled;
+}
+
+// A call of a pure function looks its arguments up in the function's
+// cache before running it
+static Value call_memoized(Function* func, ASTNode* node, InterpreterContext* ctx) {
+    int arg_count = func->param_count;
+    Value stack_args[BUILTIN_STACK_ARGS];
+    Value* args = arg_count > BUILTIN_STACK_ARGS ? malloc(sizeof(Value) * arg_count) : stack_args;
+    for (int i = 0; i < arg_count; i++) {
+        args[i] = execute_node(node->func_call.arguments[i], ctx);
+    }
+    
+    Value return_val;
+    bool cacheable = memo_cacheable(args, arg_count);
+    if (!cacheable || !memo_lookup(func->memo, args, &return_val)) {
+        InterpreterContext* func_ctx = enter_function(func, node->func_call.name, ctx);
+        if (func_ctx) {
+            for (int i = 0; i < arg_count; i++) {
+                ASTNode* param = func->parameters[i];
+                set_variable(func_ctx, param->var_decl.name, param->var_decl.type, args[i]);
+            }
+            return_val = leave_function(func_ctx, ctx);
+        } else {
+            return_val = create_void_value();
+        }
+        
+        if (cacheable && !ctx->calls->stopped) {
+            memo_store(func->memo, args, return_val);
+        }
+    }
+    
+    for (int i = 0; i < arg_count; i++) {
+        free_value(args[i]);
+    }
+    if (args != stack_args) {
+        free(args);
+    }
+    return return_val;
+}
+
+Value execute_function_call(ASTNode* node, InterpreterContext* ctx) {
+    // Builtins and extension functions come first, found with one hash lookup
+    const DMOBuiltin* builtin = find_builtin(ctx->runtime, node->func_call.name);
+    if (builtin) {
+        return invoke_builtin(builtin, node->func_call.name, node->func_call.arguments,
+                              node->func_call.arg_count, ctx);
+    }
+    if (is_dmo_graphics_function(node->func_call.name)) {
+        return call_dmo_graphics_function(node->func_call.name, node->func_call.arguments,
+                                          node->func_call.arg_count, ctx);
     }
     
     // Look for user-defined functions
@@ -354,10 +885,17 @@ Value execute_function_call(ASTNode* node, InterpreterContext* ctx) {
         return create_void_value();
     }
     
-    // Create new context for function execution
-    InterpreterContext* func_ctx = create_interpreter_context();
-    func_ctx->global_vars = ctx->variables;
-    func_ctx->global_funcs = ctx->functions;
+    if (func->generator) {
+        return create_generator(func, node, ctx);
+    }
+    if (node->func_call.arg_count >= func->param_count && memoized(func, ctx)) {
+        return call_memoized(func, node, ctx);
+    }
+    
+    InterpreterContext* func_ctx = enter_function(func, node->func_call.name, ctx);
+    if (!func_ctx) {
+        return create_void_value();
+    }
     
     // Bind parameters
     for (int i = 0; i < func->param_count && i < node->func_call.arg_count; i++) {
@@ -367,79 +905,248 @@ Value execute_function_call(ASTNode* node, InterpreterContext* ctx) {
         free_value(arg_value);
     }
     
-    // Execute function body
-    Value return_val = execute_node(func->body, func_ctx);
-    
-    if (func_ctx->has_return) {
+    return leave_function(func_ctx, ctx);
+}
+
+// Runs the body of frame->function. A call in tail position has already
+// rebound the frame to the callee, so the loop runs that body next instead
+// of recursing.
+Value run_function_frame(InterpreterContext* frame) {
+    while (true) {
+        Value return_val = execute_node(frame->function->body, frame);
+        
+        if (!frame->tail_call) {
+            if (frame->has_return) {
+                free_value(return_val);
+                return_val = frame->return_value;
+                frame->return_value = create_void_value();
+            }
+            return return_val;
+        }
+        
         free_value(return_val);
-        return_val = copy_value(func_ctx->return_value);
+        frame->tail_call = false;
+        frame->has_return = false;
+        if (!count_step(frame)) {
+            return create_void_value();
+        }
+    }
+}
+
+// `return f(...)` of a user function whose body only uses its own
+// parameters and variables. Those are all the callee can see, so the
+// current frame is emptied and rebound to it rather than a new one pushed.
+static bool execute_tail_call(ASTNode* call, InterpreterContext* ctx) {
+    const char* name = call->func_call.name;
+    if (!ctx->function || ctx->functions || ctx->generator || find_builtin(ctx->runtime, name) ||
+        is_dmo_graphics_function(name)) {
+        return false;
     }
     
-    free_interpreter_context(func_ctx);
-    return return_val;
+    // A generator function's call makes a generator instead of running
+    // the body, which execute_function_call does
+    Function* func = get_function(ctx, name);
+    if (!func || !func->closed || func->generator) {
+        return false;
+    }
+    
+    // Arguments are evaluated while the caller's variables still exist
+    int arg_count = func->param_count < call->func_call.arg_count ? func->param_count
+                                                                  : call->func_call.arg_count;
+    Value stack_args[BUILTIN_STACK_ARGS];
+    Value* args = arg_count > BUILTIN_STACK_ARGS ? malloc(sizeof(Value) * arg_count) : stack_args;
+    for (int i = 0; i < arg_count; i++) {
+        args[i] = execute_node(call->func_call.arguments[i], ctx);
+    }
+    
+    free_variables(ctx->variables);
+    ctx->variables = NULL;
+    for (int i = 0; i < arg_count; i++) {
+        ASTNode* param = func->parameters[i];
+        set_variable(ctx, param->var_decl.name, param->var_decl.type, args[i]);
+        free_value(args[i]);
+    }
+    if (args != stack_args) {
+        free(args);
+    }
+    
+    ctx->function = func;
+    ctx->tail_call = true;
+    ctx->has_return = true;
+    return true;
+}
+
+// && and || only evaluate the right operand when it can change the result
+Value execute_logical_op(ASTNode* node, InterpreterContext* ctx) {
+    bool left = execute_condition(node->binary_op.left, ctx);
+    
+    if (node->binary_op.operator == TOKEN_AND ? !left : left) {
+        return create_number_value(left ? 1 : 0);
+    }
+    
+    bool right = execute_condition(node->binary_op.right, ctx);
+    return create_number_value(right ? 1 : 0);
+}
+
+static double apply_number_op(TokenType operator, double left, double right) {
+    switch (operator) {
+        case TOKEN_PLUS:
+            return left + right;
+        case TOKEN_MINUS:
+            return left - right;
+        case TOKEN_MULTIPLY:
+            return left * right;
+        case TOKEN_DIVIDE:
+            if (right != 0) {
+                return left / right;
+            }
+            fprintf(stderr, "Error: Division by zero\n");
+            return 0;
+        case TOKEN_MODULO:
+            if (right != 0) {
+                return fmod(left, right);
+            }
+            fprintf(stderr, "Error: Modulo by zero\n");
+            return 0;
+        case TOKEN_EQUAL:
+            return left == right ? 1 : 0;
+        case TOKEN_NOT_EQUAL:
+            return left != right ? 1 : 0;
+        case TOKEN_LESS:
+            return left < right ? 1 : 0;
+        case TOKEN_GREATER:
+            return left > right ? 1 : 0;
+        case TOKEN_LESS_EQUAL:
+            return left <= right ? 1 : 0;
+        case TOKEN_GREATER_EQUAL:
+            return left >= right ? 1 : 0;
+        default:
+            fprintf(stderr, "Error: Unknown binary operator\n");
+            return 0;
+    }
+}
+
+// Evaluates an expression that check_types found to be a number without
+// building Values for its number-typed operands and variables. A call
+// that went past the depth limit still gives void, which sets *is_void
+// and, as in the generic path, makes the whole expression void.
+static double evaluate_number(ASTNode* node, InterpreterContext* ctx, bool* is_void) {
+    switch (node->type) {
+        case AST_NUMBER:
+            return node->number.value;
+        case AST_IDENTIFIER: {
+            Variable* var = get_variable(ctx, node->identifier.value);
+            if (var) {
+                return var->value.number;
+            }
+            break;
+        }
+        case AST_BINARY_OP:
+            if (node->binary_op.left->static_type == TYPE_NUMBER &&
+                node->binary_op.right->static_type == TYPE_NUMBER &&
+                node->binary_op.operator != TOKEN_AND && node->binary_op.operator != TOKEN_OR) {
+                double left = evaluate_number(node->binary_op.left, ctx, is_void);
+                double right = evaluate_number(node->binary_op.right, ctx, is_void);
+                return apply_number_op(node->binary_op.operator, left, right);
+            }
+            break;
+        default:
+            break;
+    }
+    
+    Value value = execute_node(node, ctx);
+    if (value.type != VALUE_NUMBER) {
+        free_value(value);
+        *is_void = true;
+        return 0;
+    }
+    return value.number;
+}
+
+// The string of an expression that check_types found to be a string. A
+// variable's string is borrowed when nothing evaluated after it can
+// change the variable; otherwise the value is kept in *owned. NULL for the
+// void of a call that went past the depth limit.
+static const char* evaluate_string(ASTNode* node, bool borrow, InterpreterContext* ctx, Value* owned) {
+    *owned = create_void_value();
+    if (borrow && node->type == AST_IDENTIFIER) {
+        Variable* var = get_variable(ctx, node->identifier.value);
+        if (var && var->value.type == VALUE_STRING) {
+            return var->value.string;
+        }
+    }
+    
+    *owned = execute_node(node, ctx);
+    return owned->type == VALUE_STRING ? owned->string : NULL;
+}
+
+static Value execute_string_op(ASTNode* node, InterpreterContext* ctx) {
+    ASTNode* right_node = node->binary_op.right;
+    bool borrow_left = right_node->type == AST_IDENTIFIER || right_node->type == AST_STRING;
+    Value left_value, right_value;
+    const char* left = evaluate_string(node->binary_op.left, borrow_left, ctx, &left_value);
+    const char* right = evaluate_string(right_node, true, ctx, &right_value);
+    
+    Value result;
+    if (!left || !right) {
+        result = create_void_value();
+    } else if (node->binary_op.operator == TOKEN_PLUS) {
+        size_t len1 = strlen(left);
+        size_t len2 = strlen(right);
+        if (!charge_alloc(ctx, len1 + len2 + 1)) {
+            free_value(left_value);
+            free_value(right_value);
+            return create_void_value();
+        }
+        result.type = VALUE_STRING;
+        result.string = malloc(len1 + len2 + 1);
+        memcpy(result.string, left, len1);
+        memcpy(result.string + len1, right, len2 + 1);
+    } else {
+        bool equal = strcmp(left, right) == 0;
+        result = create_number_value(equal == (node->binary_op.operator == TOKEN_EQUAL) ? 1 : 0);
+    }
+    
+    free_value(left_value);
+    free_value(right_value);
+    return result;
 }
 
 Value execute_binary_op(ASTNode* node, InterpreterContext* ctx) {
+    if (node->binary_op.operator == TOKEN_AND || node->binary_op.operator == TOKEN_OR) {
+        return execute_logical_op(node, ctx);
+    }
+    
+    // Operands whose types check_types proved need no tag checks
+    StaticType left_type = node->binary_op.left->static_type;
+    StaticType right_type = node->binary_op.right->static_type;
+    if (left_type == TYPE_NUMBER && right_type == TYPE_NUMBER) {
+        bool is_void = false;
+        double number = evaluate_number(node, ctx, &is_void);
+        return is_void ? create_void_value() : create_number_value(number);
+    }
+    if (left_type == TYPE_STRING && right_type == TYPE_STRING &&
+        (node->binary_op.operator == TOKEN_PLUS || node->binary_op.operator == TOKEN_EQUAL ||
+         node->binary_op.operator == TOKEN_NOT_EQUAL)) {
+        return execute_string_op(node, ctx);
+    }
+    
     Value left = execute_node(node->binary_op.left, ctx);
     Value right = execute_node(node->binary_op.right, ctx);
     
     Value result = create_void_value();
     
     if (left.type == VALUE_NUMBER && right.type == VALUE_NUMBER) {
-        switch (node->binary_op.operator) {
-            case TOKEN_PLUS:
-                result = create_number_value(left.number + right.number);
-                break;
-            case TOKEN_MINUS:
-                result = create_number_value(left.number - right.number);
-                break;
-            case TOKEN_MULTIPLY:
-                result = create_number_value(left.number * right.number);
-                break;
-            case TOKEN_DIVIDE:
-                if (right.number != 0) {
-                    result = create_number_value(left.number / right.number);
-                } else {
-                    fprintf(stderr, "Error: Division by zero\n");
-                    result = create_number_value(0);
-                }
-                break;
-            case TOKEN_MODULO:
-                if (right.number != 0) {
-                    result = create_number_value(fmod(left.number, right.number));
-                } else {
-                    fprintf(stderr, "Error: Modulo by zero\n");
-                    result = create_number_value(0);
-                }
-                break;
-            case TOKEN_EQUAL:
-                result = create_number_value(left.number == right.number ? 1 : 0);
-                break;
-            case TOKEN_NOT_EQUAL:
-                result = create_number_value(left.number != right.number ? 1 : 0);
-                break;
-            case TOKEN_LESS:
-                result = create_number_value(left.number < right.number ? 1 : 0);
-                break;
-            case TOKEN_GREATER:
-                result = create_number_value(left.number > right.number ? 1 : 0);
-                break;
-            case TOKEN_LESS_EQUAL:
-                result = create_number_value(left.number <= right.number ? 1 : 0);
-                break;
-            case TOKEN_GREATER_EQUAL:
-                result = create_number_value(left.number >= right.number ? 1 : 0);
-                break;
-            default:
-                fprintf(stderr, "Error: Unknown binary operator\n");
-                result = create_number_value(0);
-        }
+        result = create_number_value(apply_number_op(node->binary_op.operator, left.number, right.number));
     } else if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
         switch (node->binary_op.operator) {
             case TOKEN_PLUS: {
                 // String concatenation
                 int len1 = strlen(left.string);
                 int len2 = strlen(right.string);
+                if (!charge_alloc(ctx, len1 + len2 + 1)) {
+                    break;
+                }
                 char* concat = malloc(len1 + len2 + 1);
                 strcpy(concat, left.string);
                 strcat(concat, right.string);
@@ -489,17 +1196,61 @@ Value execute_member_access(ASTNode* node, InterpreterContext* ctx) {
     return create_void_value();
 }
 
+Value execute_array_access(ASTNode* node, InterpreterContext* ctx) {
+    // Index straight into a named array instead of taking a reference to it
+    Value array;
+    bool borrowed = false;
+    if (node->array_access.array->type == AST_IDENTIFIER) {
+        Variable* var = get_variable(ctx, node->array_access.array->identifier.value);
+        if (var) {
+            array = var->value;
+            borrowed = true;
+        } else {
+            array = execute_node(node->array_access.array, ctx);
+        }
+    } else {
+        array = execute_node(node->array_access.array, ctx);
+    }
+    
+    Value index = execute_node(node->array_access.index, ctx);
+    Value result = create_number_value(0);
+    size_t slot;
+    
+    if (array.type != VALUE_ARRAY) {
+        fprintf(stderr, "Error: Indexed value is not an array\n");
+    } else if (array_check_index(array.array, index, &slot)) {
+        result = create_number_value(array_get(array.array, slot));
+    }
+    
+    if (!borrowed) {
+        free_value(array);
+    }
+    free_value(index);
+    return result;
+}
+
 // Simplified implementations for control structures
-Value execute_if_statement(ASTNode* node, InterpreterContext* ctx) {
-    Value condition = execute_node(node->if_stmt.condition, ctx);
+// In a generator's body an if notes the branch a yield leaves, and a
+// resume goes back into that branch without evaluating the condition
+// again. Kept apart so the ordinary if still ends in a tail call.
+static Value execute_generator_if(ASTNode* node, InterpreterContext* ctx) {
+    int branch = resume_position(ctx->generator, node);
+    bool is_true = branch < 0 ? execute_condition(node->if_stmt.condition, ctx) : branch == 1;
     
-    bool is_true = false;
-    if (condition.type == VALUE_NUMBER) {
-        is_true = condition.number != 0;
-    } else if (condition.type == VALUE_STRING) {
-        is_true = strlen(condition.string) > 0;
+    Value result = execute_node(is_true ? node->if_stmt.then_stmt : node->if_stmt.else_stmt, ctx);
+    if (ctx->has_return) {
+        save_position(ctx->generator, node, is_true ? 1 : 2);
+    }
+    return result;
+}
+
+Value execute_if_statement(ASTNode* node, InterpreterContext* ctx) {
+    if (ctx->generator) {
+        return execute_generator_if(node, ctx);
     }
     
+    bool is_true = execute_condition(node->if_stmt.condition, ctx);
+    
     Value result = create_void_value();
     
     if (is_true) {
@@ -508,46 +1259,49 @@ Value execute_if_statement(ASTNode* node, InterpreterContext* ctx) {
         result = execute_node(node->if_stmt.else_stmt, ctx);
     }
     
-    free_value(condition);
     return result;
 }
 
 Value execute_while_loop(ASTNode* node, InterpreterContext* ctx) {
     Value result = create_void_value();
+    bool resumed = ctx->generator && resume_position(ctx->generator, node) >= 0;
     
     while (true) {
-        Value condition = execute_node(node->while_loop.condition, ctx);
-        
-        bool is_true = false;
-        if (condition.type == VALUE_NUMBER) {
-            is_true = condition.number != 0;
-        }
-        
-        free_value(condition);
-        
-        if (!is_true) {
+        if (!resumed && !execute_condition(node->while_loop.condition, ctx)) {
             break;
         }
+        resumed = false;
         
         free_value(result);
         result = execute_node(node->while_loop.body, ctx);
         
-        if (ctx->has_return) {
+        if (ctx->has_return || !count_step(ctx)) {
             break;
         }
     }
     
+    if (ctx->has_return && ctx->generator) {
+        save_position(ctx->generator, node, 0);
+    }
     return result;
 }
 
 Value execute_block(ASTNode* node, InterpreterContext* ctx) {
     Value result = create_void_value();
     
-    for (int i = 0; i < node->block.statement_count; i++) {
+    // A generator resuming starts again at the statement it yielded in
+    int first = ctx->generator ? resume_position(ctx->generator, node) : -1;
+    
+    // has_return may already be set when a call in the condition of an
+    // if hit the depth limit
+    for (int i = first < 0 ? 0 : first; i < node->block.statement_count && !ctx->has_return; i++) {
         free_value(result);
         result = execute_node(node->block.statements[i], ctx);
         
         if (ctx->has_return) {
+            if (ctx->generator) {
+                save_position(ctx->generator, node, i);
+            }
             break;
         }
     }
@@ -558,6 +1312,11 @@ Value execute_block(ASTNode* node, InterpreterContext* ctx) {
 Value execute_return_statement(ASTNode* node, InterpreterContext* ctx) {
     Value value = create_void_value();
     
+    ASTNode* returned = node->return_stmt.value;
+    if (returned && returned->type == AST_FUNCTION_CALL && execute_tail_call(returned, ctx)) {
+        return value;
+    }
+    
     if (node->return_stmt.value) {
         value = execute_node(node->return_stmt.value, ctx);
     }
@@ -572,48 +1331,163 @@ Value execute_return_statement(ASTNode* node, InterpreterContext* ctx) {
 // Additional execute functions for other node types would be implemented here
 // For brevity, I've included the main ones needed for basic functionality
 
-Value execute_for_loop(ASTNode* node, InterpreterContext* ctx) {
-    // Execute initialization
-    if (node->for_loop.init) {
-        Value init_result = execute_node(node->for_loop.init, ctx);
-        free_value(init_result);
-    }
-    
-    Value result = create_void_value();
-    
+// Where an ordinary loop starts: at the condition, at the increment when
+// a counted loop hands over, or in the body when a generator resumes there
+typedef enum {
+    LOOP_FROM_CONDITION,
+    LOOP_FROM_INCREMENT,
+    LOOP_FROM_BODY
+} LoopStart;
+
+// The ordinary loop: condition, body and increment are evaluated as
+// written
+static Value run_for_loop(ASTNode* node, InterpreterContext* ctx, Value result, LoopStart start) {
     while (true) {
+        // Execute increment
+        if (start == LOOP_FROM_INCREMENT && node->for_loop.increment) {
+            Value inc_result = execute_node(node->for_loop.increment, ctx);
+            free_value(inc_result);
+        }
+        
         // Check condition
-        if (node->for_loop.condition) {
-            Value condition = execute_node(node->for_loop.condition, ctx);
-            
-            bool is_true = false;
-            if (condition.type == VALUE_NUMBER) {
-                is_true = condition.number != 0;
-            }
-            
-            free_value(condition);
-            
-            if (!is_true) {
-                break;
-            }
+        if (start != LOOP_FROM_BODY && node->for_loop.condition &&
+            !execute_condition(node->for_loop.condition, ctx)) {
+            break;
         }
+        start = LOOP_FROM_INCREMENT;
         
         // Execute body
         free_value(result);
         result = execute_node(node->for_loop.body, ctx);
         
-        if (ctx->has_return) {
+        if (ctx->has_return || !count_step(ctx)) {
+            break;
+        }
+    }
+    
+    if (ctx->has_return && ctx->generator) {
+        save_position(ctx->generator, node, 0);
+    }
+    return result;
+}
+
+// The bound of a counted loop, false when it isn't a number, which makes
+// the condition void and ends the loop as in the ordinary one
+static bool loop_bound(ASTNode* bound, InterpreterContext* ctx, double* number) {
+    if (bound->static_type == TYPE_NUMBER) {
+        bool is_void = false;
+        *number = evaluate_number(bound, ctx, &is_void);
+        return !is_void;
+    }
+    
+    Value value = execute_node(bound, ctx);
+    bool valid = value.type == VALUE_NUMBER;
+    *number = valid ? value.number : 0;
+    free_value(value);
+    return valid;
+}
+
+// A loop marked by analyze_loops runs on a native counter: the loop
+// variable is looked up once, the bound is evaluated once when it is
+// invariant, and the variable is only kept current when the body may
+// look at it. Returns false, having run part of the loop, when the body
+// stored something other than a number in the variable; the rest then
+// runs as an ordinary loop.
+static bool run_counted_loop(ASTNode* node, InterpreterContext* ctx, Value* result) {
+    ASTNode* condition = node->for_loop.condition;
+    ASTNode* step_node = node->for_loop.increment->assignment.value;
+    TokenType compare = condition->binary_op.operator;
+    double step = step_node->binary_op.right->number.value;
+    if (step_node->binary_op.operator == TOKEN_MINUS) {
+        step = -step;
+    }
+    bool observed = node->for_loop.counted & COUNTED_OBSERVED;
+    bool invariant = node->for_loop.counted & COUNTED_BOUND_INVARIANT;
+    
+    // The declaration in the initializer put the variable in this context
+    Variable* var = get_variable(ctx, node->for_loop.init->var_decl.name);
+    double counter = var->value.number;
+    double bound = 0;
+    bool bounded = invariant && loop_bound(condition->binary_op.right, ctx, &bound);
+    
+    while (true) {
+        if (!invariant) {
+            bounded = loop_bound(condition->binary_op.right, ctx, &bound);
+        }
+        bool more;
+        switch (compare) {
+            case TOKEN_LESS: more = counter < bound; break;
+            case TOKEN_LESS_EQUAL: more = counter <= bound; break;
+            case TOKEN_GREATER: more = counter > bound; break;
+            default: more = counter >= bound; break;
+        }
+        if (!bounded || !more) {
             break;
         }
         
-        // Execute increment
-        if (node->for_loop.increment) {
-            Value inc_result = execute_node(node->for_loop.increment, ctx);
-            free_value(inc_result);
+        free_value(*result);
+        *result = execute_node(node->for_loop.body, ctx);
+        
+        // A tail call in the body has already freed the variable
+        if (ctx->has_return) {
+            if (!observed && !ctx->tail_call) {
+                var->value.number = counter;
+            }
+            if (ctx->generator) {
+                save_position(ctx->generator, node, 0);
+            }
+            return true;
+        }
+        
+        if (observed) {
+            if (var->value.type != VALUE_NUMBER) {
+                return false;
+            }
+            counter = var->value.number + step;
+            var->value.number = counter;
+        } else {
+            counter += step;
+        }
+        
+        if (!count_step(ctx)) {
+            break;
         }
     }
     
-    return result;
+    var->value.number = counter;
+    return true;
+}
+
+Value execute_for_loop(ASTNode* node, InterpreterContext* ctx) {
+    if (node->for_loop.parallel) {
+        return execute_parallel_for(node, ctx);
+    }
+    
+    // A generator resuming in the body skips the initialization, and a
+    // counted loop goes on from there as an ordinary one
+    if (ctx->generator && resume_position(ctx->generator, node) >= 0) {
+        return run_for_loop(node, ctx, create_void_value(), LOOP_FROM_BODY);
+    }
+    
+    // Execute initialization
+    if (node->for_loop.init) {
+        Value init_result = execute_node(node->for_loop.init, ctx);
+        free_value(init_result);
+    }
+    
+    Value result = create_void_value();
+    
+    if (node->for_loop.counted) {
+        Variable* var = get_variable(ctx, node->for_loop.init->var_decl.name);
+        if (var && var->value.type == VALUE_NUMBER) {
+            if (run_counted_loop(node, ctx, &result)) {
+                return result;
+            }
+            return run_for_loop(node, ctx, result, LOOP_FROM_INCREMENT);
+        }
+    }
+    
+    return run_for_loop(node, ctx, result, LOOP_FROM_CONDITION);
 }
 
 Value execute_unary_op(ASTNode* node, InterpreterContext* ctx) {
@@ -627,11 +1501,7 @@ Value execute_unary_op(ASTNode* node, InterpreterContext* ctx) {
             }
             break;
         case TOKEN_NOT:
-            if (operand.type == VALUE_NUMBER) {
-                result = create_number_value(operand.number == 0 ? 1 : 0);
-            } else if (operand.type == VALUE_STRING) {
-                result = create_number_value(strlen(operand.string) == 0 ? 1 : 0);
-            }
+            result = create_number_value(is_truthy(operand) ? 0 : 1);
             break;
         default:
             fprintf(stderr, "Error: Unknown unary operator\n");
@@ -0,0 +1,143 @@
+/*
+ * DMO Language Interpreter Header
+ * Executes the Abstract Syntax Tree
+ */
+
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "ast.h"
+#include "dmo_output.h"
+
+// Value types for runtime
+typedef enum {
+    VALUE_NUMBER,
+    VALUE_STRING,
+    VALUE_VOID,
+    VALUE_ARRAY,
+    VALUE_MAP
+} ValueType;
+
+// Typed array, defined in dmo_array.h
+typedef struct DMOArray DMOArray;
+
+// Hash map, defined in dmo_map.h
+typedef struct DMOMap DMOMap;
+
+// Per-interpreter state (output, modules, graphics), defined in dmo_runtime.h
+typedef struct DMORuntime DMORuntime;
+
+// Frames of user function calls, defined in dmo_stack.h
+typedef struct DMOCallStack DMOCallStack;
+
+// A suspended generator function, defined in dmo_generator.h
+typedef struct DMOGenerator DMOGenerator;
+
+// Runtime value
+typedef struct {
+    ValueType type;
+    union {
+        double number;
+        char* string;
+        DMOArray* array;
+        DMOMap* map;
+    };
+} Value;
+
+// Variable structure
+typedef struct Variable {
+    char* name;
+    char* type;
+    Value value;
+    struct Variable* next;
+} Variable;
+
+// Function structure
+typedef struct Function {
+    char* name;
+    char* return_type;
+    ASTNode** parameters;
+    int param_count;
+    ASTNode* body;
+    bool closed;            // uses no variables of its caller, so a tail call may drop the caller's frame
+    bool generator;         // its body yields, so a call returns a generator handle instead of running it
+    int pure;               // -1 until the first call, then whether its results can be memoized
+    struct MemoCache* memo; // results by argument values when pure, see dmo_memo.h
+    struct Function* next;
+} Function;
+
+// Interpreter context
+typedef struct InterpreterContext {
+    Variable* variables;
+    Function* functions;
+    Variable* global_vars;
+    Function* global_funcs;
+    bool has_return;
+    Value return_value;
+    DMORuntime* runtime;
+    struct InterpreterContext* parent;  // scope around a parallel loop body, read-only
+    int worker;                         // scheduler worker running this context
+    DMOCallStack* calls;                // frames of the thread of execution this context is part of
+    Function* function;                 // running in this context, NULL outside function bodies
+    bool tail_call;                     // the body returned by calling function again in this frame
+    DMOGenerator* generator;            // whose body runs in this frame, NULL unless it is a generator's
+} InterpreterContext;
+
+// Function prototypes
+int interpret(ASTNode* ast, const char* source_file);
+int interpret_with_runtime(ASTNode* ast, const char* source_file, DMORuntime* runtime);
+InterpreterContext* create_interpreter_context();
+void free_interpreter_context(InterpreterContext* ctx);
+void reset_interpreter_context(InterpreterContext* ctx);
+
+// The pieces of interpret_with_runtime, for callers that run a program in
+// steps (the REPL and --watch, see dmo_repl.h). create_program_context
+// defines the builtins and the runtime's globals, call_main calls main()
+// if the program defined one, and finish_program_context waits for
+// spawned tasks, frees ctx and returns the exit status.
+InterpreterContext* create_program_context(DMORuntime* runtime);
+void call_main(InterpreterContext* ctx);
+int finish_program_context(InterpreterContext* ctx);
+
+// Execution functions
+Value execute_node(ASTNode* node, InterpreterContext* ctx);
+Value execute_program(ASTNode* node, InterpreterContext* ctx);
+Value execute_function_def(ASTNode* node, InterpreterContext* ctx);
+Value execute_variable_decl(ASTNode* node, InterpreterContext* ctx);
+Value execute_assignment(ASTNode* node, InterpreterContext* ctx);
+Value execute_function_call(ASTNode* node, InterpreterContext* ctx);
+Value run_function_frame(InterpreterContext* frame);
+Value resume_frame(InterpreterContext* frame, InterpreterContext* ctx);
+Value execute_if_statement(ASTNode* node, InterpreterContext* ctx);
+Value execute_while_loop(ASTNode* node, InterpreterContext* ctx);
+Value execute_for_loop(ASTNode* node, InterpreterContext* ctx);
+Value execute_return_statement(ASTNode* node, InterpreterContext* ctx);
+Value execute_block(ASTNode* node, InterpreterContext* ctx);
+Value execute_binary_op(ASTNode* node, InterpreterContext* ctx);
+Value execute_logical_op(ASTNode* node, InterpreterContext* ctx);
+Value execute_unary_op(ASTNode* node, InterpreterContext* ctx);
+Value execute_identifier(ASTNode* node, InterpreterContext* ctx);
+Value execute_member_access(ASTNode* node, InterpreterContext* ctx);
+Value execute_array_access(ASTNode* node, InterpreterContext* ctx);
+
+// Variable management
+void set_variable(InterpreterContext* ctx, const char* name, const char* type, Value value);
+Variable* get_variable(InterpreterContext* ctx, const char* name);
+void set_function(InterpreterContext* ctx, Function* func);
+Function* get_function(InterpreterContext* ctx, const char* name);
+Function* visible_functions(InterpreterContext* ctx);
+
+// Value utilities
+Value create_number_value(double num);
+Value create_string_value(const char* str);
+Value create_void_value();
+void free_value(Value value);
+Value copy_value(Value value);
+void print_value(Value value, DMOOutput* out);
+bool is_truthy(Value value);
+bool execute_condition(ASTNode* node, InterpreterContext* ctx);
+
+// Built-in function execution
+Value call_builtin_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+#endif // INTERPRETER_H
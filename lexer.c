@@ -0,0 +1,396 @@
+/*
+ * DMO Language Lexer Implementation
+ * Converts source code into tokens
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Keywords mapping
+typedef struct {
+    const char* word;
+    int length;
+    TokenType type;
+} Keyword;
+
+// Perfect hash over (first char, last char, length); the shifts were chosen
+// offline so every keyword lands in its own slot of a 16 entry table.
+// Re-check for collisions when adding a keyword.
+#define KEYWORD_HASH(first, last, len) \
+    (((unsigned)(unsigned char)(first) + (((unsigned)(unsigned char)(last) + (unsigned)(len)) << 3)) & 15)
+
+static const Keyword keyword_table[16] = {
+    [1]  = {"int", 3, TOKEN_INT},
+    [2]  = {"return", 6, TOKEN_RETURN},
+    [3]  = {"char", 4, TOKEN_CHAR},
+    [5]  = {"use", 3, TOKEN_USE},
+    [6]  = {"void", 4, TOKEN_VOID},
+    [7]  = {"while", 5, TOKEN_WHILE},
+    [9]  = {"if", 2, TOKEN_IF},
+    [11] = {"string", 6, TOKEN_STRING_TYPE},
+    [13] = {"else", 4, TOKEN_ELSE},
+    [14] = {"for", 3, TOKEN_FOR},
+};
+
+TokenType lookup_keyword(const char* word, int length) {
+    if (length < 2 || length > 6) {
+        return TOKEN_IDENTIFIER;
+    }
+    
+    const Keyword* keyword = &keyword_table[KEYWORD_HASH(word[0], word[length - 1], length)];
+    if (keyword->length == length && memcmp(keyword->word, word, length) == 0) {
+        return keyword->type;
+    }
+    return TOKEN_IDENTIFIER;
+}
+
+bool is_keyword(const char* word) {
+    return lookup_keyword(word, (int)strlen(word)) != TOKEN_IDENTIFIER;
+}
+
+TokenType get_keyword_type(const char* word) {
+    return lookup_keyword(word, (int)strlen(word));
+}
+
+TokenList* create_token_list(size_t source_length) {
+    TokenList* list = malloc(sizeof(TokenList));
+    
+    // Typical sources average around 5 bytes per token
+    int capacity = 100;
+    if (source_length / 4 > (size_t)capacity && source_length / 4 < 0x10000000) {
+        capacity = (int)(source_length / 4);
+    }
+    
+    list->tokens = malloc(sizeof(Token) * capacity);
+    list->count = 0;
+    list->capacity = capacity;
+    return list;
+}
+
+static inline void add_token(TokenList* list, TokenType type, const char* start, int length, int line, int column) {
+    if (list->count >= list->capacity) {
+        list->capacity *= 2;
+        list->tokens = realloc(list->tokens, sizeof(Token) * list->capacity);
+    }
+    
+    Token* token = &list->tokens[list->count++];
+    token->type = type;
+    token->start = start;
+    token->length = length;
+    token->line = line;
+    token->column = column;
+}
+
+char* token_text(const Token* token) {
+    char* text = malloc(token->length + 1);
+    if (token->length > 0) {
+        memcpy(text, token->start, token->length);
+    }
+    text[token->length] = '\0';
+    return text;
+}
+
+double token_number(const Token* token) {
+    // The source buffer is not NUL terminated, so convert from a bounded copy
+    char small[64];
+    char* text = token->length < (int)sizeof(small) ? small : malloc(token->length + 1);
+    memcpy(text, token->start, token->length);
+    text[token->length] = '\0';
+    double value = strtod(text, NULL);
+    if (text != small) {
+        free(text);
+    }
+    return value;
+}
+
+static inline bool is_identifier_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+static inline bool is_blank_char(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Returns the end of the identifier run starting at pos
+static size_t scan_identifier(const char* source, size_t pos, size_t length) {
+#ifdef __SSE2__
+    // Range checks via the signed compare trick: x in [lo, hi] iff
+    // (x + 128 - lo) < (hi - lo + 1 - 128) as signed bytes
+    const __m128i lower_bias = _mm_set1_epi8((char)(128 - 'a'));
+    const __m128i lower_limit = _mm_set1_epi8((char)(-128 + 26));
+    const __m128i digit_bias = _mm_set1_epi8((char)(128 - '0'));
+    const __m128i digit_limit = _mm_set1_epi8((char)(-128 + 10));
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i underscore = _mm_set1_epi8('_');
+    
+    while (pos + 16 <= length) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(source + pos));
+        __m128i folded = _mm_or_si128(chunk, case_bit);
+        __m128i alpha = _mm_cmplt_epi8(_mm_add_epi8(folded, lower_bias), lower_limit);
+        __m128i digit = _mm_cmplt_epi8(_mm_add_epi8(chunk, digit_bias), digit_limit);
+        __m128i under = _mm_cmpeq_epi8(chunk, underscore);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+        
+        if (mask != 0xFFFF) {
+            return pos + __builtin_ctz(~mask);
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < length && is_identifier_char(source[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+// Returns the end of the run of non-newline whitespace starting at pos
+static size_t scan_blanks(const char* source, size_t pos, size_t length) {
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i ctrl_bias = _mm_set1_epi8((char)(128 - '\t'));
+    const __m128i ctrl_limit = _mm_set1_epi8((char)(-128 + 5));   // \t \n \v \f \r
+    const __m128i newline = _mm_set1_epi8('\n');
+    
+    while (pos + 16 <= length) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(source + pos));
+        __m128i ctrl = _mm_cmplt_epi8(_mm_add_epi8(chunk, ctrl_bias), ctrl_limit);
+        ctrl = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, newline), ctrl);
+        int mask = _mm_movemask_epi8(_mm_or_si128(ctrl, _mm_cmpeq_epi8(chunk, space)));
+        
+        if (mask != 0xFFFF) {
+            return pos + __builtin_ctz(~mask);
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < length && is_blank_char(source[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+// Scans a quoted literal; returns false if it is unterminated
+static bool read_string(const char* source, size_t* pos, size_t length, size_t* start, size_t* end) {
+    char quote = source[*pos];
+    (*pos)++; // Skip opening quote
+    
+    *start = *pos;
+    while (*pos < length && source[*pos] != quote) {
+        if (source[*pos] == '\\') {
+            (*pos)++; // Skip escape character
+        }
+        (*pos)++;
+    }
+    
+    if (*pos >= length) {
+        fprintf(stderr, "Error: Unterminated string literal\n");
+        *pos = length;
+        return false;
+    }
+    
+    *end = *pos;
+    (*pos)++; // Skip closing quote
+    return true;
+}
+
+static void read_number(const char* source, size_t* pos, size_t length) {
+    while (*pos < length && isdigit((unsigned char)source[*pos])) {
+        (*pos)++;
+    }
+    
+    // Handle decimal point
+    if (*pos < length && source[*pos] == '.') {
+        (*pos)++;
+        while (*pos < length && isdigit((unsigned char)source[*pos])) {
+            (*pos)++;
+        }
+    }
+}
+
+TokenList* tokenize(const char* source) {
+    return tokenize_buffer(source, strlen(source));
+}
+
+// Tokens are (start, length) views into source; nothing is copied
+TokenList* tokenize_buffer(const char* source, size_t length) {
+    TokenList* tokens = create_token_list(length);
+    size_t pos = 0;
+    size_t line_start = 0;
+    int line = 1;
+    
+    while (pos < length) {
+        char current = source[pos];
+        char next = pos + 1 < length ? source[pos + 1] : '\0';
+        int column = (int)(pos - line_start) + 1;
+        
+        // Skip whitespace
+        if (current == '\n') {
+            add_token(tokens, TOKEN_NEWLINE, source + pos, 0, line, column);
+            line++;
+            pos++;
+            line_start = pos;
+            continue;
+        }
+        if (is_blank_char(current)) {
+            pos = scan_blanks(source, pos + 1, length);
+            continue;
+        }
+        
+        // Skip comments
+        if (current == '/' && next == '/') {
+            const char* newline = memchr(source + pos, '\n', length - pos);
+            pos = newline ? (size_t)(newline - source) : length;
+            continue;
+        }
+        
+        // String literals
+        if (current == '"' || current == '\'') {
+            size_t start, end;
+            if (read_string(source, &pos, length, &start, &end)) {
+                add_token(tokens, TOKEN_STRING, source + start, (int)(end - start), line, column);
+            }
+            continue;
+        }
+        
+        // Numbers
+        if (isdigit((unsigned char)current)) {
+            size_t start = pos;
+            read_number(source, &pos, length);
+            add_token(tokens, TOKEN_NUMBER, source + start, (int)(pos - start), line, column);
+            continue;
+        }
+        
+        // Identifiers and keywords
+        if (isalpha((unsigned char)current) || current == '_') {
+            size_t start = pos;
+            pos = scan_identifier(source, pos + 1, length);
+            int word_length = (int)(pos - start);
+            TokenType type = lookup_keyword(source + start, word_length);
+            add_token(tokens, type, source + start, word_length, line, column);
+            continue;
+        }
+        
+        // Two-character operators
+        TokenType double_char_type = TOKEN_UNKNOWN;
+        if (current == '=' && next == '=') double_char_type = TOKEN_EQUAL;
+        else if (current == '!' && next == '=') double_char_type = TOKEN_NOT_EQUAL;
+        else if (current == '<' && next == '=') double_char_type = TOKEN_LESS_EQUAL;
+        else if (current == '>' && next == '=') double_char_type = TOKEN_GREATER_EQUAL;
+        else if (current == '&' && next == '&') double_char_type = TOKEN_AND;
+        else if (current == '|' && next == '|') double_char_type = TOKEN_OR;
+        
+        if (double_char_type != TOKEN_UNKNOWN) {
+            add_token(tokens, double_char_type, source + pos, 2, line, column);
+            pos += 2;
+            continue;
+        }
+        
+        // Single-character tokens
+        TokenType single_char_type = TOKEN_UNKNOWN;
+        switch (current) {
+            case '=': single_char_type = TOKEN_ASSIGN; break;
+            case '+': single_char_type = TOKEN_PLUS; break;
+            case '-': single_char_type = TOKEN_MINUS; break;
+            case '*': single_char_type = TOKEN_MULTIPLY; break;
+            case '/': single_char_type = TOKEN_DIVIDE; break;
+            case '%': single_char_type = TOKEN_MODULO; break;
+            case '<': single_char_type = TOKEN_LESS; break;
+            case '>': single_char_type = TOKEN_GREATER; break;
+            case '!': single_char_type = TOKEN_NOT; break;
+            case ';': single_char_type = TOKEN_SEMICOLON; break;
+            case ',': single_char_type = TOKEN_COMMA; break;
+            case '.': single_char_type = TOKEN_DOT; break;
+            case '(': single_char_type = TOKEN_LPAREN; break;
+            case ')': single_char_type = TOKEN_RPAREN; break;
+            case '{': single_char_type = TOKEN_LBRACE; break;
+            case '}': single_char_type = TOKEN_RBRACE; break;
+            case '[': single_char_type = TOKEN_LBRACKET; break;
+            case ']': single_char_type = TOKEN_RBRACKET; break;
+            case ':': single_char_type = TOKEN_COLON; break;
+        }
+        
+        add_token(tokens, single_char_type, source + pos, 1, line, column);
+        if (single_char_type == TOKEN_UNKNOWN) {
+            fprintf(stderr, "Warning: Unknown character '%c' at line %d, column %d\n", current, line, column);
+        }
+        
+        pos++;
+    }
+    
+    add_token(tokens, TOKEN_EOF, source + length, 0, line, (int)(length - line_start) + 1);
+    return tokens;
+}
+
+void free_token_list(TokenList* list) {
+    if (!list) return;
+    
+    // Token text lives in the source buffer
+    free(list->tokens);
+    free(list);
+}
+
+const char* token_type_to_string(TokenType type) {
+    switch (type) {
+        case TOKEN_NUMBER: return "NUMBER";
+        case TOKEN_STRING: return "STRING";
+        case TOKEN_IDENTIFIER: return "IDENTIFIER";
+        case TOKEN_USE: return "USE";
+        case TOKEN_INT: return "INT";
+        case TOKEN_STRING_TYPE: return "STRING_TYPE";
+        case TOKEN_CHAR: return "CHAR";
+        case TOKEN_IF: return "IF";
+        case TOKEN_ELSE: return "ELSE";
+        case TOKEN_WHILE: return "WHILE";
+        case TOKEN_FOR: return "FOR";
+        case TOKEN_RETURN: return "RETURN";
+        case TOKEN_VOID: return "VOID";
+        case TOKEN_ASSIGN: return "ASSIGN";
+        case TOKEN_PLUS: return "PLUS";
+        case TOKEN_MINUS: return "MINUS";
+        case TOKEN_MULTIPLY: return "MULTIPLY";
+        case TOKEN_DIVIDE: return "DIVIDE";
+        case TOKEN_EQUAL: return "EQUAL";
+        case TOKEN_NOT_EQUAL: return "NOT_EQUAL";
+        case TOKEN_LESS: return "LESS";
+        case TOKEN_GREATER: return "GREATER";
+        case TOKEN_LESS_EQUAL: return "LESS_EQUAL";
+        case TOKEN_GREATER_EQUAL: return "GREATER_EQUAL";
+        case TOKEN_AND: return "AND";
+        case TOKEN_OR: return "OR";
+        case TOKEN_NOT: return "NOT";
+        case TOKEN_SEMICOLON: return "SEMICOLON";
+        case TOKEN_COMMA: return "COMMA";
+        case TOKEN_DOT: return "DOT";
+        case TOKEN_LPAREN: return "LPAREN";
+        case TOKEN_RPAREN: return "RPAREN";
+        case TOKEN_LBRACE: return "LBRACE";
+        case TOKEN_RBRACE: return "RBRACE";
+        case TOKEN_LBRACKET: return "LBRACKET";
+        case TOKEN_RBRACKET: return "RBRACKET";
+        case TOKEN_COLON: return "COLON";
+        case TOKEN_EOF: return "EOF";
+        case TOKEN_NEWLINE: return "NEWLINE";
+        case TOKEN_UNKNOWN: return "UNKNOWN";
+        default: return "INVALID";
+    }
+}
+
+void print_tokens(TokenList* tokens) {
+    printf("=== TOKENS ===\n");
+    for (int i = 0; i < tokens->count; i++) {
+        Token* token = &tokens->tokens[i];
+        printf("Line %d, Col %d: %s", token->line, token->column, token_type_to_string(token->type));
+        if (token->length > 0) {
+            printf(" (%.*s)", token->length, token->start);
+        }
+        printf("\n");
+    }
+    printf("=== END TOKENS ===\n");
+}
@@ -0,0 +1,95 @@
+/*
+ * DMO Language Lexer Header
+ * Defines tokens and lexical analysis functions
+ */
+
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Token types for DMO language
+typedef enum {
+    // Literals
+    TOKEN_NUMBER,
+    TOKEN_STRING,
+    TOKEN_IDENTIFIER,
+    
+    // Keywords
+    TOKEN_USE,          // use keyword for imports
+    TOKEN_INT,          // int type
+    TOKEN_STRING_TYPE,  // string type
+    TOKEN_CHAR,         // char type
+    TOKEN_IF,           // if statement
+    TOKEN_ELSE,         // else statement
+    TOKEN_WHILE,        // while loop
+    TOKEN_FOR,          // for loop
+    TOKEN_RETURN,       // return statement
+    TOKEN_VOID,         // void type
+    
+    // Operators
+    TOKEN_ASSIGN,       // =
+    TOKEN_PLUS,         // +
+    TOKEN_MINUS,        // -
+    TOKEN_MULTIPLY,     // *
+    TOKEN_DIVIDE,       // /
+    TOKEN_MODULO,       // %
+    TOKEN_EQUAL,        // ==
+    TOKEN_NOT_EQUAL,    // !=
+    TOKEN_LESS,         // <
+    TOKEN_GREATER,      // >
+    TOKEN_LESS_EQUAL,   // <=
+    TOKEN_GREATER_EQUAL,// >=
+    TOKEN_AND,          // &&
+    TOKEN_OR,           // ||
+    TOKEN_NOT,          // !
+    
+    // Punctuation
+    TOKEN_SEMICOLON,    // ;
+    TOKEN_COMMA,        // ,
+    TOKEN_DOT,          // .
+    TOKEN_LPAREN,       // (
+    TOKEN_RPAREN,       // )
+    TOKEN_LBRACE,       // {
+    TOKEN_RBRACE,       // }
+    TOKEN_LBRACKET,     // [
+    TOKEN_RBRACKET,     // ]
+    TOKEN_COLON,        // :
+    
+    // Special
+    TOKEN_EOF,          // End of file
+    TOKEN_NEWLINE,      // Newline
+    TOKEN_UNKNOWN       // Unknown token
+} TokenType;
+
+// Token structure. The text is a view into the source buffer, which must
+// outlive the token list; use token_text() for an owned copy.
+typedef struct {
+    TokenType type;
+    int length;
+    const char* start;
+    int line;
+    int column;
+} Token;
+
+// Token list structure
+typedef struct {
+    Token* tokens;
+    int count;
+    int capacity;
+} TokenList;
+
+// Function prototypes
+TokenList* tokenize(const char* source);
+TokenList* tokenize_buffer(const char* source, size_t length);
+void free_token_list(TokenList* list);
+const char* token_type_to_string(TokenType type);
+void print_tokens(TokenList* tokens);
+char* token_text(const Token* token);
+double token_number(const Token* token);
+bool is_keyword(const char* word);
+TokenType get_keyword_type(const char* word);
+TokenType lookup_keyword(const char* word, int length);
+
+#endif // LEXER_H
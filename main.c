@@ -0,0 +1,572 @@
+/*
+ * Diamond Programming Language Compiler/Interpreter
+ * Main entry point for the Diamond language compiler
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "lexer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "modules.h"
+#include "dmo_cache.h"
+#include "dmo_output.h"
+#include "dmo_embed.h"
+#include "dmo_source.h"
+#include "dmo_runtime.h"
+#include "dmo_batch.h"
+#include "dmo_stack.h"
+#include "dmo_memo.h"
+#include "dmo_repl.h"
+#include "dmo_limits.h"
+#include "dmo_file.h"
+#ifndef _WIN32
+#include <errno.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+void print_usage(const char* program_name) {
+    printf("Usage: %s [-v | -vv] [--bench N | --startup-benchmark N] [--max-depth N] [limits] [--no-memo] [--types | --watch] <source_file.dmo>\n", program_name);
+    printf("       %s [-v | -vv] --repl\n", program_name);
+    printf("       %s --line-benchmark N <file>\n", program_name);
+    printf("       %s --lex-benchmark N <file>\n", program_name);
+    printf("       %s --parallel-benchmark N <source_file.dmo>\n", program_name);
+    printf("       %s [-v | -vv] [--jobs N] [limits] --batch <directory | list file>\n", program_name);
+    printf("Diamond Programming Language Compiler/Interpreter\n");
+    printf("Supports C#-like syntax with built-in graphics library\n");
+    printf("\n");
+    printf("  -v    Show phase and module messages on stderr\n");
+    printf("  -vv   Also show per-call runtime messages (or DMO_VERBOSE=1 or 2)\n");
+    printf("  --bench N  Run the program N times through the embedding API and report executions/s\n");
+    printf("  --startup-benchmark N  Start the interpreter on the script N times and report the\n"
+           "             time from exec to its first output and to its exit\n");
+    printf("  --line-benchmark N  Count the lines of a file N times as file.count_lines and\n"
+           "             file.read_line scan it, and with wc -l, and report GB/s\n");
+    printf("  --lex-benchmark N  Tokenize a file N times and report tokens/s and MB/s\n");
+    printf("  --parallel-benchmark N  Time the script on 1, 2, 4 ... N workers and report the\n"
+           "             speedup of its parallel loops and tasks over one worker\n");
+    printf("  --batch    Run many scripts in parallel, writing each one's output to a .out file;\n"
+           "             identical sources are parsed once, and a throughput and latency\n"
+           "             summary is printed at the end\n");
+    printf("  --jobs N   Worker threads for --batch (default: DMO_JOBS or one per core)\n");
+    printf("  --max-depth N  Deepest nesting of function calls (default: DMO_MAX_DEPTH or %d)\n",
+           DMO_DEFAULT_MAX_DEPTH);
+    printf("\n");
+    printf("Limits of each run, which is stopped with a report when it reaches one:\n");
+    printf("  --max-steps N    Loop iterations and function calls (or DMO_MAX_STEPS)\n");
+    printf("  --max-seconds S  Wall time (or DMO_MAX_SECONDS)\n");
+    printf("  --max-alloc N    Bytes allocated for strings, arrays and maps (or DMO_MAX_ALLOC)\n");
+    printf("  --max-output N   Bytes printed or written to files (or DMO_MAX_OUTPUT)\n");
+    printf("\n");
+    printf("  --no-memo  Don't cache the results of pure functions (or DMO_MEMO=0)\n");
+    printf("  --types    Print the AST with the static type of each expression instead of running\n");
+    printf("  --watch    Run the script again each time it is saved, parsing only what changed\n");
+    printf("  --repl     Run statements from stdin as they are typed, keeping variables and functions;\n"
+           "             a block continues until its braces close, and an expression on one\n"
+           "             line may leave out its ;\n");
+}
+
+// Times the embedding API on one script: a single compile, then runs on
+// one warm runtime, and for comparison on a fresh runtime per run
+int run_benchmark(const SourceBuffer* source, int runs) {
+    double start = now_seconds();
+    DMOProgram* program = dmo_compile(source->data, source->length);
+    if (!program) {
+        fprintf(stderr, "Parsing failed\n");
+        return 1;
+    }
+    double compile_time = now_seconds() - start;
+    
+    DMORuntime* runtime = dmo_open();
+    size_t output_length = 0;
+    start = now_seconds();
+    for (int i = 0; i < runs; i++) {
+        dmo_run(runtime, program);
+        dmo_get_output(runtime, &output_length);
+        dmo_reset(runtime);
+    }
+    double warm_time = now_seconds() - start;
+    dmo_close(runtime);
+    
+    start = now_seconds();
+    for (int i = 0; i < runs; i++) {
+        runtime = dmo_open();
+        dmo_run(runtime, program);
+        dmo_close(runtime);
+    }
+    double fresh_time = now_seconds() - start;
+    
+    dmo_free_program(program);
+    
+    printf("Compile:        %.3f ms\n", compile_time * 1e3);
+    printf("Warm runtime:   %d runs in %.3f s, %.0f executions/s\n",
+           runs, warm_time, runs / warm_time);
+    printf("Fresh runtime:  %d runs in %.3f s, %.0f executions/s\n",
+           runs, fresh_time, runs / fresh_time);
+    printf("Output per run: %zu bytes\n", output_length);
+    return 0;
+}
+
+#ifndef _WIN32
+// Starts program on source_file (or with no arguments, which prints the
+// usage) with stdout on a pipe, and measures from the spawn to the first
+// byte read and to the exit. False if the child can't be started or fails.
+static bool time_startup(const char* program, const char* source_file,
+                         double* first_output, double* exit_time) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+    char* child_argv[] = {(char*)program, (char*)source_file, NULL};
+    
+    double start = now_seconds();
+    pid_t pid;
+    int error = posix_spawnp(&pid, program, &actions, NULL, child_argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (error != 0) {
+        close(fds[0]);
+        return false;
+    }
+    
+    *first_output = -1;
+    char buffer[4096];
+    for (;;) {
+        ssize_t count = read(fds[0], buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        if (*first_output < 0) {
+            *first_output = now_seconds() - start;
+        }
+    }
+    close(fds[0]);
+    
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    *exit_time = now_seconds() - start;
+    if (*first_output < 0) {
+        *first_output = *exit_time;
+    }
+    return !source_file || (WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+static int compare_times(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_startup_times(const char* label, double* times, int runs) {
+    qsort(times, runs, sizeof(double), compare_times);
+    printf("  %-26s min %.3f ms, median %.3f ms\n", label, times[0] * 1e3, times[runs / 2] * 1e3);
+}
+
+// Runs wc -l on path with stdout on a pipe and reads back its count
+static bool time_wc(const char* path, double* seconds, long long* lines) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+    char* child_argv[] = {"wc", "-l", (char*)path, NULL};
+    
+    double start = now_seconds();
+    pid_t pid;
+    int error = posix_spawnp(&pid, "wc", &actions, NULL, child_argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (error != 0) {
+        close(fds[0]);
+        return false;
+    }
+    
+    char buffer[256];
+    size_t length = 0;
+    for (;;) {
+        ssize_t count = read(fds[0], buffer + length, sizeof(buffer) - 1 - length);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        length += count;
+    }
+    close(fds[0]);
+    buffer[length] = '\0';
+    
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    *seconds = now_seconds() - start;
+    *lines = atoll(buffer);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
+
+static void print_line_rate(const char* label, long long lines, double seconds, size_t bytes) {
+    printf("  %-18s %lld lines in %.2f ms, %.2f GB/s\n", label, lines, seconds * 1e3, bytes / seconds / 1e9);
+}
+
+// Times a script on fresh runtimes with 1, 2, 4 ... max_jobs workers, best
+// of three runs each. Every run must print what the 1-worker run printed.
+int run_parallel_benchmark(const SourceBuffer* source, int max_jobs) {
+    DMOProgram* program = dmo_compile(source->data, source->length);
+    if (!program) {
+        fprintf(stderr, "Parsing failed\n");
+        return 1;
+    }
+    
+    char* expected = NULL;
+    double single = 0;
+    int status = 0;
+    printf("Workers  Best of 3   Speedup\n");
+    for (int jobs = 1; status == 0; jobs = jobs * 2 < max_jobs ? jobs * 2 : max_jobs) {
+        DMORuntime* runtime = dmo_open();
+        dmo_set_jobs(runtime, jobs);
+        double best = 0;
+        for (int i = 0; i < 3 && status == 0; i++) {
+            double start = now_seconds();
+            status = dmo_run(runtime, program);
+            double elapsed = now_seconds() - start;
+            if (i == 0 || elapsed < best) {
+                best = elapsed;
+            }
+            
+            size_t length;
+            const char* output = dmo_get_output(runtime, &length);
+            if (!expected) {
+                expected = strdup(output);
+            } else if (strcmp(output, expected) != 0) {
+                fprintf(stderr, "Error: Output with %d workers differs from the output with 1\n", jobs);
+                status = 1;
+            }
+            dmo_reset(runtime);
+        }
+        dmo_close(runtime);
+        
+        if (jobs == 1) {
+            single = best;
+        }
+        printf("  %3d    %7.3f s   %5.2fx\n", jobs, best, single / best);
+        if (jobs == max_jobs) {
+            break;
+        }
+    }
+    
+    free(expected);
+    dmo_free_program(program);
+    return status;
+}
+
+// Counting lines is what log scripts do most, and the scanners behind
+// file.count_lines and file.read_line should keep up with wc -l. Each
+// timing is the best of runs, so the file is in the page cache.
+int run_line_benchmark(const char* path, int runs) {
+    SourceBuffer source;
+    if (!load_source(path, &source)) {
+        return 1;
+    }
+    
+    double best_count = 0;
+    double best_scan = 0;
+    long long counted = 0;
+    long long scanned = 0;
+    for (int i = 0; i < runs; i++) {
+        double start = now_seconds();
+        counted = count_file_lines(path);
+        double elapsed = now_seconds() - start;
+        if (i == 0 || elapsed < best_count) {
+            best_count = elapsed;
+        }
+        
+        // Line by line, as file.read_line finds them in a mapped file
+        start = now_seconds();
+        scanned = 0;
+        const char* end = source.data + source.length;
+        for (const char* p = source.data; (p = find_newline(p, end - p)); p++) {
+            scanned++;
+        }
+        elapsed = now_seconds() - start;
+        if (i == 0 || elapsed < best_scan) {
+            best_scan = elapsed;
+        }
+    }
+    
+    printf("Lines of %s, %zu bytes, best of %d runs:\n", path, source.length, runs);
+    print_line_rate("file.count_lines", counted, best_count, source.length);
+    print_line_rate("line by line", scanned, best_scan, source.length);
+    
+    int status = 0;
+#ifndef _WIN32
+    double best_wc = 0;
+    long long wc_lines = 0;
+    for (int i = 0; i < runs && status == 0; i++) {
+        double elapsed;
+        if (!time_wc(path, &elapsed, &wc_lines)) {
+            fprintf(stderr, "Error: Running wc -l %s failed\n", path);
+            status = 1;
+        } else if (i == 0 || elapsed < best_wc) {
+            best_wc = elapsed;
+        }
+    }
+    if (status == 0) {
+        print_line_rate("wc -l", wc_lines, best_wc, source.length);
+        if (wc_lines != counted || wc_lines != scanned) {
+            fprintf(stderr, "Error: Line counts differ from wc -l\n");
+            status = 1;
+        }
+    }
+#endif
+    
+    release_source(&source);
+    return status;
+}
+
+// Times tokenize_buffer alone on the mapped source, best of runs, so the
+// numbers are those of the scanner and not of reading the file
+int run_lex_benchmark(const char* path, int runs) {
+    SourceBuffer source;
+    if (!load_source(path, &source)) {
+        return 1;
+    }
+    
+    double best = 0;
+    int token_count = 0;
+    for (int i = 0; i < runs; i++) {
+        double start = now_seconds();
+        TokenList* tokens = tokenize_buffer(source.data, source.length);
+        double elapsed = now_seconds() - start;
+        token_count = tokens->count;
+        free_token_list(tokens);
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    
+    printf("Tokens of %s, %zu bytes, best of %d runs:\n", path, source.length, runs);
+    printf("  %d tokens in %.2f ms, %.1f M tokens/s, %.0f MB/s\n",
+           token_count, best * 1e3, token_count / best / 1e6, source.length / best / 1e6);
+    
+    release_source(&source);
+    return 0;
+}
+
+// Measures what a user waits for when running a short script: process
+// start, loading the interpreter, compiling, and running up to the first
+// line of output. Starting the interpreter without a script is measured as
+// well, the part of startup that doesn't depend on the script.
+int run_startup_benchmark(const char* program, const char* source_file, int runs) {
+#ifdef _WIN32
+    (void)program;
+    (void)source_file;
+    (void)runs;
+    fprintf(stderr, "Error: --startup-benchmark is not available on Windows\n");
+    return 1;
+#else
+    double* first_output = malloc(sizeof(double) * runs);
+    double* exit_time = malloc(sizeof(double) * runs);
+    double* bare_output = malloc(sizeof(double) * runs);
+    double* bare_exit = malloc(sizeof(double) * runs);
+    
+    int status = 0;
+    for (int i = 0; i < runs && status == 0; i++) {
+        if (!time_startup(program, source_file, &first_output[i], &exit_time[i])) {
+            fprintf(stderr, "Error: Running %s %s failed\n", program, source_file);
+            status = 1;
+        }
+        time_startup(program, NULL, &bare_output[i], &bare_exit[i]);
+    }
+    
+    if (status == 0) {
+        printf("Startup of %s, %d runs, stdout on a pipe:\n", source_file, runs);
+        print_startup_times("exec to first output", first_output, runs);
+        print_startup_times("exec to exit", exit_time, runs);
+        print_startup_times("no script, first output", bare_output, runs);
+        print_startup_times("no script, exit", bare_exit, runs);
+    }
+    
+    free(first_output);
+    free(exit_time);
+    free(bare_output);
+    free(bare_exit);
+    return status;
+#endif
+}
+
+int main(int argc, char* argv[]) {
+    const char* verbose = getenv("DMO_VERBOSE");
+    if (verbose) {
+        dmo_verbosity = atoi(verbose);
+    }
+    const char* max_depth = getenv("DMO_MAX_DEPTH");
+    if (max_depth && atoi(max_depth) > 0) {
+        dmo_max_depth = atoi(max_depth);
+    }
+    limits_from_env();
+    const char* memo = getenv("DMO_MEMO");
+    if (memo && strcmp(memo, "0") == 0) {
+        dmo_memoize = false;
+    }
+    
+    const char* source_file = NULL;
+    const char* batch_target = NULL;
+    int bench_runs = 0;
+    int startup_runs = 0;
+    int line_runs = 0;
+    int lex_runs = 0;
+    int parallel_jobs = 0;
+    bool print_types = false;
+    bool watch = false;
+    bool repl = false;
+    int jobs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            bench_runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--startup-benchmark") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            startup_runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--line-benchmark") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            line_runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lex-benchmark") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            lex_runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--parallel-benchmark") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            parallel_jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_target = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            dmo_max_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc && atoll(argv[i + 1]) > 0) {
+            dmo_limits.steps = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--max-seconds") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            dmo_limits.seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-alloc") == 0 && i + 1 < argc && atoll(argv[i + 1]) > 0) {
+            dmo_limits.alloc = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--max-output") == 0 && i + 1 < argc && atoll(argv[i + 1]) > 0) {
+            dmo_limits.output = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--types") == 0) {
+            print_types = true;
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watch = true;
+        } else if (strcmp(argv[i], "--repl") == 0) {
+            repl = true;
+        } else if (strcmp(argv[i], "--no-memo") == 0) {
+            dmo_memoize = false;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            dmo_verbosity = DMO_LOG_INFO;
+        } else if (strcmp(argv[i], "-vv") == 0) {
+            dmo_verbosity = DMO_LOG_DEBUG;
+        } else if (!source_file && argv[i][0] != '-') {
+            source_file = argv[i];
+        } else {
+            source_file = NULL;
+            break;
+        }
+    }
+    
+    if (batch_target && !source_file) {
+        return run_batch(batch_target, jobs > 0 ? jobs : scheduler_default_workers());
+    }
+    
+    if (repl && !source_file) {
+        return run_repl();
+    }
+    
+    if (!source_file) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    // Any file will do, it is only counted
+    if (line_runs > 0) {
+        return run_line_benchmark(source_file, line_runs);
+    }
+    if (lex_runs > 0) {
+        return run_lex_benchmark(source_file, lex_runs);
+    }
+    
+    // Check file extension
+    const char* ext = strrchr(source_file, '.');
+    if (!ext || strcmp(ext, ".dmo") != 0) {
+        fprintf(stderr, "Error: File must have .dmo extension\n");
+        return 1;
+    }
+    
+    if (startup_runs > 0) {
+        return run_startup_benchmark(argv[0], source_file, startup_runs);
+    }
+    
+    if (watch) {
+        return run_watch(source_file);
+    }
+    
+    // Read source file
+    SourceBuffer source;
+    if (!load_source(source_file, &source)) {
+        return 1;
+    }
+    
+    if (bench_runs > 0) {
+        int status = run_benchmark(&source, bench_runs);
+        release_source(&source);
+        return status;
+    }
+    if (parallel_jobs > 0) {
+        int status = run_parallel_benchmark(&source, parallel_jobs);
+        release_source(&source);
+        return status;
+    }
+    
+    dmo_log(DMO_LOG_INFO, "Diamond Compiler - Compiling '%s'\n", source_file);
+    
+    ASTNode* ast = build_program(source_file, &source);
+    release_source(&source);
+    if (!ast) {
+        return 1;
+    }
+    
+    if (print_types) {
+        print_ast(ast, 0);
+        free_ast(ast);
+        return 0;
+    }
+    
+    // Interpretation/Execution
+    dmo_log(DMO_LOG_INFO, "Phase 3: Execution...\n");
+    int result = interpret(ast, source_file);
+    
+    // Cleanup
+    free_ast(ast);
+    
+    if (result == 0) {
+        dmo_log(DMO_LOG_INFO, "Program executed successfully\n");
+    } else {
+        fprintf(stderr, "Program execution failed with code %d\n", result);
+    }
+    
+    return result;
+}
@@ -0,0 +1,618 @@
+/*
+ * DMO Language Module System Implementation
+ * Handles dynamic loading of modules (stdlib, dmo_graphs, request)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "modules.h"
+#include "stdlib_funcs.h"
+#include "dmo_graphs.h"
+#include "dmo_output.h"
+#include "dmo_runtime.h"
+#include "dmo_http.h"
+#include "dmo_builtins.h"
+#include "dmo_array.h"
+#include "dmo_vecmath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+void init_modules(InterpreterContext* ctx) {
+    // Modules are loaded on demand
+    dmo_log(DMO_LOG_INFO, "Module system initialized\n");
+}
+
+void init_module_system(ModuleSystem* system) {
+    // Initialize the module registry of one runtime
+    system->loaded_modules = NULL;
+    system->search_paths = NULL;
+    system->path_count = 0;
+    
+    const char* dmo_path = getenv("DMO_PATH");
+    if (dmo_path) {
+        char* paths = strdup(dmo_path);
+        char* dir = paths;
+        while (dir) {
+            char* colon = strchr(dir, ':');
+            if (colon) {
+                *colon = '\0';
+            }
+            if (*dir) {
+                add_search_path(system, dir);
+            }
+            dir = colon ? colon + 1 : NULL;
+        }
+        free(paths);
+    }
+    add_search_path(system, ".");
+    add_search_path(system, "extensions");
+    dmo_log(DMO_LOG_INFO, "Module system initialized\n");
+}
+
+void cleanup_module_system(ModuleSystem* system) {
+    // Clean up the module registry
+    Module* module = system->loaded_modules;
+    while (module) {
+        Module* next = module->next;
+#ifndef _WIN32
+        if (module->handle) {
+            dlclose(module->handle);
+        }
+#endif
+        free(module->name);
+        free(module->path);
+        free(module);
+        module = next;
+    }
+    system->loaded_modules = NULL;
+    
+    for (int i = 0; i < system->path_count; i++) {
+        free(system->search_paths[i]);
+    }
+    free(system->search_paths);
+    system->search_paths = NULL;
+    system->path_count = 0;
+    dmo_log(DMO_LOG_INFO, "Module system cleaned up\n");
+}
+
+bool is_module_loaded(ModuleSystem* system, const char* module_name) {
+    for (Module* module = system->loaded_modules; module; module = module->next) {
+        if (strcmp(module->name, module_name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Module* mark_module_loaded(ModuleSystem* system, const char* module_name, const char* path) {
+    Module* module = malloc(sizeof(Module));
+    module->name = strdup(module_name);
+    module->path = path ? strdup(path) : NULL;
+    module->handle = NULL;
+    module->loaded = true;
+    module->next = system->loaded_modules;
+    system->loaded_modules = module;
+    return module;
+}
+
+void add_search_path(ModuleSystem* system, const char* path) {
+    system->search_paths = realloc(system->search_paths, (system->path_count + 1) * sizeof(char*));
+    system->search_paths[system->path_count++] = strdup(path);
+}
+
+// Path of the first <module>.so on the search path, malloc'd, or NULL
+char* find_module_file(ModuleSystem* system, const char* module_name) {
+#ifdef _WIN32
+    (void)system;
+    (void)module_name;
+    return NULL;
+#else
+    for (int i = 0; i < system->path_count; i++) {
+        size_t length = strlen(system->search_paths[i]) + strlen(module_name) + 5;
+        char* path = malloc(length);
+        snprintf(path, length, "%s/%s.so", system->search_paths[i], module_name);
+        if (access(path, R_OK) == 0) {
+            return path;
+        }
+        free(path);
+    }
+    return NULL;
+#endif
+}
+
+// Opens <module>.so and runs its init_<module>_extension, which registers
+// the extension's functions in the runtime's builtin table
+bool load_extension_module(const char* module_name, InterpreterContext* ctx) {
+    ModuleSystem* system = &ctx->runtime->modules;
+    char* path = find_module_file(system, module_name);
+    if (!path) {
+        fprintf(stderr, "Error: Unknown module '%s'\n", module_name);
+        return false;
+    }
+
+#ifdef _WIN32
+    free(path);
+    return false;
+#else
+    dmo_log(DMO_LOG_INFO, "Loading extension: %s\n", path);
+    
+    // Resolve everything now, so a missing symbol fails here and not mid-run
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "Error: Cannot load extension '%s': %s\n", path, dlerror());
+        free(path);
+        return false;
+    }
+    
+    size_t length = strlen(module_name) + 16;
+    char* symbol = malloc(length);
+    snprintf(symbol, length, "init_%s_extension", module_name);
+    
+    // POSIX allows converting the object pointer to a function pointer
+    DMOExtensionInit init;
+    *(void**)&init = dlsym(handle, symbol);
+    if (!init) {
+        fprintf(stderr, "Error: Extension '%s' has no %s function\n", path, symbol);
+        dlclose(handle);
+        free(symbol);
+        free(path);
+        return false;
+    }
+    
+    Module* module = mark_module_loaded(system, module_name, path);
+    module->handle = handle;
+    init(ctx);
+    
+    free(symbol);
+    free(path);
+    return true;
+#endif
+}
+
+// Modules built into the interpreter. Their loaders only announce the
+// module; state a module needs (graphics, the HTTP pool) is created by the
+// runtime on the first call that uses it, not on import.
+static const BuiltinModule builtin_modules[] = {
+    {"stdlib", load_stdlib_module},
+    {"dmo_graphs", load_dmo_graphs_module},
+    {"request", load_request_module},
+    {"math", load_math_module},
+    {"file", load_file_module},
+    {NULL, NULL}
+};
+
+bool load_module(const char* module_name, InterpreterContext* ctx) {
+    ModuleSystem* system = &ctx->runtime->modules;
+    
+    // A module is set up once per runtime, however often it is imported
+    if (is_module_loaded(system, module_name)) {
+        return true;
+    }
+    if (ctx->runtime->forked) {
+        fprintf(stderr, "Error: Module '%s' can't be loaded inside a parallel for or spawned task; "
+                "use it before\n", module_name);
+        return false;
+    }
+    
+    for (const BuiltinModule* module = builtin_modules; module->name; module++) {
+        if (strcmp(module->name, module_name) == 0) {
+            module->load(ctx);
+            mark_module_loaded(system, module_name, NULL);
+            return true;
+        }
+    }
+    return load_extension_module(module_name, ctx);
+}
+
+void load_stdlib_module(InterpreterContext* ctx) {
+    init_stdlib_functions(ctx);
+}
+
+void load_dmo_graphs_module(InterpreterContext* ctx) {
+    // The runtime sets up graphics on the first graphics call
+    dmo_log(DMO_LOG_INFO, "Loading module: dmo_graphs\n");
+}
+
+void load_request_module(InterpreterContext* ctx) {
+    dmo_log(DMO_LOG_INFO, "Loading module: request\n");
+    // Request module functions will be available
+    // request.get(url), request.post(url, data), etc.
+}
+
+void load_math_module(InterpreterContext* ctx) {
+    dmo_log(DMO_LOG_INFO, "Loading module: math\n");
+    // Math module functions will be available
+    // sin(), cos(), tan(), sigmoid(), sqrt(), pow(), etc. and their batch
+    // variants math.sin(input, output), ... over arrays
+}
+
+void load_file_module(InterpreterContext* ctx) {
+    (void)ctx;
+    dmo_log(DMO_LOG_INFO, "Loading module: file\n");
+    // File module functions will be available
+    // file.open(path, mode), file.read_line(h), file.write(h, text), etc.
+}
+
+// Request module functions
+// Reads everything a command prints, however long
+static char* read_pipe(FILE* pipe) {
+    size_t capacity = 4096;
+    size_t length = 0;
+    char* data = malloc(capacity);
+    size_t bytes_read;
+    while ((bytes_read = fread(data + length, 1, capacity - length - 1, pipe)) > 0) {
+        length += bytes_read;
+        if (capacity - length - 1 == 0) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    data[length] = '\0';
+    return data;
+}
+
+// http:// URLs go through the runtime's keep-alive connection pool; other
+// schemes (https) are still handed to curl
+static Value fetch_url(const char* method, const char* url, const char* data, InterpreterContext* ctx) {
+    if (strncmp(url, "http://", 7) == 0) {
+        HttpResponse response;
+        if (!http_request(runtime_http(ctx->runtime), method, url, data, &response)) {
+            return create_string_value("");
+        }
+        Value result = create_string_value(response.body);
+        free_http_response(&response);
+        return result;
+    }
+    
+    char* command = malloc(strlen(url) + (data ? strlen(data) : 0) + 64);
+    if (data) {
+        sprintf(command, "curl -s -X POST -d '%s' '%s'", data, url);
+    } else {
+        sprintf(command, "curl -s '%s'", url);
+    }
+    
+    FILE* pipe = popen(command, "r");
+    free(command);
+    if (!pipe) {
+        fprintf(stderr, "Error: Failed to execute HTTP request\n");
+        return create_string_value("");
+    }
+    
+    char* response = read_pipe(pipe);
+    pclose(pipe);
+    
+    Value result = create_string_value(response);
+    free(response);
+    return result;
+}
+
+// Request module functions take evaluated arguments checked against their
+// signatures in the builtin table
+Value request_get(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return fetch_url("GET", args[0].string, NULL, ctx);
+}
+
+Value request_post(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return fetch_url("POST", args[0].string, args[1].string, ctx);
+}
+
+// Asynchronous requests: request.get_async(url) and
+// request.post_async(url, data) queue a request on the runtime's event
+// loop and return a handle; the loop runs while the script waits
+static Value request_async(const char* method, const char* url, const char* data, InterpreterContext* ctx) {
+    HttpPool* pool = runtime_http(ctx->runtime);
+    pthread_mutex_lock(&pool->async_lock);
+    int handle = http_submit(&pool->async, method, url, data);
+    pthread_mutex_unlock(&pool->async_lock);
+    
+    if (!handle) {
+        fprintf(stderr, "Error: Asynchronous requests need an http:// URL, got '%s'\n", url);
+    }
+    return create_number_value(handle);
+}
+
+Value request_get_async(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return request_async("GET", args[0].string, NULL, ctx);
+}
+
+Value request_post_async(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return request_async("POST", args[0].string, args[1].string, ctx);
+}
+
+// request.wait_any() returns the handle of a finished request (0 when
+// none are left), request.wait_all() the number that succeeded;
+// request.result(h) returns the body and releases the handle,
+// request.status(h) the HTTP status (0 if the request failed)
+Value request_wait_any(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)args;
+    (void)arg_count;
+    HttpPool* pool = runtime_http(ctx->runtime);
+    pthread_mutex_lock(&pool->async_lock);
+    int handle = http_wait_any(pool, &pool->async);
+    pthread_mutex_unlock(&pool->async_lock);
+    return create_number_value(handle);
+}
+
+Value request_wait_all(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)args;
+    (void)arg_count;
+    HttpPool* pool = runtime_http(ctx->runtime);
+    pthread_mutex_lock(&pool->async_lock);
+    int succeeded = http_wait_all(pool, &pool->async);
+    pthread_mutex_unlock(&pool->async_lock);
+    return create_number_value(succeeded);
+}
+
+static Value request_finish(const char* name, bool take, int handle, InterpreterContext* ctx) {
+    HttpPool* pool = runtime_http(ctx->runtime);
+    
+    pthread_mutex_lock(&pool->async_lock);
+    http_wait(pool, &pool->async, handle);
+    HttpRequest* req = take ? http_take(&pool->async, handle) : http_find(&pool->async, handle);
+    int status = req && req->state == HTTP_DONE ? req->status : 0;
+    Value result = take ? create_string_value(status ? req->body.data : "") : create_number_value(status);
+    pthread_mutex_unlock(&pool->async_lock);
+    
+    if (!req) {
+        fprintf(stderr, "Error: %s of an unknown or released request handle\n", name);
+    } else if (take) {
+        http_free_request(req);
+    }
+    return result;
+}
+
+Value request_result(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return request_finish("request.result", true, (int)args[0].number, ctx);
+}
+
+Value request_status(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return request_finish("request.status", false, (int)args[0].number, ctx);
+}
+
+// Streaming: request.open(url) starts a GET whose body is read piece by
+// piece with request.read_line(s) or request.read_chunk(s) while
+// request.more(s) is 1; request.close(s) ends it early
+Value request_open(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    HttpPool* pool = runtime_http(ctx->runtime);
+    pthread_mutex_lock(&pool->async_lock);
+    int handle = http_open_stream(pool, "GET", args[0].string, NULL);
+    pthread_mutex_unlock(&pool->async_lock);
+    
+    if (!handle) {
+        fprintf(stderr, "Error: request.open needs an http:// URL\n");
+    }
+    return create_number_value(handle);
+}
+
+Value request_more(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    HttpPool* pool = runtime_http(ctx->runtime);
+    pthread_mutex_lock(&pool->async_lock);
+    bool more = http_stream_more(pool, (int)args[0].number);
+    pthread_mutex_unlock(&pool->async_lock);
+    return create_number_value(more);
+}
+
+static Value stream_text(char* (*read)(HttpPool*, int), int handle, InterpreterContext* ctx) {
+    HttpPool* pool = runtime_http(ctx->runtime);
+    pthread_mutex_lock(&pool->async_lock);
+    char* text = read(pool, handle);
+    pthread_mutex_unlock(&pool->async_lock);
+    
+    Value result = create_string_value(text ? text : "");
+    free(text);
+    return result;
+}
+
+Value request_read_line(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return stream_text(http_stream_line, (int)args[0].number, ctx);
+}
+
+Value request_read_chunk(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    return stream_text(http_stream_chunk, (int)args[0].number, ctx);
+}
+
+Value request_close(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    HttpPool* pool = runtime_http(ctx->runtime);
+    pthread_mutex_lock(&pool->async_lock);
+    http_close_stream(pool, (int)args[0].number);
+    pthread_mutex_unlock(&pool->async_lock);
+    return create_void_value();
+}
+
+// request.set_concurrency(n) limits requests in flight, request.set_timeout(s)
+// sets the seconds each request may take
+Value request_set_concurrency(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    if (args[0].number <= 0) {
+        fprintf(stderr, "Error: request.set_concurrency requires a positive number\n");
+    } else {
+        http_configure(runtime_http(ctx->runtime), (int)args[0].number, 0);
+    }
+    return create_void_value();
+}
+
+Value request_set_timeout(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    if (args[0].number <= 0) {
+        fprintf(stderr, "Error: request.set_timeout requires a positive number\n");
+    } else {
+        http_configure(runtime_http(ctx->runtime), 0, args[0].number);
+    }
+    return create_void_value();
+}
+
+bool is_request_function(const char* name) {
+    return strstr(name, "request.") != NULL;
+}
+
+// The request builtins live in the builtin table with their signatures
+Value call_request_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    const DMOBuiltin* builtin = builtin_table_find(core_builtins(), name);
+    if (builtin && is_request_function(name)) {
+        return invoke_builtin(builtin, name, args, arg_count, ctx);
+    }
+    
+    fprintf(stderr, "Error: Unknown request function '%s'\n", name);
+    return create_string_value("");
+}
+
+// Math module functions, called with evaluated arguments
+Value math_sin(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return create_number_value(sin(args[0].number));
+}
+
+Value math_cos(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return create_number_value(cos(args[0].number));
+}
+
+Value math_tan(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return create_number_value(tan(args[0].number));
+}
+
+Value math_sigmoid(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return create_number_value(1.0 / (1.0 + exp(-args[0].number)));
+}
+
+Value math_sqrt(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    if (args[0].number < 0) {
+        fprintf(stderr, "Error: sqrt() of negative number\n");
+        return create_number_value(0);
+    }
+    return create_number_value(sqrt(args[0].number));
+}
+
+Value math_pow(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return create_number_value(pow(args[0].number, args[1].number));
+}
+
+// Batch variants: math.sin(input, output) and friends apply the function
+// to every element of input and write the results into output, an f64
+// array resized to match, which is also returned. input may be output.
+static const double* batch_prepare(const char* name, const Value* args, int output) {
+    DMOArray* in = args[0].array;
+    DMOArray* out = args[output].array;
+    
+    if (out->kind != ARRAY_F64) {
+        fprintf(stderr, "Error: %s() output must be an f64 array, got %s\n",
+                name, array_kind_name(out->kind));
+        return NULL;
+    }
+    
+    if (!array_resize(out, in->length)) {
+        fprintf(stderr, "Error: %s() cannot allocate %zu elements\n", name, in->length);
+        return NULL;
+    }
+    if (in->kind == ARRAY_F64) {
+        return in->f64;
+    }
+    
+    // Other kinds are converted into the output first
+    for (size_t i = 0; i < in->length; i++) {
+        out->f64[i] = array_get(in, i);
+    }
+    return out->f64;
+}
+
+static Value math_batch(const char* name, void (*kernel)(const double*, double*, size_t),
+                        const Value* args) {
+    const double* in = batch_prepare(name, args, 1);
+    if (in) {
+        kernel(in, args[1].array->f64, args[1].array->length);
+    }
+    return copy_value(args[1]);
+}
+
+Value math_batch_sin(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return math_batch("math.sin", vec_sin, args);
+}
+
+Value math_batch_cos(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return math_batch("math.cos", vec_cos, args);
+}
+
+Value math_batch_tan(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return math_batch("math.tan", vec_tan, args);
+}
+
+Value math_batch_sigmoid(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    return math_batch("math.sigmoid", vec_sigmoid, args);
+}
+
+Value math_batch_sqrt(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    const double* in = batch_prepare("math.sqrt", args, 1);
+    if (in) {
+        DMOArray* out = args[1].array;
+        size_t negative = vec_sqrt(in, out->f64, out->length);
+        if (negative) {
+            fprintf(stderr, "Error: math.sqrt() of %zu negative numbers\n", negative);
+        }
+    }
+    return copy_value(args[1]);
+}
+
+// math.pow(input, exponent, output)
+Value math_batch_pow(const Value* args, int arg_count, InterpreterContext* ctx) {
+    (void)arg_count;
+    (void)ctx;
+    const double* in = batch_prepare("math.pow", args, 2);
+    if (in) {
+        DMOArray* out = args[2].array;
+        vec_pow(in, args[1].number, out->f64, out->length);
+    }
+    return copy_value(args[2]);
+}
+
+bool is_math_function(const char* name) {
+    return strcmp(name, "sin") == 0 || strcmp(name, "cos") == 0 || 
+           strcmp(name, "tan") == 0 || strcmp(name, "sigmoid") == 0 ||
+           strcmp(name, "sqrt") == 0 || strcmp(name, "pow") == 0;
+}
+
+// The math builtins live in the builtin table with their signatures
+Value call_math_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx) {
+    const DMOBuiltin* builtin = builtin_table_find(core_builtins(), name);
+    if (builtin && is_math_function(name)) {
+        return invoke_builtin(builtin, name, args, arg_count, ctx);
+    }
+    
+    fprintf(stderr, "Error: Unknown math function '%s'\n", name);
+    return create_number_value(0);
+}
@@ -0,0 +1,89 @@
+/*
+ * DMO Language Module System Header
+ * Handles module loading and imports
+ */
+
+#ifndef MODULES_H
+#define MODULES_H
+
+#include "interpreter.h"
+
+// Module structure
+typedef struct Module {
+    char* name;
+    char* path;
+    void* handle;        // dlopen handle of a native extension, else NULL
+    bool loaded;
+    struct Module* next;
+} Module;
+
+// Module system context. Extensions are searched for in DMO_PATH
+// (colon-separated), then ".", then "extensions".
+typedef struct {
+    Module* loaded_modules;
+    char** search_paths;
+    int path_count;
+} ModuleSystem;
+
+// A module compiled into the interpreter, looked up by load_module before
+// the extension search path
+typedef struct {
+    const char* name;
+    void (*load)(InterpreterContext* ctx);
+} BuiltinModule;
+
+// Function prototypes
+void init_module_system(ModuleSystem* system);
+void cleanup_module_system(ModuleSystem* system);
+void init_modules(InterpreterContext* ctx);
+bool load_module(const char* module_name, InterpreterContext* ctx);
+char* find_module_file(ModuleSystem* system, const char* module_name);
+void add_search_path(ModuleSystem* system, const char* path);
+bool is_module_loaded(ModuleSystem* system, const char* module_name);
+Module* mark_module_loaded(ModuleSystem* system, const char* module_name, const char* path);
+bool load_extension_module(const char* module_name, InterpreterContext* ctx);
+
+// Built-in module loaders
+void init_modules(InterpreterContext* ctx);
+void load_stdlib_module(InterpreterContext* ctx);
+void load_dmo_graphs_module(InterpreterContext* ctx);
+void load_request_module(InterpreterContext* ctx);
+void load_math_module(InterpreterContext* ctx);
+void load_file_module(InterpreterContext* ctx);
+
+// Request module functions, called with evaluated arguments
+Value request_get(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_post(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_get_async(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_post_async(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_wait_any(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_wait_all(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_result(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_status(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_open(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_more(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_read_line(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_read_chunk(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_close(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_set_concurrency(const Value* args, int arg_count, InterpreterContext* ctx);
+Value request_set_timeout(const Value* args, int arg_count, InterpreterContext* ctx);
+bool is_request_function(const char* name);
+Value call_request_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+// Math module functions, called with evaluated arguments
+Value math_sin(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_cos(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_tan(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_sigmoid(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_sqrt(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_pow(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_batch_sin(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_batch_cos(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_batch_tan(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_batch_sigmoid(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_batch_sqrt(const Value* args, int arg_count, InterpreterContext* ctx);
+Value math_batch_pow(const Value* args, int arg_count, InterpreterContext* ctx);
+bool is_math_function(const char* name);
+Value call_math_function(const char* name, ASTNode** args, int arg_count, InterpreterContext* ctx);
+
+#endif // MODULES_H
@@ -0,0 +1,344 @@
+/*
+ * HTTP client test
+ * Runs the request module against a stand-in server on the loopback
+ * interface: plain, chunked, large, closing and POST responses,
+ * asynchronous requests, keep-alive reuse and a requests/s figure, and
+ * with /sleep/N responses held back N ms: fan-out latency, wait_any
+ * order and timeouts
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "dmo_embed.h"
+#include "dmo_runtime.h"
+
+#define BIG_BODY 300000
+#define LOOP_REQUESTS 2000
+#define LATENCY_MS 200
+#define FAN_OUT 10
+
+static int connections = 0;
+static pthread_mutex_t connections_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool send_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        // A timed-out client may be gone by the time a slow reply is sent
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+static bool send_response(int fd, const char* body, size_t length, bool close_after) {
+    char head[256];
+    int head_length = close_after
+        ? snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n")
+        : snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n", length);
+    return send_all(fd, head, head_length) && send_all(fd, body, length);
+}
+
+// 5500 bytes in 1000 byte chunks, with a chunk extension and a trailer
+static bool send_chunked(int fd) {
+    char body[5505];
+    memset(body, 'c', 5500);
+    strcpy(body + 5500, "DONE");
+    const char* head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    if (!send_all(fd, head, strlen(head))) {
+        return false;
+    }
+    for (size_t offset = 0; offset < 5504; offset += 1000) {
+        size_t length = 5504 - offset < 1000 ? 5504 - offset : 1000;
+        char size[32];
+        int size_length = snprintf(size, sizeof(size), "%zx;ext=1\r\n", length);
+        if (!send_all(fd, size, size_length) || !send_all(fd, body + offset, length) ||
+            !send_all(fd, "\r\n", 2)) {
+            return false;
+        }
+    }
+    const char* end = "0\r\nX-Trailer: y\r\n\r\n";
+    return send_all(fd, end, strlen(end));
+}
+
+// Serves requests on one connection until the client closes it or a
+// response ends with the connection
+static void* serve_connection(void* arg) {
+    int fd = (int)(long)arg;
+    char request[8192] = "";
+    size_t used = 0;
+    for (;;) {
+        char* end;
+        while (!(end = strstr(request, "\r\n\r\n"))) {
+            ssize_t got = used < sizeof(request) - 1 ? recv(fd, request + used, sizeof(request) - 1 - used, 0) : 0;
+            if (got <= 0) {
+                close(fd);
+                return NULL;
+            }
+            used += got;
+            request[used] = '\0';
+        }
+        
+        char method[8] = "";
+        char path[256] = "";
+        sscanf(request, "%7s %255s", method, path);
+        size_t header_length = end + 4 - request;
+        size_t body_length = 0;
+        char* length_header = strstr(request, "Content-Length: ");
+        if (length_header && length_header < end) {
+            body_length = strtoul(length_header + 16, NULL, 10);
+        }
+        while (used < header_length + body_length) {
+            ssize_t got = recv(fd, request + used, sizeof(request) - 1 - used, 0);
+            if (got <= 0) {
+                close(fd);
+                return NULL;
+            }
+            used += got;
+        }
+        request[header_length + body_length] = '\0';
+        
+        bool ok;
+        bool close_after = false;
+        if (strcmp(method, "POST") == 0) {
+            char reply[512];
+            int length = snprintf(reply, sizeof(reply), "got %s", request + header_length);
+            ok = send_response(fd, reply, length, false);
+        } else if (strcmp(path, "/chunked") == 0) {
+            ok = send_chunked(fd);
+        } else if (strcmp(path, "/big") == 0) {
+            char* body = malloc(BIG_BODY + 4);
+            memset(body, 'x', BIG_BODY);
+            memcpy(body + BIG_BODY, "END", 3);
+            ok = send_response(fd, body, BIG_BODY + 3, false);
+            free(body);
+        } else if (strncmp(path, "/sleep/", 7) == 0) {
+            long ms = strtol(path + 7, NULL, 10);
+            struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+            nanosleep(&delay, NULL);
+            char reply[300];
+            int length = snprintf(reply, sizeof(reply), "slept %ld", ms);
+            ok = send_response(fd, reply, length, false);
+        } else if (strcmp(path, "/close") == 0) {
+            ok = send_response(fd, "closed body", 11, true);
+            close_after = true;
+        } else {
+            char reply[300];
+            int length = snprintf(reply, sizeof(reply), "hello %s", path);
+            ok = send_response(fd, reply, length, false);
+        }
+        if (!ok || close_after) {
+            close(fd);
+            return NULL;
+        }
+        
+        size_t request_length = header_length + body_length;
+        memmove(request, request + request_length, used - request_length);
+        used -= request_length;
+        request[used] = '\0';
+    }
+}
+
+static void* run_server(void* arg) {
+    int listener = (int)(long)arg;
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        // Heads and bodies go out in separate sends
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        pthread_mutex_lock(&connections_lock);
+        connections++;
+        pthread_mutex_unlock(&connections_lock);
+        
+        pthread_t thread;
+        pthread_create(&thread, NULL, serve_connection, (void*)(long)fd);
+        pthread_detach(thread);
+    }
+}
+
+// Runs source with count, timeout and the URLs slow, slower and slowest
+// (1, 2 and 5 times LATENCY_MS) set, returning its run time or -1 when it
+// fails or its output isn't expected
+static double timed_run(DMORuntime* runtime, const char* base, const char* source, const char* expected) {
+    static const char* names[] = {"slow", "slower", "slowest"};
+    static const int factors[] = {1, 2, 5};
+    
+    dmo_reset(runtime);
+    for (int i = 0; i < 3; i++) {
+        char url[96];
+        snprintf(url, sizeof(url), "%s/sleep/%d", base, LATENCY_MS * factors[i]);
+        dmo_set_string(runtime, names[i], url);
+    }
+    dmo_set_number(runtime, "count", FAN_OUT);
+    dmo_set_number(runtime, "timeout", LATENCY_MS / 1000.0);
+    
+    DMOProgram* program = dmo_compile(source, strlen(source));
+    double start = now_seconds();
+    int status = program ? dmo_run(runtime, program) : 1;
+    double elapsed = now_seconds() - start;
+    
+    size_t length;
+    const char* output = dmo_get_output(runtime, &length);
+    if (status != 0 || strcmp(output, expected) != 0) {
+        fprintf(stderr, "http_client: expected %sgot %s", expected, output);
+        elapsed = -1;
+    }
+    dmo_free_program(program);
+    return elapsed;
+}
+
+static int connection_count() {
+    pthread_mutex_lock(&connections_lock);
+    int count = connections;
+    pthread_mutex_unlock(&connections_lock);
+    return count;
+}
+
+static const char* requests_script =
+    "use request;\n"
+    "show.txt(request.get(base + \"/hello\"));\n"
+    "show.txt(request.get(base + \"/chunked\"));\n"
+    "show.txt(request.get(base + \"/big\"));\n"
+    "show.txt(request.get(base + \"/close\"));\n"
+    "show.txt(request.post(base + \"/form\", \"k=v&z=1\"));\n"
+    "int first = request.get_async(base + \"/a1\");\n"
+    "int second = request.get_async(base + \"/a2\");\n"
+    "show.txt(request.wait_all());\n"
+    "show.txt(request.result(first), request.result(second));\n";
+
+static const char* loop_script =
+    "use request;\n"
+    "int i = 0;\n"
+    "while (i < count) {\n"
+    "    string reply = request.get(base + \"/loop\");\n"
+    "    i = i + 1;\n"
+    "}\n"
+    "show.txt(i);\n";
+
+// count requests to `slow`, which answers after LATENCY_MS
+static const char* fan_out_script =
+    "use request;\n"
+    "int i = 0;\n"
+    "while (i < count) {\n"
+    "    request.get_async(slow);\n"
+    "    i = i + 1;\n"
+    "}\n"
+    "show.txt(request.wait_all());\n";
+
+// wait_any hands out requests as they finish, not as they were made
+static const char* wait_any_script =
+    "use request;\n"
+    "int first = request.get_async(slower);\n"
+    "int second = request.get_async(slow);\n"
+    "show.txt(request.wait_any() == second, request.wait_any() == first, request.wait_any());\n"
+    "show.txt(request.result(second), request.status(first));\n";
+
+// A request past its timeout fails at the deadline, without waiting for
+// the reply
+static const char* timeout_script =
+    "use request;\n"
+    "request.set_timeout(timeout);\n"
+    "int late = request.get_async(slowest);\n"
+    "show.txt(request.wait_all(), request.status(late));\n";
+
+static bool check(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "http_client: %s\n", what);
+    }
+    return condition;
+}
+
+int main() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0 ||
+        getsockname(listener, (struct sockaddr*)&address, &address_length) != 0) {
+        perror("http_client: listen");
+        return 1;
+    }
+    pthread_t server;
+    pthread_create(&server, NULL, run_server, (void*)(long)listener);
+    
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", ntohs(address.sin_port));
+    
+    size_t expected_length = BIG_BODY + 256 + 5504;
+    char* expected = malloc(expected_length);
+    char* big = malloc(BIG_BODY + 4);
+    memset(big, 'x', BIG_BODY);
+    strcpy(big + BIG_BODY, "END");
+    char chunked[5505];
+    memset(chunked, 'c', 5500);
+    strcpy(chunked + 5500, "DONE");
+    snprintf(expected, expected_length, "hello /hello\n%s\n%s\nclosed body\ngot k=v&z=1\n2\nhello /a1 hello /a2\n",
+             chunked, big);
+    
+    DMORuntime* runtime = dmo_open();
+    dmo_set_string(runtime, "base", base);
+    
+    DMOProgram* requests = dmo_compile(requests_script, strlen(requests_script));
+    size_t length;
+    bool ok = check(requests && dmo_run(runtime, requests) == 0, "requests script failed") &&
+              check(strcmp(dmo_get_output(runtime, &length), expected) == 0, "unexpected responses");
+    dmo_reset(runtime);
+    
+    // The pool keeps one connection per concurrent request, whatever the
+    // number of requests
+    int before = connection_count();
+    dmo_set_string(runtime, "base", base);
+    dmo_set_number(runtime, "count", LOOP_REQUESTS);
+    DMOProgram* loop = dmo_compile(loop_script, strlen(loop_script));
+    double start = now_seconds();
+    ok = ok && check(loop && dmo_run(runtime, loop) == 0, "loop script failed");
+    double elapsed = now_seconds() - start;
+    char loop_expected[32];
+    snprintf(loop_expected, sizeof(loop_expected), "%d\n", LOOP_REQUESTS);
+    ok = ok && check(strcmp(dmo_get_output(runtime, &length), loop_expected) == 0, "loop didn't finish") &&
+         check(connection_count() - before <= 1, "keep-alive connections weren't reused");
+    
+    printf("%d requests over %d connections, %.0f requests/s on loopback\n",
+           LOOP_REQUESTS + 7, connection_count(), LOOP_REQUESTS / elapsed);
+    
+    // Requests in flight together cost about the slowest one, not the sum
+    double latency = LATENCY_MS / 1000.0;
+    char fan_out_expected[32];
+    snprintf(fan_out_expected, sizeof(fan_out_expected), "%d\n", FAN_OUT);
+    double fan_out = timed_run(runtime, base, fan_out_script, fan_out_expected);
+    ok = check(fan_out >= latency && fan_out < 2 * latency, "fan-out didn't take about one latency") && ok;
+    printf("%d requests of %d ms each: %.0f ms\n", FAN_OUT, LATENCY_MS, fan_out * 1000);
+    
+    char wait_any_expected[64];
+    snprintf(wait_any_expected, sizeof(wait_any_expected), "1 1 0\nslept %d 200\n", LATENCY_MS);
+    double wait_any = timed_run(runtime, base, wait_any_script, wait_any_expected);
+    ok = check(wait_any >= 2 * latency && wait_any < 3 * latency, "wait_any didn't take the slower latency") && ok;
+    
+    double timeout = timed_run(runtime, base, timeout_script, "0 0\n");
+    ok = check(timeout >= latency && timeout < 3 * latency, "timeout didn't end the request at its deadline") && ok;
+    
+    dmo_free_program(requests);
+    dmo_free_program(loop);
+    dmo_close(runtime);
+    free(expected);
+    free(big);
+    close(listener);
+    return ok ? 0 : 1;
+}
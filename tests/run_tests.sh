@@ -0,0 +1,70 @@
+#!/bin/sh
+# Diamond test suite
+#
+# Usage: tests/run_tests.sh [path to dmo]    (default: ./dmo)
+#
+# Each tests/*.dmo script runs with the arguments in its .args file, if
+# there is one, and its output, stderr included, must equal its .expected
+# file. Every script runs twice, the second time with --no-memo and from
+# the program cache the first run wrote, and both runs must match.
+# Each tests/*.c file is a program built against the interpreter sources
+# and must exit 0.
+
+cd "$(dirname "$0")/.." || exit 1
+DMO=$(cd "$(dirname "${1:-./dmo}")" && pwd)/$(basename "${1:-./dmo}")
+CC=${CC:-cc}
+
+if [ ! -x "$DMO" ]; then
+    echo "No interpreter at $DMO; build it first or pass its path" >&2
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+export DMO_CACHE_DIR="$WORK"
+passed=0
+failed=0
+
+pass() {
+    passed=$((passed + 1))
+    echo "PASS $1"
+}
+
+fail() {
+    failed=$((failed + 1))
+    echo "FAIL $1"
+}
+
+for script in tests/*.dmo; do
+    [ -e "$script" ] || continue
+    name=${script%.dmo}
+    args=""
+    [ -f "$name.args" ] && args=$(cat "$name.args")
+    ok=true
+    for mode in "" --no-memo; do
+        # shellcheck disable=SC2086
+        "$DMO" $args $mode "$script" > "$WORK/out" 2>&1
+        if ! cmp -s "$WORK/out" "$name.expected"; then
+            ok=false
+            diff "$name.expected" "$WORK/out" | head -20
+        fi
+    done
+    if $ok; then pass "$script"; else fail "$script"; fi
+done
+
+SOURCES=$(ls *.c | grep -v -e '^main\.c$' -e '^example_extension\.c$')
+for test in tests/*.c; do
+    [ -e "$test" ] || continue
+    name=$(basename "$test" .c)
+    # shellcheck disable=SC2086
+    if ! $CC -std=c99 -O2 -I. -o "$WORK/$name" "$test" $SOURCES -lm -lpthread -ldl; then
+        fail "$test (build)"
+    elif (cd "$WORK" && "./$name"); then
+        pass "$test"
+    else
+        fail "$test"
+    fi
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
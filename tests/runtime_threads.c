@@ -0,0 +1,84 @@
+/*
+ * Runtime isolation test
+ * Runs different scripts on several runtimes at once, one thread each, and
+ * checks that every runtime's output is that of its own script alone
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dmo_embed.h"
+
+#define THREADS 8
+#define RUNS 50
+
+typedef struct {
+    int id;
+    bool ok;
+} Worker;
+
+// Globals, functions, maps, arrays and a module, all of which live in the
+// runtime; the numbers differ per thread so that a leak between runtimes
+// shows in the output
+static void* run_worker(void* arg) {
+    Worker* worker = arg;
+    int id = worker->id;
+    char source[1024];
+    snprintf(source, sizeof(source),
+             "use math;\n"
+             "int scale(int n) { return n * %d; }\n"
+             "int main() {\n"
+             "    map m = map.new();\n"
+             "    array a = array.f64(3);\n"
+             "    a[1] = base;\n"
+             "    int i = 0;\n"
+             "    while (i < 200) {\n"
+             "        map.set(m, i, scale(i));\n"
+             "        i = i + 1;\n"
+             "    }\n"
+             "    show.txt(\"runtime\", %d, map.get(m, 199), a, sqrt(base * base));\n"
+             "    return 0;\n"
+             "}\n", id, id);
+    char expected[256];
+    snprintf(expected, sizeof(expected), "runtime %d %d [0, %d, 0] %d\n", id, 199 * id, 100 + id, 100 + id);
+    
+    DMOProgram* program = dmo_compile(source, strlen(source));
+    DMORuntime* runtime = dmo_open();
+    worker->ok = program != NULL;
+    for (int run = 0; run < RUNS && worker->ok; run++) {
+        dmo_set_number(runtime, "base", 100 + id);
+        size_t length;
+        worker->ok = dmo_run(runtime, program) == 0 &&
+                     strcmp(dmo_get_output(runtime, &length), expected) == 0;
+        if (!worker->ok) {
+            fprintf(stderr, "runtime %d, run %d: expected \"%s\", got \"%s\"\n",
+                    id, run, expected, dmo_get_output(runtime, &length));
+        }
+        dmo_reset(runtime);
+    }
+    dmo_close(runtime);
+    dmo_free_program(program);
+    return NULL;
+}
+
+int main() {
+    pthread_t threads[THREADS];
+    Worker workers[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        workers[i].id = i + 1;
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+    }
+    
+    int failed = 0;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        failed += !workers[i].ok;
+    }
+    
+    printf("%d runtimes on %d threads, %d runs each: %s\n", THREADS, THREADS, RUNS,
+           failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}